@@ -0,0 +1,98 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Enough for the bitmap windows of a position index query and the runs of an FM-index query
+static constexpr size_t InitialArenaSize = 256 << 10;
+// Unbounded searches may need more, those are rare and are left to the heap instead of being kept around by every thread
+static constexpr size_t MaxArenaSize = 16 << 20;
+
+// Only touched when an arena spills, which stops once it has grown
+static std::atomic<uint64_t> SpilledAllocations = 0;
+static std::atomic<uint64_t> SpilledBytes = 0;
+
+// Upstream of the arena, counts what goes to the heap
+class SpillCounter : public std::pmr::memory_resource {
+public:
+	size_t bytesSinceRelease = 0;
+
+private:
+	void* do_allocate( size_t bytes, size_t alignment ) override {
+		bytesSinceRelease += bytes;
+		SpilledAllocations.fetch_add( 1, std::memory_order_relaxed );
+		SpilledBytes.fetch_add( bytes, std::memory_order_relaxed );
+		return std::pmr::new_delete_resource( )->allocate( bytes, alignment );
+	}
+	void do_deallocate( void* pointer, size_t bytes, size_t alignment ) override {
+		std::pmr::new_delete_resource( )->deallocate( pointer, bytes, alignment );
+	}
+	bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override {
+		return this == &other;
+	}
+};
+
+class ThreadArena {
+public:
+	ThreadArena( ) {
+		Allocate( InitialArenaSize );
+	}
+
+	void Enter( ) {
+		depth++;
+	}
+
+	void Leave( ) {
+		if( --depth > 0 ) {
+			return;
+		}
+		// Grows by what spilled, so the next scope gets by with the buffer alone
+		const auto spilled = upstream.bytesSinceRelease;
+		upstream.bytesSinceRelease = 0;
+		if( spilled > 0 && size < MaxArenaSize ) {
+			resource.reset( );
+			Allocate( std::min( size + spilled, MaxArenaSize ) );
+		}
+		else {
+			resource->release( );
+		}
+	}
+
+	std::pmr::memory_resource* Resource( ) {
+		return &resource.value( );
+	}
+
+private:
+	void Allocate( size_t newSize ) {
+		size = newSize;
+		buffer = std::make_unique<std::byte[]>( size );
+		resource.emplace( buffer.get( ), size, &upstream );
+	}
+
+	SpillCounter upstream;
+	std::unique_ptr<std::byte[]> buffer;
+	size_t size = 0;
+	std::optional<std::pmr::monotonic_buffer_resource> resource;
+	size_t depth = 0;
+};
+
+static ThreadArena& GetThreadArena( ) {
+	static thread_local ThreadArena arena;
+	return arena;
+}
+
+ArenaScope::ArenaScope( ) {
+	GetThreadArena( ).Enter( );
+}
+
+ArenaScope::~ArenaScope( ) {
+	GetThreadArena( ).Leave( );
+}
+
+std::pmr::memory_resource* ArenaScope::Resource( ) const {
+	return GetThreadArena( ).Resource( );
+}
+
+ArenaSpills TakeArenaSpills( ) {
+	return ArenaSpills{ SpilledAllocations.exchange( 0 ), SpilledBytes.exchange( 0 ) };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// Per thread monotonic arenas for the temporaries of index queries, so those do not go to the heap once per query
+// Only what is allocated from Resource( ) uses the arena, other allocations of the generation loops still use the heap
+// Allocations are bump pointer moves, everything is freed at once when the outermost ArenaScope of the thread ends
+// Allocations that do not fit overflow to the heap and are counted, the arena then grows so the next scope fits
+// This module does not depend on the IDA SDK
+
+class ArenaScope {
+public:
+	ArenaScope( );
+	~ArenaScope( );
+
+	ArenaScope( const ArenaScope& ) = delete;
+	ArenaScope& operator=( const ArenaScope& ) = delete;
+
+	// Valid until the outermost scope of the thread ends, scopes may end in any order
+	std::pmr::memory_resource* Resource( ) const;
+};
+
+typedef struct {
+	uint64_t overflows;		// Arena allocations of all threads that did not fit and went to the heap
+	uint64_t bytes;
+} ArenaSpills;
+
+// Overflows since the last call, 0 means the arenas had room for every query temporary
+// This says nothing about allocations that do not use an arena
+ArenaSpills TakeArenaSpills( );
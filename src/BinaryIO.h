@@ -0,0 +1,60 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+
+// Stream helpers for the binary index files, values are written in native byte order
+// Vectors are a 64 bit count followed by their elements, which start and end 8 byte aligned so the files can be mapped and used in place
+// This module does not depend on the IDA SDK
+
+template<typename T>
+void WriteValue( std::ostream& stream, const T& value ) {
+	static_assert( std::is_trivially_copyable_v<T> );
+	stream.write( reinterpret_cast<const char*>( &value ), sizeof( value ) );
+}
+
+template<typename T>
+bool ReadValue( std::istream& stream, T& value ) {
+	static_assert( std::is_trivially_copyable_v<T> );
+	return static_cast<bool>( stream.read( reinterpret_cast<char*>( &value ), sizeof( value ) ) );
+}
+
+inline void AlignStream( std::ostream& stream ) {
+	static constexpr char padding[8] = {};
+	stream.write( padding, ( 8 - stream.tellp( ) % 8 ) % 8 );
+}
+
+inline bool AlignStream( std::istream& stream ) {
+	return static_cast<bool>( stream.ignore( ( 8 - stream.tellg( ) % 8 ) % 8 ) );
+}
+
+template<typename T>
+void WriteVector( std::ostream& stream, const std::vector<T>& values ) {
+	static_assert( std::is_trivially_copyable_v<T> );
+	WriteValue( stream, static_cast<uint64_t>( values.size( ) ) );
+	AlignStream( stream );
+	stream.write( reinterpret_cast<const char*>( values.data( ) ), static_cast<std::streamsize>( values.size( ) * sizeof( T ) ) );
+	AlignStream( stream );
+}
+
+// Fails for counts larger than what is left of the stream, so damaged files do not cause huge allocations
+template<typename T>
+bool ReadVector( std::istream& stream, std::vector<T>& values ) {
+	static_assert( std::is_trivially_copyable_v<T> );
+	uint64_t count = 0;
+	if( !ReadValue( stream, count ) || !AlignStream( stream ) ) {
+		return false;
+	}
+	const auto position = stream.tellg( );
+	stream.seekg( 0, std::ios::end );
+	const auto remaining = static_cast<uint64_t>( stream.tellg( ) - position );
+	stream.seekg( position );
+	if( !stream || count > remaining / sizeof( T ) ) {
+		return false;
+	}
+	values.resize( static_cast<size_t>( count ) );
+	return stream.read( reinterpret_cast<char*>( values.data( ) ), static_cast<std::streamsize>( count * sizeof( T ) ) ) && AlignStream( stream );
+}
@@ -0,0 +1,318 @@
+#include "BytePositionIndex.h"
+#include "BinaryIO.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <bit>
+
+const RoaringBitmap::Container* RoaringBitmap::FindContainer( uint16_t key ) const {
+	const auto it = std::ranges::lower_bound( containers, key, {}, &Container::key );
+	return it != containers.end( ) && it->key == key ? &*it : nullptr;
+}
+
+bool RoaringBitmap::Contains( uint32_t value ) const {
+	const auto container = FindContainer( static_cast<uint16_t>( value >> 16 ) );
+	if( !container ) {
+		return false;
+	}
+	const auto low = static_cast<uint16_t>( value );
+	if( container->bitmap.empty( ) ) {
+		return std::ranges::binary_search( container->array, low );
+	}
+	return ( container->bitmap[low / 64] >> ( low % 64 ) ) & 1;
+}
+
+size_t RoaringBitmap::MemoryUsage( ) const {
+	size_t usage = containers.size( ) * sizeof( Container );
+	for( const auto& container : containers ) {
+		usage += container.array.size( ) * sizeof( uint16_t ) + container.bitmap.size( ) * sizeof( uint64_t );
+	}
+	return usage;
+}
+
+void RoaringBitmap::AppendContainer( Container container ) {
+	cardinality += container.cardinality;
+	containers.push_back( std::move( container ) );
+}
+
+void RoaringBitmap::LoadShifted( int64_t base, uint64_t* words ) const {
+	std::fill_n( words, ContainerWords, 0 );
+	const auto end = base + static_cast<int64_t>( ContainerBits );
+	if( end <= 0 || base > static_cast<int64_t>( UINT32_MAX ) ) {
+		return;
+	}
+
+	// The window overlaps at most two containers
+	const auto firstKey = std::max<int64_t>( base, 0 ) >> 16;
+	const auto lastKey = std::min<int64_t>( ( end - 1 ) >> 16, UINT16_MAX );
+	for( auto key = firstKey; key <= lastKey; key++ ) {
+		const auto container = FindContainer( static_cast<uint16_t>( key ) );
+		if( !container ) {
+			continue;
+		}
+
+		// Position of the container start inside the window, negative if it starts before
+		const auto shift = ( key << 16 ) - base;
+		if( container->bitmap.empty( ) ) {
+			for( const auto low : container->array ) {
+				const auto bit = shift + low;
+				if( bit >= 0 && bit < static_cast<int64_t>( ContainerBits ) ) {
+					words[bit / 64] |= 1ull << ( bit % 64 );
+				}
+			}
+			continue;
+		}
+
+		const auto& source = container->bitmap;
+		if( shift >= 0 ) {
+			const auto wordShift = static_cast<size_t>( shift / 64 );
+			const auto bitShift = static_cast<unsigned>( shift % 64 );
+			for( size_t w = wordShift; w < ContainerWords; w++ ) {
+				const auto s = w - wordShift;
+				words[w] |= ( source[s] << bitShift ) | ( bitShift && s > 0 ? source[s - 1] >> ( 64 - bitShift ) : 0 );
+			}
+		}
+		else {
+			const auto wordShift = static_cast<size_t>( -shift / 64 );
+			const auto bitShift = static_cast<unsigned>( -shift % 64 );
+			for( size_t w = 0; w + wordShift < ContainerWords; w++ ) {
+				const auto s = w + wordShift;
+				words[w] |= ( source[s] >> bitShift ) | ( bitShift && s + 1 < ContainerWords ? source[s + 1] << ( 64 - bitShift ) : 0 );
+			}
+		}
+	}
+}
+
+// Creates the containers of all byte values for one 64 KB chunk of the snapshot
+static void BuildChunk( const uint8_t* data, size_t size, uint16_t key, std::array<std::vector<RoaringBitmap::Container>, 256>& containers ) {
+	std::array<uint32_t, 256> counts{};
+	for( size_t i = 0; i < size; i++ ) {
+		counts[data[i]]++;
+	}
+
+	std::array<RoaringBitmap::Container*, 256> chunkContainers{};
+	for( size_t value = 0; value < 256; value++ ) {
+		if( counts[value] == 0 ) {
+			continue;
+		}
+		auto& container = containers[value].emplace_back( RoaringBitmap::Container{ key, counts[value], {}, {} } );
+		if( counts[value] <= RoaringBitmap::MaxArraySize ) {
+			container.array.reserve( counts[value] );
+		}
+		else {
+			container.bitmap.assign( RoaringBitmap::ContainerWords, 0 );
+		}
+		chunkContainers[value] = &container;
+	}
+
+	for( size_t i = 0; i < size; i++ ) {
+		auto& container = *chunkContainers[data[i]];
+		if( container.bitmap.empty( ) ) {
+			container.array.push_back( static_cast<uint16_t>( i ) );
+		}
+		else {
+			container.bitmap[i / 64] |= 1ull << ( i % 64 );
+		}
+	}
+}
+
+BytePositionIndex::BytePositionIndex( const ByteSnapshot& snapshot ) : snapshot( snapshot ) {
+	const auto size = snapshot.bytes.size( );
+	const auto chunkCount = ( size + RoaringBitmap::ContainerBits - 1 ) / RoaringBitmap::ContainerBits;
+	if( chunkCount == 0 ) {
+		return;
+	}
+
+	// Each task builds the containers of a contiguous range of chunks, they are appended in order afterwards
+	auto& pool = GetThreadPool( );
+	const auto rangeCount = std::min( pool.ThreadCount( ) * 4, chunkCount );
+	std::vector<std::array<std::vector<RoaringBitmap::Container>, 256>> partial( rangeCount );
+	isComplete = pool.ParallelFor( 0, rangeCount, 1, [&]( size_t first, size_t last ) {
+		for( auto range = first; range < last; range++ ) {
+			for( auto chunk = chunkCount * range / rangeCount; chunk < chunkCount * ( range + 1 ) / rangeCount; chunk++ ) {
+				const auto offset = chunk * RoaringBitmap::ContainerBits;
+				BuildChunk( snapshot.bytes.data( ) + offset, std::min( RoaringBitmap::ContainerBits, size - offset ), static_cast<uint16_t>( chunk ), partial[range] );
+			}
+		}
+	}, "position index" );
+
+	for( auto& containers : partial ) {
+		for( size_t value = 0; value < 256; value++ ) {
+			for( auto& container : containers[value] ) {
+				positions[value].AppendContainer( std::move( container ) );
+			}
+		}
+	}
+}
+
+Task<BytePositionIndex> BytePositionIndex::BuildIncrementally( const ByteSnapshot& snapshot, std::function<void( size_t, size_t )> progress ) {
+	const auto size = snapshot.bytes.size( );
+	std::array<std::vector<RoaringBitmap::Container>, 256> containers;
+	for( size_t offset = 0; offset < size; offset += RoaringBitmap::ContainerBits ) {
+		BuildChunk( snapshot.bytes.data( ) + offset, std::min( RoaringBitmap::ContainerBits, size - offset ), static_cast<uint16_t>( offset / RoaringBitmap::ContainerBits ), containers );
+		if( progress ) {
+			progress( std::min( offset + RoaringBitmap::ContainerBits, size ), size );
+		}
+		co_await YieldPoint{ };
+	}
+
+	std::array<RoaringBitmap, 256> positions;
+	for( size_t value = 0; value < 256; value++ ) {
+		for( auto& container : containers[value] ) {
+			positions[value].AppendContainer( std::move( container ) );
+		}
+	}
+	co_return BytePositionIndex( snapshot, std::move( positions ) );
+}
+
+size_t BytePositionIndex::MemoryUsage( ) const {
+	size_t usage = 0;
+	for( const auto& bitmap : positions ) {
+		usage += bitmap.MemoryUsage( );
+	}
+	return usage;
+}
+
+void BytePositionIndex::Save( std::ostream& stream ) const {
+	for( const auto& bitmap : positions ) {
+		WriteValue( stream, static_cast<uint64_t>( bitmap.Containers( ).size( ) ) );
+		for( const auto& container : bitmap.Containers( ) ) {
+			WriteValue( stream, static_cast<uint64_t>( container.key ) );
+			WriteValue( stream, static_cast<uint64_t>( container.cardinality ) );
+			WriteVector( stream, container.array );
+			WriteVector( stream, container.bitmap );
+		}
+	}
+}
+
+std::expected<BytePositionIndex, std::string> BytePositionIndex::Load( std::istream& stream, const ByteSnapshot& snapshot ) {
+	const auto maxKey = snapshot.bytes.size( ) / RoaringBitmap::ContainerBits;
+	std::array<RoaringBitmap, 256> positions;
+	for( auto& bitmap : positions ) {
+		uint64_t containerCount = 0;
+		if( !ReadValue( stream, containerCount ) || containerCount > maxKey + 1 ) {
+			return std::unexpected( "Invalid position index container count" );
+		}
+		for( uint64_t i = 0; i < containerCount; i++ ) {
+			uint64_t key = 0, cardinality = 0;
+			RoaringBitmap::Container container{ };
+			if( !ReadValue( stream, key ) || !ReadValue( stream, cardinality ) || !ReadVector( stream, container.array ) || !ReadVector( stream, container.bitmap ) ) {
+				return std::unexpected( "Truncated position index" );
+			}
+			// Queries index the bitmaps without checks, and rely on the ascending key order
+			const auto isArray = container.bitmap.empty( ) && container.array.size( ) == cardinality && cardinality <= RoaringBitmap::MaxArraySize;
+			const auto isBitmap = container.array.empty( ) && container.bitmap.size( ) == RoaringBitmap::ContainerWords;
+			const auto isOrdered = bitmap.Containers( ).empty( ) || bitmap.Containers( ).back( ).key < key;
+			if( key > maxKey || !( isArray || isBitmap ) || !isOrdered ) {
+				return std::unexpected( "Invalid position index container" );
+			}
+			container.key = static_cast<uint16_t>( key );
+			container.cardinality = static_cast<uint32_t>( cardinality );
+			bitmap.AppendContainer( std::move( container ) );
+		}
+	}
+	return BytePositionIndex( snapshot, std::move( positions ) );
+}
+
+bool BytePositionIndex::IsInsideSegment( size_t offset, size_t length ) const {
+	const auto segment = snapshot.FindSegment( offset );
+	return segment && offset + length <= segment->offset + segment->size;
+}
+
+std::pmr::vector<size_t> BytePositionIndex::FindMatches( const Signature& signature, size_t maxMatches, std::pmr::memory_resource* memory ) const {
+	std::pmr::vector<size_t> matches( memory );
+	if( signature.empty( ) || maxMatches == 0 ) {
+		return matches;
+	}
+
+	typedef struct {
+		size_t offset;
+		uint8_t value;
+	} Term;
+	std::pmr::vector<Term> terms( memory );
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		if( IsJump( signature[i] ) ) {
+			return matches;
+		}
+		if( !signature[i].isWildcard ) {
+			terms.push_back( Term{ i, signature[i].value } );
+		}
+	}
+
+	// Only wildcards, every position matches
+	if( terms.empty( ) ) {
+		for( const auto& segment : snapshot.segments ) {
+			for( size_t i = 0; i + signature.size( ) <= segment.size && matches.size( ) < maxMatches; i++ ) {
+				matches.push_back( segment.offset + i );
+			}
+		}
+		return matches;
+	}
+
+	// Rarest first, the anchor drives the iteration and the others prune it
+	std::ranges::stable_sort( terms, {}, [&]( const Term& term ) { return positions[term.value].Cardinality( ); } );
+	const auto anchor = terms.front( );
+
+	const auto matchesOtherTerms = [&]( size_t start ) {
+		return std::all_of( terms.begin( ) + 1, terms.end( ), [&]( const Term& term ) {
+			return start + term.offset <= UINT32_MAX && positions[term.value].Contains( static_cast<uint32_t>( start + term.offset ) );
+		} );
+	};
+
+	std::pmr::vector<uint64_t> window( RoaringBitmap::ContainerWords, memory );
+	std::pmr::vector<uint64_t> shifted( RoaringBitmap::ContainerWords, memory );
+	for( const auto& container : positions[anchor.value].Containers( ) ) {
+		const auto containerStart = static_cast<size_t>( container.key ) << 16;
+
+		// Sparse container, check each position directly
+		if( container.bitmap.empty( ) ) {
+			for( const auto low : container.array ) {
+				const auto position = containerStart | low;
+				if( position < anchor.offset ) {
+					continue;
+				}
+				const auto start = position - anchor.offset;
+				if( matchesOtherTerms( start ) && IsInsideSegment( start, signature.size( ) ) ) {
+					matches.push_back( start );
+					if( matches.size( ) >= maxMatches ) {
+						return matches;
+					}
+				}
+			}
+			continue;
+		}
+
+		// Dense container, AND the shifted bitmaps of the other terms word by word until nothing is left
+		window.assign( container.bitmap.begin( ), container.bitmap.end( ) );
+		bool isEmpty = false;
+		for( size_t t = 1; t < terms.size( ) && !isEmpty; t++ ) {
+			positions[terms[t].value].LoadShifted( static_cast<int64_t>( containerStart ) + static_cast<int64_t>( terms[t].offset ) - static_cast<int64_t>( anchor.offset ), shifted.data( ) );
+			uint64_t remaining = 0;
+			for( size_t w = 0; w < RoaringBitmap::ContainerWords; w++ ) {
+				window[w] &= shifted[w];
+				remaining |= window[w];
+			}
+			isEmpty = remaining == 0;
+		}
+		if( isEmpty ) {
+			continue;
+		}
+
+		for( size_t w = 0; w < RoaringBitmap::ContainerWords; w++ ) {
+			for( auto bits = window[w]; bits; bits &= bits - 1 ) {
+				const auto position = containerStart + w * 64 + std::countr_zero( bits );
+				if( position < anchor.offset ) {
+					continue;
+				}
+				const auto start = position - anchor.offset;
+				if( IsInsideSegment( start, signature.size( ) ) ) {
+					matches.push_back( start );
+					if( matches.size( ) >= maxMatches ) {
+						return matches;
+					}
+				}
+			}
+		}
+	}
+	return matches;
+}
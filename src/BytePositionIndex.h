@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <expected>
+#include <functional>
+#include <istream>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ByteSnapshot.h"
+#include "CooperativeTask.h"
+#include "SignatureTypes.h"
+
+// Positions of each byte value in the snapshot as compressed (roaring) bitmaps
+// A signature is matched by intersecting the bitmaps of its concrete bytes, shifted by their offset, rarest first
+// This module does not depend on the IDA SDK
+
+// Set of 32 bit values, split by the upper 16 bits into containers that are either sorted arrays or plain bitmaps
+class RoaringBitmap {
+public:
+	static constexpr size_t ContainerBits = 0x10000;
+	static constexpr size_t ContainerWords = ContainerBits / 64;
+	// Containers with more values than this are stored as bitmaps, both need 8 KB at this point
+	static constexpr size_t MaxArraySize = 4096;
+
+	typedef struct {
+		uint16_t key;
+		uint32_t cardinality;
+		std::vector<uint16_t> array;	// Sorted, used if cardinality <= MaxArraySize
+		std::vector<uint64_t> bitmap;	// ContainerWords words otherwise
+	} Container;
+
+	bool Contains( uint32_t value ) const;
+	uint64_t Cardinality( ) const {
+		return cardinality;
+	}
+	size_t MemoryUsage( ) const;
+
+	// Writes bit j = Contains( base + j ) for j in [0, ContainerBits), base may be negative
+	void LoadShifted( int64_t base, uint64_t* words ) const;
+
+	const std::vector<Container>& Containers( ) const {
+		return containers;
+	}
+
+	// Containers have to be appended in ascending key order
+	void AppendContainer( Container container );
+
+private:
+	const Container* FindContainer( uint16_t key ) const;
+
+	std::vector<Container> containers;
+	uint64_t cardinality = 0;
+};
+
+class BytePositionIndex {
+public:
+	// Builds the bitmaps in parallel on the shared pool, one pass over the snapshot
+	explicit BytePositionIndex( const ByteSnapshot& snapshot );
+
+	// Single threaded build that yields after every chunk, for building in idle time without stalling the IDA thread
+	// progress( done, total ) is called after every chunk with the bytes indexed so far
+	static Task<BytePositionIndex> BuildIncrementally( const ByteSnapshot& snapshot, std::function<void( size_t, size_t )> progress = nullptr );
+
+	// False if the build was cancelled, such an index must not be searched
+	bool IsComplete( ) const {
+		return isComplete;
+	}
+
+	// Offsets are stored as 32 bit values
+	static bool Supports( const ByteSnapshot& snapshot ) {
+		return snapshot.bytes.size( ) <= UINT32_MAX;
+	}
+
+	// Returns the snapshot offsets of the first maxMatches matches, sorted, jumps are not supported
+	// The result and the temporaries are allocated from memory
+	std::pmr::vector<size_t> FindMatches( const Signature& signature, size_t maxMatches = SIZE_MAX, std::pmr::memory_resource* memory = std::pmr::get_default_resource( ) ) const;
+
+	size_t MemoryUsage( ) const;
+
+	// For the index cache, the snapshot has to be the one the index was built from
+	void Save( std::ostream& stream ) const;
+	static std::expected<BytePositionIndex, std::string> Load( std::istream& stream, const ByteSnapshot& snapshot );
+
+private:
+	BytePositionIndex( const ByteSnapshot& snapshot, std::array<RoaringBitmap, 256> positions ) : snapshot( snapshot ), positions( std::move( positions ) ) {
+	}
+
+	bool IsInsideSegment( size_t offset, size_t length ) const;
+
+	const ByteSnapshot& snapshot;
+	std::array<RoaringBitmap, 256> positions;
+	bool isComplete = true;
+};
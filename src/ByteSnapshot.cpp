@@ -0,0 +1,138 @@
+#include "ByteSnapshot.h"
+#include "BinaryIO.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <fstream>
+
+// File layout, little endian:
+//   magic, version, segment count
+//   per segment: start address, size
+//   bytes of all segments
+constexpr char SnapshotFileMagic[4] = { 'S', 'M', 'I', 'M' };
+constexpr uint32_t SnapshotFileVersion = 1;
+
+const SnapshotSegment* ByteSnapshot::FindSegment( size_t offset ) const {
+	auto it = std::upper_bound( segments.begin( ), segments.end( ), offset, []( size_t value, const SnapshotSegment& segment ) { return value < segment.offset; } );
+	if( it == segments.begin( ) ) {
+		return nullptr;
+	}
+	--it;
+	return offset < it->offset + it->size ? &*it : nullptr;
+}
+
+uint64_t ByteSnapshot::OffsetToEa( size_t offset ) const {
+	const auto segment = FindSegment( offset );
+	return segment ? segment->startEa + ( offset - segment->offset ) : UINT64_MAX;
+}
+
+size_t ByteSnapshot::EaToOffset( uint64_t ea ) const {
+	auto it = std::upper_bound( segments.begin( ), segments.end( ), ea, []( uint64_t value, const SnapshotSegment& segment ) { return value < segment.startEa; } );
+	if( it == segments.begin( ) ) {
+		return SIZE_MAX;
+	}
+	--it;
+	return ea < it->startEa + it->size ? it->offset + static_cast<size_t>( ea - it->startEa ) : SIZE_MAX;
+}
+
+void ByteSnapshot::ComputeHistogram( ) {
+	histogram.fill( 0 );
+	for( const auto b : bytes ) {
+		histogram[b]++;
+	}
+}
+
+uint64_t ByteSnapshot::Hash( ) const {
+	ByteSnapshotHasher hasher( *this );
+	while( hasher.Step( SIZE_MAX ) ) {
+	}
+	return hasher.Value( );
+}
+
+ByteSnapshotHasher::ByteSnapshotHasher( const ByteSnapshot& snapshot ) : snapshot( snapshot ), hash( 0xCBF29CE484222325ull ) {
+	for( const auto& segment : snapshot.segments ) {
+		Mix( segment.startEa );
+		Mix( segment.size );
+	}
+}
+
+// FNV-1a style over 64 bit words with an extra shift, byte wise hashing takes too long for large images
+void ByteSnapshotHasher::Mix( uint64_t value ) {
+	hash = ( hash ^ value ) * 0x100000001B3ull;
+	hash ^= hash >> 29;
+}
+
+bool ByteSnapshotHasher::Step( size_t maxBytes ) {
+	const auto& bytes = snapshot.bytes;
+	// Whole words per step, so the value does not depend on the step size
+	const auto end = bytes.size( ) - position <= maxBytes ? bytes.size( ) : position + std::max<size_t>( maxBytes / sizeof( uint64_t ) * sizeof( uint64_t ), sizeof( uint64_t ) );
+	for( ; position + sizeof( uint64_t ) <= end; position += sizeof( uint64_t ) ) {
+		uint64_t word;
+		std::memcpy( &word, bytes.data( ) + position, sizeof( word ) );
+		Mix( word );
+	}
+	if( end == bytes.size( ) ) {
+		for( ; position < bytes.size( ); position++ ) {
+			Mix( bytes[position] );
+		}
+	}
+	return position < bytes.size( );
+}
+
+std::expected<void, std::string> ByteSnapshot::Save( const std::string& path ) const {
+	std::ofstream file( path, std::ios::binary | std::ios::trunc );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+
+	file.write( SnapshotFileMagic, sizeof( SnapshotFileMagic ) );
+	WriteValue( file, SnapshotFileVersion );
+	WriteValue( file, static_cast<uint32_t>( segments.size( ) ) );
+	for( const auto& segment : segments ) {
+		WriteValue( file, segment.startEa );
+		WriteValue( file, static_cast<uint64_t>( segment.size ) );
+	}
+	file.write( reinterpret_cast<const char*>( bytes.data( ) ), static_cast<std::streamsize>( bytes.size( ) ) );
+
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to write {}", path ) );
+	}
+	return {};
+}
+
+std::expected<ByteSnapshot, std::string> ByteSnapshot::Load( const std::string& path ) {
+	std::ifstream file( path, std::ios::binary );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+
+	char magic[sizeof( SnapshotFileMagic )] = {};
+	uint32_t version = 0, count = 0;
+	if( !file.read( magic, sizeof( magic ) ) || std::memcmp( magic, SnapshotFileMagic, sizeof( magic ) ) != 0 ) {
+		return std::unexpected( std::format( "{} is not an image dump", path ) );
+	}
+	if( !ReadValue( file, version ) || version != SnapshotFileVersion ) {
+		return std::unexpected( std::format( "{} has unsupported version {}", path, version ) );
+	}
+	if( !ReadValue( file, count ) ) {
+		return std::unexpected( std::format( "{} is truncated", path ) );
+	}
+
+	ByteSnapshot snapshot;
+	size_t totalSize = 0;
+	for( uint32_t i = 0; i < count; i++ ) {
+		uint64_t startEa = 0, size = 0;
+		if( !ReadValue( file, startEa ) || !ReadValue( file, size ) ) {
+			return std::unexpected( std::format( "{} is truncated", path ) );
+		}
+		snapshot.segments.push_back( SnapshotSegment{ startEa, totalSize, static_cast<size_t>( size ) } );
+		totalSize += static_cast<size_t>( size );
+	}
+	snapshot.bytes.resize( totalSize );
+	if( !file.read( reinterpret_cast<char*>( snapshot.bytes.data( ) ), static_cast<std::streamsize>( totalSize ) ) ) {
+		return std::unexpected( std::format( "{} is truncated", path ) );
+	}
+	snapshot.ComputeHistogram( );
+	return snapshot;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <expected>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Copy of all initialized bytes of the database, for searches bin_search3 can not do
+// This header does not depend on the IDA SDK, addresses are plain integers
+
+typedef struct {
+	uint64_t startEa;
+	size_t offset;	// Position in ByteSnapshot::bytes
+	size_t size;
+} SnapshotSegment;
+
+struct ByteSnapshot {
+	std::vector<uint8_t> bytes;
+	std::vector<SnapshotSegment> segments; // Runs of adjacent initialized bytes, sorted by offset and address, matches never cross them
+	std::array<uint64_t, 256> histogram{}; // Occurences of each byte value, to estimate how selective a pattern is
+
+	const SnapshotSegment* FindSegment( size_t offset ) const;
+	uint64_t OffsetToEa( size_t offset ) const;
+	// Returns SIZE_MAX for addresses not in the snapshot
+	size_t EaToOffset( uint64_t ea ) const;
+
+	void ComputeHistogram( );
+
+	// Identifies the image, covers the segment layout and all bytes
+	uint64_t Hash( ) const;
+
+	// Dump of the segments for tools that search outside of IDA
+	std::expected<void, std::string> Save( const std::string& path ) const;
+	static std::expected<ByteSnapshot, std::string> Load( const std::string& path );
+};
+
+// Computes ByteSnapshot::Hash a part at a time, for callers on the IDA thread that yield in between
+class ByteSnapshotHasher {
+public:
+	explicit ByteSnapshotHasher( const ByteSnapshot& snapshot );
+
+	// Hashes about maxBytes more, returns false once all bytes are covered
+	bool Step( size_t maxBytes );
+	uint64_t Value( ) const {
+		return hash;
+	}
+
+private:
+	void Mix( uint64_t value );
+
+	const ByteSnapshot& snapshot;
+	uint64_t hash;
+	size_t position = 0;
+};
+
+// Reads all segments of the current database, implemented in ByteSnapshotIDA.cpp
+ByteSnapshot BuildByteSnapshot( );
+
+// Same snapshot, read a chunk at a time for callers on the IDA thread that yield in between, implemented in ByteSnapshotIDA.cpp
+// The database must not change between the steps
+class ByteSnapshotBuilder {
+public:
+	ByteSnapshotBuilder( );
+
+	// Reads up to maxBytes of the segments, returns false once all of them were read
+	bool Step( size_t maxBytes );
+	uint64_t BytesRead( ) const {
+		return bytesRead;
+	}
+	uint64_t TotalSize( ) const {
+		return totalSize;
+	}
+	ByteSnapshot Finish( );
+
+private:
+	void EndRun( uint64_t ea );
+
+	ByteSnapshot snapshot;
+	uint64_t segmentStart;		// UINT64_MAX once all segments were read
+	uint64_t nextEa;			// Next address to read in that segment
+	uint64_t runStart = UINT64_MAX;	// Start of the run of initialized bytes being read, if any
+	uint64_t totalSize = 0;
+	uint64_t bytesRead = 0;
+	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> mask;
+};
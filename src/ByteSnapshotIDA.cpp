@@ -0,0 +1,91 @@
+#include "ByteSnapshot.h"
+#include "Main.h"
+
+#include <bytes.hpp>
+#include <segment.hpp>
+
+ByteSnapshot BuildByteSnapshot( ) {
+	ByteSnapshotBuilder builder;
+	while( builder.Step( SIZE_MAX ) ) {
+	}
+	return builder.Finish( );
+}
+
+ByteSnapshotBuilder::ByteSnapshotBuilder( ) {
+	for( auto segment = get_first_seg( ); segment; segment = get_next_seg( segment->start_ea ) ) {
+		totalSize += static_cast<uint64_t>( segment->size( ) );
+	}
+	snapshot.bytes.reserve( static_cast<size_t>( totalSize ) );
+
+	const auto first = get_first_seg( );
+	segmentStart = first ? first->start_ea : UINT64_MAX;
+	nextEa = segmentStart;
+}
+
+// Runs of initialized bytes become the segments of the snapshot, uninitialized bytes never match in IDA either
+void ByteSnapshotBuilder::EndRun( uint64_t ea ) {
+	if( runStart != UINT64_MAX ) {
+		const auto size = static_cast<size_t>( ea - runStart );
+		snapshot.segments.push_back( SnapshotSegment{ runStart, snapshot.bytes.size( ) - size, size } );
+		runStart = UINT64_MAX;
+	}
+}
+
+bool ByteSnapshotBuilder::Step( size_t maxBytes ) {
+	while( segmentStart != UINT64_MAX && maxBytes > 0 ) {
+		const auto segment = getseg( static_cast<ea_t>( segmentStart ) );
+		if( !segment ) {
+			EndRun( nextEa );
+			segmentStart = UINT64_MAX;
+			break;
+		}
+
+		const auto size = static_cast<size_t>( std::min<uint64_t>( segment->end_ea - nextEa, maxBytes ) );
+		buffer.resize( size );
+		mask.assign( ( size + 7 ) / 8, 0 );
+		// Chunks that fail to read are left out like uninitialized bytes
+		const auto isRead = size > 0 && get_bytes( buffer.data( ), static_cast<ssize_t>( size ), static_cast<ea_t>( nextEa ), GMB_READALL, mask.data( ) ) > 0;
+		size_t pieceStart = SIZE_MAX;
+		for( size_t i = 0; i <= size; i++ ) {
+			const auto initialized = isRead && i < size && ( mask[i / 8] & ( 1 << ( i % 8 ) ) ) != 0;
+			if( initialized && pieceStart == SIZE_MAX ) {
+				pieceStart = i;
+				if( runStart == UINT64_MAX ) {
+					runStart = nextEa + i;
+				}
+			}
+			else if( !initialized && pieceStart != SIZE_MAX ) {
+				for( auto b = pieceStart; b < i; b++ ) {
+					snapshot.histogram[buffer[b]]++;
+				}
+				snapshot.bytes.insert( snapshot.bytes.end( ), buffer.begin( ) + pieceStart, buffer.begin( ) + i );
+				pieceStart = SIZE_MAX;
+				// A run that reaches the end of the chunk may continue in the next one
+				if( i < size ) {
+					EndRun( nextEa + i );
+				}
+			}
+			else if( !initialized && i < size ) {
+				EndRun( nextEa + i );
+			}
+		}
+		nextEa += size;
+		bytesRead += size;
+		maxBytes -= size;
+
+		if( nextEa >= segment->end_ea ) {
+			// bin_search3 finds matches across adjacent segments, so the run continues into them
+			const auto next = get_next_seg( segment->start_ea );
+			if( !next || next->start_ea != segment->end_ea ) {
+				EndRun( nextEa );
+			}
+			segmentStart = next ? next->start_ea : UINT64_MAX;
+			nextEa = segmentStart;
+		}
+	}
+	return segmentStart != UINT64_MAX;
+}
+
+ByteSnapshot ByteSnapshotBuilder::Finish( ) {
+	return std::move( snapshot );
+}
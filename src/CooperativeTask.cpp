@@ -0,0 +1,63 @@
+#include "CooperativeTask.h"
+
+#include <algorithm>
+
+// Job being resumed and the time it has to yield at
+static std::coroutine_handle<>* CurrentResumePoint = nullptr;
+static std::chrono::steady_clock::time_point QuantumEnd;
+
+YieldSuppressor::YieldSuppressor( ) : suspendedResumePoint( std::exchange( CurrentResumePoint, nullptr ) ) {
+}
+
+YieldSuppressor::~YieldSuppressor( ) {
+	CurrentResumePoint = suspendedResumePoint;
+}
+
+bool CooperativeScheduler::IsInJob( ) {
+	return CurrentResumePoint != nullptr;
+}
+
+bool YieldPoint::await_ready( ) const noexcept {
+	return !CurrentResumePoint || std::chrono::steady_clock::now( ) < QuantumEnd;
+}
+
+void YieldPoint::await_suspend( std::coroutine_handle<> handle ) const noexcept {
+	*CurrentResumePoint = handle;
+}
+
+void CooperativeScheduler::Enqueue( Task<void> job, std::string name ) {
+	const auto start = job.Handle( );
+	jobs.push_back( Job{ std::move( job ), start, std::move( name ) } );
+}
+
+bool CooperativeScheduler::RunSlice( std::chrono::milliseconds slice ) {
+	const auto sliceEnd = std::chrono::steady_clock::now( ) + slice;
+	while( !jobs.empty( ) && std::chrono::steady_clock::now( ) < sliceEnd ) {
+		// Taken out of the queue while it runs, so jobs may enqueue others
+		auto job = std::move( jobs.front( ) );
+		jobs.pop_front( );
+
+		QuantumEnd = std::min( sliceEnd, std::chrono::steady_clock::now( ) + Quantum );
+		CurrentResumePoint = &job.resumePoint;
+		job.resumePoint.resume( );
+		CurrentResumePoint = nullptr;
+
+		if( !job.task.IsDone( ) ) {
+			jobs.push_back( std::move( job ) );
+		}
+		else {
+			// Rethrows what the job did not handle
+			job.task.Result( );
+		}
+	}
+	return !jobs.empty( );
+}
+
+std::vector<std::string> CooperativeScheduler::CancelAll( ) {
+	std::vector<std::string> names;
+	for( auto& job : jobs ) {
+		names.push_back( std::move( job.name ) );
+	}
+	jobs.clear( );
+	return names;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Coroutines that share one thread by giving up control every few milliseconds
+// A Task awaits other tasks like a function call, the scheduler resumes whole jobs, i.e. a task and everything it awaits
+// co_await YieldPoint{ } suspends the job if its time slice is used up, outside of a job it never suspends
+// This module does not depend on the IDA SDK
+
+template<typename T>
+class Task;
+
+// Yield points do not suspend while one exists, e.g. while a job runs a task to completion
+class YieldSuppressor {
+public:
+	YieldSuppressor( );
+	~YieldSuppressor( );
+
+	YieldSuppressor( const YieldSuppressor& ) = delete;
+	YieldSuppressor& operator=( const YieldSuppressor& ) = delete;
+
+private:
+	std::coroutine_handle<>* suspendedResumePoint;
+};
+
+class TaskPromiseBase {
+public:
+	std::suspend_always initial_suspend( ) noexcept {
+		return {};
+	}
+
+	// Continues with the awaiting task, or returns to whoever resumed the job
+	struct FinalAwaiter {
+		bool await_ready( ) noexcept {
+			return false;
+		}
+		template<typename Promise>
+		std::coroutine_handle<> await_suspend( std::coroutine_handle<Promise> handle ) noexcept {
+			const auto continuation = handle.promise( ).continuation;
+			return continuation ? continuation : std::noop_coroutine( );
+		}
+		void await_resume( ) noexcept {
+		}
+	};
+	FinalAwaiter final_suspend( ) noexcept {
+		return {};
+	}
+
+	void unhandled_exception( ) {
+		exception = std::current_exception( );
+	}
+
+	std::coroutine_handle<> continuation;
+	std::exception_ptr exception;
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+	Task<T> get_return_object( );
+	void return_value( T result ) {
+		value.emplace( std::move( result ) );
+	}
+	T TakeResult( ) {
+		if( exception ) {
+			std::rethrow_exception( exception );
+		}
+		return std::move( *value );
+	}
+
+private:
+	std::optional<T> value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+	Task<void> get_return_object( );
+	void return_void( ) {
+	}
+	void TakeResult( ) {
+		if( exception ) {
+			std::rethrow_exception( exception );
+		}
+	}
+};
+
+// Lazily started, owns the coroutine frame, destroying it destroys the tasks it is awaiting as well
+template<typename T>
+class Task {
+public:
+	typedef TaskPromise<T> promise_type;
+
+	explicit Task( std::coroutine_handle<promise_type> handle ) : handle( handle ) {
+	}
+	Task( Task&& other ) noexcept : handle( std::exchange( other.handle, nullptr ) ) {
+	}
+	Task& operator=( Task&& other ) noexcept {
+		if( this != &other ) {
+			if( handle ) {
+				handle.destroy( );
+			}
+			handle = std::exchange( other.handle, nullptr );
+		}
+		return *this;
+	}
+	~Task( ) {
+		if( handle ) {
+			handle.destroy( );
+		}
+	}
+
+	bool await_ready( ) const noexcept {
+		return false;
+	}
+	std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ) noexcept {
+		handle.promise( ).continuation = awaiting;
+		return handle;
+	}
+	T await_resume( ) {
+		return handle.promise( ).TakeResult( );
+	}
+
+	// For callers that are not coroutines, runs the task on the calling thread without ever suspending
+	T RunToCompletion( ) {
+		{
+			YieldSuppressor suppressor;
+			handle.resume( );
+		}
+		return Result( );
+	}
+
+	// Value of a finished task, rethrows its exception
+	T Result( ) {
+		return handle.promise( ).TakeResult( );
+	}
+
+	bool IsDone( ) const {
+		return handle.done( );
+	}
+	std::coroutine_handle<> Handle( ) const {
+		return handle;
+	}
+
+private:
+	std::coroutine_handle<promise_type> handle;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object( ) {
+	return Task<T>( std::coroutine_handle<TaskPromise<T>>::from_promise( *this ) );
+}
+
+inline Task<void> TaskPromise<void>::get_return_object( ) {
+	return Task<void>( std::coroutine_handle<TaskPromise<void>>::from_promise( *this ) );
+}
+
+// Round robin over the queued jobs, all of them run on the thread calling RunSlice
+class CooperativeScheduler {
+public:
+	// Time a job runs before it lets the next one continue
+	static constexpr auto Quantum = std::chrono::milliseconds( 4 );
+
+	void Enqueue( Task<void> job, std::string name );
+
+	// Resumes the jobs in turn until the slice is used up or no job is left, returns true if jobs remain
+	// A job that throws is removed and the exception is rethrown
+	bool RunSlice( std::chrono::milliseconds slice );
+
+	// Destroys the jobs at the point they are suspended at, returns their names
+	std::vector<std::string> CancelAll( );
+
+	size_t JobCount( ) const {
+		return jobs.size( );
+	}
+	bool IsIdle( ) const {
+		return jobs.empty( );
+	}
+
+	// True while a job is being resumed, e.g. to skip modal UI
+	static bool IsInJob( );
+
+private:
+	typedef struct {
+		Task<void> task;
+		std::coroutine_handle<> resumePoint;	// Innermost suspended task
+		std::string name;
+	} Job;
+
+	std::deque<Job> jobs;
+};
+
+struct YieldPoint {
+	bool await_ready( ) const noexcept;
+	void await_suspend( std::coroutine_handle<> handle ) const noexcept;
+	void await_resume( ) const noexcept {
+	}
+};
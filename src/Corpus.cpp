@@ -0,0 +1,298 @@
+#include "Corpus.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <format>
+
+#ifdef _WIN32
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+std::unique_ptr<MappedFile> MappedFile::Open( const std::string& path ) {
+	std::unique_ptr<MappedFile> file( new MappedFile( ) );
+	file->path = path;
+#ifdef _WIN32
+	const auto handle = CreateFileA( path.c_str( ), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if( handle == INVALID_HANDLE_VALUE ) {
+		return nullptr;
+	}
+	file->fileHandle = handle;
+	LARGE_INTEGER fileSize{};
+	if( !GetFileSizeEx( handle, &fileSize ) || fileSize.QuadPart == 0 ) {
+		return nullptr;
+	}
+	file->size = static_cast<size_t>( fileSize.QuadPart );
+	file->mappingHandle = CreateFileMappingA( handle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if( !file->mappingHandle ) {
+		return nullptr;
+	}
+	file->data = static_cast<const uint8_t*>( MapViewOfFile( file->mappingHandle, FILE_MAP_READ, 0, 0, 0 ) );
+#else
+	const auto fd = open( path.c_str( ), O_RDONLY );
+	if( fd < 0 ) {
+		return nullptr;
+	}
+	struct stat fileStat {};
+	if( fstat( fd, &fileStat ) != 0 || fileStat.st_size == 0 ) {
+		close( fd );
+		return nullptr;
+	}
+	file->size = static_cast<size_t>( fileStat.st_size );
+	const auto mapping = mmap( nullptr, file->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( mapping == MAP_FAILED ) {
+		return nullptr;
+	}
+	file->data = static_cast<const uint8_t*>( mapping );
+#endif
+	return file->data ? std::move( file ) : nullptr;
+}
+
+MappedFile::~MappedFile( ) {
+#ifdef _WIN32
+	if( data ) {
+		UnmapViewOfFile( data );
+	}
+	if( mappingHandle ) {
+		CloseHandle( mappingHandle );
+	}
+	if( fileHandle ) {
+		CloseHandle( fileHandle );
+	}
+#else
+	if( data ) {
+		munmap( const_cast<uint8_t*>( data ), size );
+	}
+#endif
+}
+
+CorpusFileIndex::CorpusFileIndex( std::unique_ptr<MappedFile> mappedFile ) : file( std::move( mappedFile ) ) {
+	const auto data = file->Data( );
+	const auto size = file->Size( );
+	if( size < GramLength ) {
+		bucketStarts.assign( 2, 0 );
+		return;
+	}
+	const auto gramCount = size - GramLength + 1;
+
+	// About four positions per bucket
+	bucketBits = static_cast<uint32_t>( std::clamp<size_t>( std::bit_width( gramCount / 4 ), 10, 24 ) );
+	bucketStarts.assign( ( size_t( 1 ) << bucketBits ) + 1, 0 );
+
+	// Counting pass, then fill each bucket
+	for( size_t i = 0; i < gramCount; i++ ) {
+		bucketStarts[BucketOf( data + i ) + 1]++;
+	}
+	for( size_t i = 1; i < bucketStarts.size( ); i++ ) {
+		bucketStarts[i] += bucketStarts[i - 1];
+	}
+	positions.resize( gramCount );
+	auto fill = bucketStarts;
+	for( size_t i = 0; i < gramCount; i++ ) {
+		positions[fill[BucketOf( data + i )]++] = static_cast<uint32_t>( i );
+	}
+}
+
+uint32_t CorpusFileIndex::BucketOf( const uint8_t* gram ) const {
+	uint32_t value;
+	std::memcpy( &value, gram, sizeof( value ) );
+	return ( value * 2654435761u ) >> ( 32 - bucketBits );
+}
+
+bool CorpusFileIndex::Matches( size_t position, const Signature& signature ) const {
+	if( position + signature.size( ) > file->Size( ) ) {
+		return false;
+	}
+	const auto data = file->Data( ) + position;
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		if( !signature[i].isWildcard && data[i] != signature[i].value ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t CorpusFileIndex::CountOccurencesLinear( const Signature& signature, size_t limit ) const {
+	const auto anchor = std::ranges::find_if( signature, []( const auto& b ) { return !b.isWildcard; } ) - signature.begin( );
+	if( signature.size( ) > file->Size( ) ) {
+		return 0;
+	}
+	// Only wildcards match at every position
+	if( static_cast<size_t>( anchor ) == signature.size( ) ) {
+		return std::min( limit, file->Size( ) - signature.size( ) + 1 );
+	}
+
+	const auto data = file->Data( );
+	const auto last = file->Size( ) - signature.size( );
+	size_t count = 0;
+	size_t position = 0;
+	while( position <= last && count < limit ) {
+		const auto found = static_cast<const uint8_t*>( std::memchr( data + position + anchor, signature[anchor].value, last - position + 1 ) );
+		if( !found ) {
+			break;
+		}
+		position = static_cast<size_t>( found - data ) - anchor;
+		if( Matches( position, signature ) ) {
+			count++;
+		}
+		position++;
+	}
+	return count;
+}
+
+size_t CorpusFileIndex::CountOccurences( const Signature& signature, size_t limit ) const {
+	if( signature.empty( ) ) {
+		return 0;
+	}
+	// Jumps have no fixed layout, such signatures are assumed to match rather than pass as unique
+	if( std::ranges::any_of( signature, []( const auto& b ) { return IsJump( b ); } ) ) {
+		return limit;
+	}
+
+	// Use the concrete gram with the smallest bucket
+	size_t bestGram = SIZE_MAX;
+	size_t bestBucketSize = SIZE_MAX;
+	for( size_t i = 0; bucketBits && i + GramLength <= signature.size( ); i++ ) {
+		if( std::any_of( signature.begin( ) + i, signature.begin( ) + i + GramLength, []( const auto& b ) { return b.isWildcard; } ) ) {
+			continue;
+		}
+		const uint8_t gram[GramLength] = { signature[i].value, signature[i + 1].value, signature[i + 2].value, signature[i + 3].value };
+		const auto bucket = BucketOf( gram );
+		const auto bucketSize = bucketStarts[bucket + 1] - bucketStarts[bucket];
+		if( bucketSize < bestBucketSize ) {
+			bestGram = i;
+			bestBucketSize = bucketSize;
+			if( bucketSize == 0 ) {
+				return 0;
+			}
+		}
+	}
+
+	// No four concrete bytes in a row, the index can not help
+	if( bestGram == SIZE_MAX ) {
+		return CountOccurencesLinear( signature, limit );
+	}
+
+	const uint8_t gram[GramLength] = { signature[bestGram].value, signature[bestGram + 1].value, signature[bestGram + 2].value, signature[bestGram + 3].value };
+	const auto bucket = BucketOf( gram );
+	size_t count = 0;
+	for( auto i = bucketStarts[bucket]; i < bucketStarts[bucket + 1] && count < limit; i++ ) {
+		const auto position = positions[i];
+		if( position >= bestGram && Matches( position - bestGram, signature ) ) {
+			count++;
+		}
+	}
+	return count;
+}
+
+// Runs work( index ) for all indices on the shared pool, returns false if cancelled
+template<typename Work>
+static bool ParallelForEach( size_t count, Work&& work ) {
+	return GetThreadPool( ).ParallelFor( 0, count, 1, [&]( size_t first, size_t last ) {
+		for( auto i = first; i < last; i++ ) {
+			work( i );
+		}
+	}, "corpus" );
+}
+
+std::vector<std::string> CollectCorpusFiles( const std::vector<std::string>& paths, std::vector<std::string>& errors ) {
+	std::vector<std::string> filePaths;
+	for( const auto& path : paths ) {
+		std::error_code error;
+		if( std::filesystem::is_directory( path, error ) ) {
+			for( const auto& entry : std::filesystem::recursive_directory_iterator( path, std::filesystem::directory_options::skip_permission_denied, error ) ) {
+				if( entry.is_regular_file( error ) ) {
+					filePaths.push_back( entry.path( ).string( ) );
+				}
+			}
+		}
+		else if( std::filesystem::is_regular_file( path, error ) ) {
+			filePaths.push_back( path );
+		}
+		else {
+			errors.push_back( std::format( "Corpus path not found: {}", path ) );
+		}
+	}
+	return filePaths;
+}
+
+std::vector<std::string> Corpus::Load( const std::vector<std::string>& paths ) {
+	std::vector<std::string> errors;
+	const auto filePaths = CollectCorpusFiles( paths, errors );
+
+	std::vector<std::unique_ptr<CorpusFileIndex>> indices( filePaths.size( ) );
+	std::vector<std::string> fileErrors( filePaths.size( ) );
+	const auto isComplete = ParallelForEach( filePaths.size( ), [&]( size_t i ) {
+		auto file = MappedFile::Open( filePaths[i] );
+		if( !file ) {
+			fileErrors[i] = std::format( "Failed to map {}", filePaths[i] );
+			return;
+		}
+		if( file->Size( ) > UINT32_MAX ) {
+			fileErrors[i] = std::format( "Skipping {}, files above 4 GB are not supported", filePaths[i] );
+			return;
+		}
+		indices[i] = std::make_unique<CorpusFileIndex>( std::move( file ) );
+	} );
+	if( !isComplete ) {
+		errors.push_back( "Loading was cancelled, the corpus is incomplete" );
+	}
+
+	files.clear( );
+	for( size_t i = 0; i < indices.size( ); i++ ) {
+		if( indices[i] ) {
+			files.push_back( std::move( indices[i] ) );
+		}
+		else if( !fileErrors[i].empty( ) ) {
+			errors.push_back( fileErrors[i] );
+		}
+	}
+	return errors;
+}
+
+size_t Corpus::TotalSize( ) const {
+	size_t size = 0;
+	for( const auto& file : files ) {
+		size += file->File( ).Size( );
+	}
+	return size;
+}
+
+size_t Corpus::MemoryUsage( ) const {
+	size_t usage = 0;
+	for( const auto& file : files ) {
+		usage += file->MemoryUsage( );
+	}
+	return usage;
+}
+
+size_t Corpus::CountOccurences( const Signature& signature, size_t limit ) const {
+	std::atomic<size_t> total = 0;
+	const auto isComplete = ParallelForEach( files.size( ), [&]( size_t i ) {
+		const auto found = total.load( );
+		if( found >= limit ) {
+			return;
+		}
+		total += files[i]->CountOccurences( signature, limit - found );
+	} );
+	// Files that were skipped could contain matches
+	return isComplete ? std::min( total.load( ), limit ) : limit;
+}
+
+std::vector<size_t> Corpus::CountOccurencesPerFile( const Signature& signature, size_t limit ) const {
+	std::vector<size_t> counts( files.size( ) );
+	ParallelForEach( files.size( ), [&]( size_t i ) {
+		counts[i] = files[i]->CountOccurences( signature, limit );
+	} );
+	return counts;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SignatureTypes.h"
+
+// Binaries on disk that signatures must not match, e.g. other modules loaded into the same process
+// This module does not depend on the IDA SDK
+
+// Read only memory mapping of a whole file
+class MappedFile {
+public:
+	static std::unique_ptr<MappedFile> Open( const std::string& path );
+	~MappedFile( );
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	const uint8_t* Data( ) const {
+		return data;
+	}
+	size_t Size( ) const {
+		return size;
+	}
+	const std::string& Path( ) const {
+		return path;
+	}
+
+private:
+	MappedFile( ) = default;
+
+	std::string path;
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+// Hashed 4-gram index over one file, positions of each gram hash are stored contiguously
+class CorpusFileIndex {
+public:
+	static constexpr size_t GramLength = 4;
+
+	explicit CorpusFileIndex( std::unique_ptr<MappedFile> file );
+
+	// Counts matches of the signature, stops at limit, signatures with jumps are reported as limit matches
+	size_t CountOccurences( const Signature& signature, size_t limit ) const;
+
+	const MappedFile& File( ) const {
+		return *file;
+	}
+	size_t MemoryUsage( ) const {
+		return ( bucketStarts.size( ) + positions.size( ) ) * sizeof( uint32_t );
+	}
+
+private:
+	uint32_t BucketOf( const uint8_t* gram ) const;
+	bool Matches( size_t position, const Signature& signature ) const;
+	size_t CountOccurencesLinear( const Signature& signature, size_t limit ) const;
+
+	std::unique_ptr<MappedFile> file;
+	uint32_t bucketBits = 0;
+	std::vector<uint32_t> bucketStarts;
+	std::vector<uint32_t> positions;
+};
+
+// Regular files of paths, directories are walked recursively, paths that do not exist are reported in errors
+std::vector<std::string> CollectCorpusFiles( const std::vector<std::string>& paths, std::vector<std::string>& errors );
+
+class Corpus {
+public:
+	// Maps and indexes all files, directories are walked recursively
+	// Returns messages for files that could not be loaded
+	std::vector<std::string> Load( const std::vector<std::string>& paths );
+
+	bool IsEmpty( ) const {
+		return files.empty( );
+	}
+	size_t FileCount( ) const {
+		return files.size( );
+	}
+	const std::string& FilePath( size_t index ) const {
+		return files[index]->File( ).Path( );
+	}
+	size_t TotalSize( ) const;
+	size_t MemoryUsage( ) const;
+
+	// Counts matches over all files in parallel, stops at limit
+	size_t CountOccurences( const Signature& signature, size_t limit = 1 ) const;
+
+	// Counts matches in each file separately, in the order the files were loaded
+	std::vector<size_t> CountOccurencesPerFile( const Signature& signature, size_t limit ) const;
+
+private:
+	std::vector<std::unique_ptr<CorpusFileIndex>> files;
+};
@@ -0,0 +1,460 @@
+#include "CorpusReader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <exception>
+#include <expected>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32
+#	include <fstream>
+#else
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+// liburing is only linked if CMake found it
+#if defined( SIGMAKER_IO_URING ) && __has_include( <liburing.h> )
+#	include <liburing.h>
+#	define SIGMAKER_HAS_IO_URING
+#endif
+
+// O_DIRECT needs buffers, offsets and lengths aligned to the logical block size, 4096 covers all common devices
+constexpr size_t ReadAlignment = 4096;
+
+static size_t AlignUp( size_t size ) {
+	return ( size + ReadAlignment - 1 ) / ReadAlignment * ReadAlignment;
+}
+
+struct AlignedDelete {
+	void operator( )( uint8_t* data ) const {
+		::operator delete[]( data, std::align_val_t( ReadAlignment ) );
+	}
+};
+typedef std::unique_ptr<uint8_t[], AlignedDelete> FileBuffer;
+
+// Has room for the last read of a file, which is rounded up to the alignment
+static FileBuffer AllocateFileBuffer( size_t size ) {
+	return FileBuffer( static_cast<uint8_t*>( ::operator new[]( AlignUp( std::max<size_t>( size, 1 ) ), std::align_val_t( ReadAlignment ) ) ) );
+}
+
+static std::string ErrorMessage( int error ) {
+	return std::error_code( error, std::generic_category( ) ).message( );
+}
+
+typedef struct {
+	FileBuffer data;
+	size_t size;
+} FileContents;
+
+#ifndef _WIN32
+// Falls back to buffered reads on file systems without O_DIRECT, e.g. tmpfs
+static int OpenForReading( const std::string& path, bool directIo, size_t& size, std::string& error ) {
+	int fd = -1;
+#ifdef O_DIRECT
+	if( directIo ) {
+		fd = open( path.c_str( ), O_RDONLY | O_DIRECT );
+	}
+#endif
+	if( fd < 0 ) {
+		fd = open( path.c_str( ), O_RDONLY );
+	}
+	if( fd < 0 ) {
+		error = std::format( "Failed to open {}: {}", path, ErrorMessage( errno ) );
+		return -1;
+	}
+	struct stat fileStat {};
+	if( fstat( fd, &fileStat ) != 0 ) {
+		error = std::format( "Failed to open {}: {}", path, ErrorMessage( errno ) );
+		close( fd );
+		return -1;
+	}
+	size = static_cast<size_t>( fileStat.st_size );
+	return fd;
+}
+
+// O_DIRECT only reads at aligned offsets, the rest of a short read is read through the page cache instead
+// Sets errno and returns false if the file can not be switched
+static bool DisableDirectIo( int fd ) {
+#ifdef O_DIRECT
+	const auto flags = fcntl( fd, F_GETFL );
+	return flags >= 0 && ( ( flags & O_DIRECT ) == 0 || fcntl( fd, F_SETFL, flags & ~O_DIRECT ) == 0 );
+#else
+	( void )fd;
+	return true;
+#endif
+}
+#endif
+
+static std::expected<FileContents, std::string> ReadWholeFile( const std::string& path, const CorpusReadOptions& options ) {
+#ifdef _WIN32
+	std::ifstream file( path, std::ios::binary | std::ios::ate );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+	const auto size = static_cast<size_t>( file.tellg( ) );
+	file.seekg( 0 );
+	FileContents contents{ AllocateFileBuffer( size ), size };
+	if( !file.read( reinterpret_cast<char*>( contents.data.get( ) ), static_cast<std::streamsize>( size ) ) ) {
+		return std::unexpected( std::format( "Failed to read {}", path ) );
+	}
+	return contents;
+#else
+	size_t size = 0;
+	std::string error;
+	const auto fd = OpenForReading( path, options.directIo, size, error );
+	if( fd < 0 ) {
+		return std::unexpected( error );
+	}
+
+	FileContents contents{ AllocateFileBuffer( size ), size };
+	const auto readSize = AlignUp( std::max<size_t>( options.readSize, 1 ) );
+	for( size_t offset = 0; offset < size; ) {
+		if( offset % ReadAlignment != 0 && !DisableDirectIo( fd ) ) {
+			error = std::format( "Failed to read {}: {}", path, ErrorMessage( errno ) );
+			break;
+		}
+		const auto result = pread( fd, contents.data.get( ) + offset, std::min( readSize, AlignUp( size - offset ) ), static_cast<off_t>( offset ) );
+		if( result < 0 && errno == EINTR ) {
+			continue;
+		}
+		if( result <= 0 ) {
+			error = result < 0 ? std::format( "Failed to read {}: {}", path, ErrorMessage( errno ) ) : std::format( "{} shrank while reading", path );
+			break;
+		}
+		offset += static_cast<size_t>( result );
+	}
+	close( fd );
+	if( !error.empty( ) ) {
+		return std::unexpected( error );
+	}
+	return contents;
+#endif
+}
+
+// Every thread of the pool reads a file and matches it, so there are as many reads in flight as threads
+// Reads the files of paths at the given indices
+static void ReadWithPread( const std::vector<std::string>& paths, const std::vector<size_t>& indices, const CorpusMatchFunction& match, const CorpusReadOptions& options, CorpusReadStatistics& statistics ) {
+	std::mutex mutex;
+	const auto isComplete = GetThreadPool( ).ParallelFor( 0, indices.size( ), 1, [&]( size_t first, size_t last ) {
+		for( auto j = first; j < last; j++ ) {
+			const auto i = indices[j];
+			auto contents = ReadWholeFile( paths[i], options );
+			if( !contents.has_value( ) ) {
+				std::scoped_lock lock( mutex );
+				statistics.errors.push_back( std::move( contents.error( ) ) );
+				continue;
+			}
+			if( contents->size == 0 ) {
+				continue;
+			}
+			match( i, std::span<const uint8_t>( contents->data.get( ), contents->size ) );
+
+			std::scoped_lock lock( mutex );
+			statistics.files++;
+			statistics.bytes += contents->size;
+		}
+	}, "corpus read" );
+	if( !isComplete ) {
+		statistics.errors.push_back( "Reading was cancelled, not all files were matched" );
+	}
+}
+
+#ifdef SIGMAKER_HAS_IO_URING
+// Runs the matchers on the shared pool while the reading thread keeps the disk busy
+class MatcherQueue {
+public:
+	explicit MatcherQueue( const CorpusMatchFunction& match ) : match( match ), pool( GetThreadPool( ) ), group( pool, "corpus match" ) {
+	}
+
+	// Files read but not matched yet
+	uint64_t BufferedBytes( ) const {
+		return bufferedBytes.load( std::memory_order_relaxed );
+	}
+
+	// Once a matcher threw no further files should be read
+	bool HasFailed( ) const {
+		return exception || group.StopToken( ).stop_requested( );
+	}
+
+	FileBuffer Allocate( size_t size ) {
+		bufferedBytes += AlignUp( std::max<size_t>( size, 1 ) );
+		return AllocateFileBuffer( size );
+	}
+	void Release( FileBuffer buffer, size_t size ) {
+		buffer.reset( );
+		bufferedBytes -= AlignUp( std::max<size_t>( size, 1 ) );
+	}
+
+	void Dispatch( size_t index, FileBuffer buffer, size_t size ) {
+		// Without worker threads the matcher runs on the reading thread
+		if( pool.ThreadCount( ) == 1 ) {
+			try {
+				if( !exception ) {
+					match( index, std::span<const uint8_t>( buffer.get( ), size ) );
+				}
+			}
+			catch( ... ) {
+				exception = std::current_exception( );
+			}
+			Release( std::move( buffer ), size );
+			return;
+		}
+		// Tasks have to be copyable, the task takes over the buffer
+		group.Run( [this, index, data = buffer.release( ), size]( ) {
+			FileBuffer owned( data );
+			if( !group.StopToken( ).stop_requested( ) ) {
+				match( index, std::span<const uint8_t>( owned.get( ), size ) );
+			}
+			Release( std::move( owned ), size );
+		} );
+	}
+
+	// Runs a pending matcher on the reading thread, returns false if all of them are running already
+	bool Help( ) {
+		return group.Help( );
+	}
+
+	// Rethrows the first exception of a matcher
+	void Wait( ) {
+		group.Wait( );
+		if( exception ) {
+			std::rethrow_exception( exception );
+		}
+	}
+
+private:
+	const CorpusMatchFunction& match;
+	ThreadPool& pool;
+	TaskGroup group;
+	std::atomic<uint64_t> bufferedBytes = 0;
+	std::exception_ptr exception;
+};
+
+typedef struct {
+	size_t index;
+	int fd;
+	size_t size;
+	FileBuffer buffer;
+	size_t queued;			// Bytes covered by queued reads
+	size_t readsInFlight;
+	std::string error;
+} RingFile;
+
+typedef struct {
+	RingFile* file;
+	size_t offset;
+	size_t length;
+} RingRead;
+
+// The reading thread keeps up to queueDepth reads of readSize in flight, files are opened one after another as their reads are queued
+// Returns false if the kernel does not support io_uring reads or they are disabled, e.g. by seccomp, nothing was read then
+// Files the ring did not finish because io_uring_enter failed are stored in unread
+static bool ReadWithIoUring( const std::vector<std::string>& paths, const CorpusMatchFunction& match, const CorpusReadOptions& options, CorpusReadStatistics& statistics, std::vector<size_t>& unread ) {
+	const auto depth = std::clamp<size_t>( options.queueDepth, 1, 4096 );
+	io_uring ring;
+	if( io_uring_queue_init( static_cast<unsigned>( depth ), &ring, 0 ) < 0 ) {
+		return false;
+	}
+	// IORING_OP_READ came with Linux 5.6, older kernels set up rings that fail every read
+	const auto probe = io_uring_get_probe_ring( &ring );
+	const auto isReadSupported = probe && io_uring_opcode_supported( probe, IORING_OP_READ );
+	if( probe ) {
+		io_uring_free_probe( probe );
+	}
+	if( !isReadSupported ) {
+		io_uring_queue_exit( &ring );
+		return false;
+	}
+	statistics.backend = "io_uring";
+	const auto readSize = AlignUp( std::max<size_t>( options.readSize, 1 ) );
+
+	MatcherQueue matchers( match );
+	std::vector<std::unique_ptr<RingFile>> openFiles;
+	RingFile* current = nullptr;	// File whose reads are being queued
+	size_t nextPath = 0;
+	std::string ringError;			// Set once io_uring_enter failed for good, no further reads are submitted then
+
+	// At most depth reads are in flight, so there is always a free submission entry for one of them
+	std::vector<RingRead> reads( depth );
+	std::vector<size_t> freeReads( depth );
+	std::iota( freeReads.rbegin( ), freeReads.rend( ), size_t( 0 ) );
+	size_t inFlight = 0;
+	const auto queueRead = [&]( RingRead& read ) {
+		const auto entry = io_uring_get_sqe( &ring );
+		io_uring_prep_read( entry, read.file->fd, read.file->buffer.get( ) + read.offset, static_cast<unsigned>( read.length ), read.offset );
+		io_uring_sqe_set_data( entry, &read );
+	};
+
+	const auto finishFile = [&]( RingFile* file ) {
+		close( file->fd );
+		if( file->error.empty( ) ) {
+			statistics.files++;
+			statistics.bytes += file->size;
+			matchers.Dispatch( file->index, std::move( file->buffer ), file->size );
+		}
+		else {
+			statistics.errors.push_back( std::move( file->error ) );
+			matchers.Release( std::move( file->buffer ), file->size );
+		}
+		std::erase_if( openFiles, [file]( const auto& openFile ) { return openFile.get( ) == file; } );
+	};
+
+	while( true ) {
+		// Queue reads until the ring is full, the next file is opened once all reads of the current one are queued
+		while( inFlight < depth && !matchers.HasFailed( ) && ringError.empty( ) ) {
+			if( !current ) {
+				if( nextPath == paths.size( ) ) {
+					break;
+				}
+				auto file = std::make_unique<RingFile>( );
+				file->index = nextPath;
+				file->fd = OpenForReading( paths[nextPath], options.directIo, file->size, file->error );
+				nextPath++;
+				if( file->fd < 0 ) {
+					statistics.errors.push_back( std::move( file->error ) );
+					continue;
+				}
+				if( file->size == 0 ) {
+					close( file->fd );
+					continue;
+				}
+				current = openFiles.emplace_back( std::move( file ) ).get( );
+			}
+			if( !current->buffer ) {
+				// Above the budget the matchers have to catch up first, unless they have nothing left to do
+				if( matchers.BufferedBytes( ) > 0 && matchers.BufferedBytes( ) + AlignUp( current->size ) > options.bufferBudget ) {
+					break;
+				}
+				current->buffer = matchers.Allocate( current->size );
+			}
+
+			auto& read = reads[freeReads.back( )];
+			freeReads.pop_back( );
+			read = RingRead{ current, current->queued, std::min( readSize, AlignUp( current->size - current->queued ) ) };
+			queueRead( read );
+			current->queued += read.length;
+			current->readsInFlight++;
+			inFlight++;
+			if( current->queued >= current->size ) {
+				current = nullptr;
+			}
+		}
+
+		if( inFlight == 0 ) {
+			if( matchers.HasFailed( ) || !ringError.empty( ) || ( !current && nextPath == paths.size( ) ) ) {
+				break;
+			}
+			// Nothing to wait for on the disk, the budget is taken by files the matchers did not finish yet, so this thread matches one as well
+			if( !matchers.Help( ) ) {
+				std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+			}
+			continue;
+		}
+
+		io_uring_cqe* completion = nullptr;
+		if( ringError.empty( ) ) {
+			// Interrupted submissions are retried in the next round, a busy ring takes further submissions once a completion was reaped
+			auto result = io_uring_submit_and_wait( &ring, 1 );
+			if( ( result == -EAGAIN || result == -EBUSY ) && inFlight > io_uring_sq_ready( &ring ) ) {
+				result = io_uring_wait_cqe( &ring, &completion );
+			}
+			if( result < 0 && result != -EINTR ) {
+				ringError = ErrorMessage( -result );
+			}
+		}
+		// Only the reads the kernel took are waited for, the others were never submitted
+		else if( inFlight == io_uring_sq_ready( &ring ) ) {
+			break;
+		}
+		else if( const auto result = io_uring_wait_cqe( &ring, &completion ); result < 0 && result != -EINTR ) {
+			// The kernel may still write to the buffers of those reads, so they are leaked instead of freed
+			for( auto& file : openFiles ) {
+				file->buffer.release( );
+			}
+			break;
+		}
+
+		while( io_uring_peek_cqe( &ring, &completion ) == 0 ) {
+			auto& read = *static_cast<RingRead*>( io_uring_cqe_get_data( completion ) );
+			auto result = completion->res;
+			io_uring_cqe_seen( &ring, completion );
+
+			auto& file = *read.file;
+			if( result == -EAGAIN || result == -EINTR ) {
+				queueRead( read );
+				continue;
+			}
+			// Buffered reads may return less than requested before the end of the file, the rest is read again
+			if( result > 0 && static_cast<size_t>( result ) < read.length && read.offset + result < file.size ) {
+				read.offset += result;
+				read.length -= result;
+				if( read.offset % ReadAlignment == 0 || DisableDirectIo( file.fd ) ) {
+					queueRead( read );
+					continue;
+				}
+				result = -errno;
+			}
+			if( result <= 0 && file.error.empty( ) ) {
+				file.error = result < 0 ? std::format( "Failed to read {}: {}", paths[file.index], ErrorMessage( -result ) ) : std::format( "{} shrank while reading", paths[file.index] );
+				if( current == &file ) {
+					current = nullptr;
+				}
+			}
+
+			freeReads.push_back( static_cast<size_t>( &read - reads.data( ) ) );
+			inFlight--;
+			if( --file.readsInFlight == 0 && ( file.queued >= file.size || !file.error.empty( ) ) ) {
+				finishFile( &file );
+			}
+		}
+	}
+
+	// Files left after a matcher or the ring failed, none of them has reads in flight the kernel took
+	for( const auto& file : openFiles ) {
+		close( file->fd );
+		if( !ringError.empty( ) ) {
+			unread.push_back( file->index );
+		}
+	}
+	io_uring_queue_exit( &ring );
+	matchers.Wait( );
+
+	if( !ringError.empty( ) ) {
+		for( ; nextPath < paths.size( ); nextPath++ ) {
+			unread.push_back( nextPath );
+		}
+		std::ranges::sort( unread );
+		statistics.errors.push_back( std::format( "io_uring failed: {}, {} files were read with pread instead", ringError, unread.size( ) ) );
+	}
+	return true;
+}
+#endif
+
+CorpusReadStatistics ReadCorpus( const std::vector<std::string>& paths, const CorpusMatchFunction& match, const CorpusReadOptions& options ) {
+	const auto start = std::chrono::steady_clock::now( );
+	CorpusReadStatistics statistics{ "pread", 0, 0, {}, {} };
+
+	bool isRead = false;
+	std::vector<size_t> unread;
+#ifdef SIGMAKER_HAS_IO_URING
+	isRead = options.allowIoUring && ReadWithIoUring( paths, match, options, statistics, unread );
+#endif
+	if( !isRead ) {
+		unread.resize( paths.size( ) );
+		std::iota( unread.begin( ), unread.end( ), size_t( 0 ) );
+	}
+	ReadWithPread( paths, unread, match, options, statistics );
+
+	statistics.duration = std::chrono::steady_clock::now( ) - start;
+	return statistics;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <span>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Reads whole files with many large reads in flight, for scans over directories of binaries that leave the disk idle when reading one file at a time
+// Uses io_uring if the build found liburing and the kernel supports its reads, otherwise every thread of the shared pool reads files with pread
+// If io_uring fails while reading, the files it did not finish are read with pread as well
+// Each file is handed to a matcher on the shared pool as soon as its last read completed
+// This module does not depend on the IDA SDK
+
+struct CorpusReadOptions {
+	size_t queueDepth = 128;				// Reads in flight with io_uring
+	size_t readSize = 1 << 20;				// Size of each read, rounded up to a multiple of 4096
+	uint64_t bufferBudget = 1ull << 30;		// Bytes read but not yet matched, further reads wait for the matchers above it
+	bool directIo = false;					// Bypasses the page cache, faster for files that are not cached, slower for those that are
+	bool allowIoUring = true;
+};
+
+typedef struct {
+	const char* backend;			// "io_uring" or "pread"
+	size_t files;					// Files handed to the matcher
+	uint64_t bytes;
+	std::chrono::nanoseconds duration;
+	std::vector<std::string> errors;
+} CorpusReadStatistics;
+
+// Called with the index of the file in paths and its contents, which are only valid during the call
+typedef std::function<void( size_t, std::span<const uint8_t> )> CorpusMatchFunction;
+
+// Calls match for every non-empty file of paths, on the threads of the shared pool in no particular order
+// Rethrows the first exception thrown by match after the reads in flight completed
+CorpusReadStatistics ReadCorpus( const std::vector<std::string>& paths, const CorpusMatchFunction& match, const CorpusReadOptions& options = {} );
@@ -0,0 +1,667 @@
+#include "FMIndex.h"
+#include "BinaryIO.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+#include <queue>
+#include <ranges>
+#include <span>
+
+void RankBitVector::PushBack( bool bit ) {
+	if( size % 64 == 0 ) {
+		words.push_back( 0 );
+	}
+	if( bit ) {
+		words.back( ) |= 1ull << ( size % 64 );
+	}
+	size++;
+}
+
+void RankBitVector::BuildRank( ) {
+	words.shrink_to_fit( );
+	blockRanks.assign( words.size( ) / 8 + 1, 0 );
+	uint32_t rank = 0;
+	for( size_t w = 0; w < words.size( ); w++ ) {
+		if( w % 8 == 0 ) {
+			blockRanks[w / 8] = rank;
+		}
+		rank += std::popcount( words[w] );
+	}
+	if( words.size( ) % 8 == 0 ) {
+		blockRanks.back( ) = rank;
+	}
+}
+
+size_t RankBitVector::Rank1( size_t i ) const {
+	const auto word = i / 64;
+	size_t rank = blockRanks[word / 8];
+	for( auto w = word / 8 * 8; w < word; w++ ) {
+		rank += std::popcount( words[w] );
+	}
+	if( i % 64 ) {
+		rank += std::popcount( words[word] & ( ( 1ull << ( i % 64 ) ) - 1 ) );
+	}
+	return rank;
+}
+
+void RankBitVector::Save( std::ostream& stream ) const {
+	WriteValue( stream, static_cast<uint64_t>( size ) );
+	WriteVector( stream, words );
+	WriteVector( stream, blockRanks );
+}
+
+bool RankBitVector::Load( std::istream& stream ) {
+	uint64_t bitCount = 0;
+	if( !ReadValue( stream, bitCount ) || !ReadVector( stream, words ) || !ReadVector( stream, blockRanks ) ) {
+		return false;
+	}
+	size = static_cast<size_t>( bitCount );
+	if( words.size( ) != ( size + 63 ) / 64 || blockRanks.size( ) != words.size( ) / 8 + 1 ) {
+		return false;
+	}
+	// Rank1 trusts the stored counts
+	uint32_t rank = 0;
+	for( size_t w = 0; w < words.size( ); w++ ) {
+		if( w % 8 == 0 && blockRanks[w / 8] != rank ) {
+			return false;
+		}
+		rank += std::popcount( words[w] );
+	}
+	return words.size( ) % 8 != 0 || blockRanks.back( ) == rank;
+}
+
+HuffmanWaveletTree::HuffmanWaveletTree( const std::vector<uint8_t>& sequence ) {
+	std::array<uint64_t, 256> frequencies{};
+	for( const auto symbol : sequence ) {
+		frequencies[symbol]++;
+	}
+
+	// Huffman tree, leaves are -( symbol + 1 ), internal nodes index into merged
+	typedef std::pair<uint64_t, int32_t> Weighted;
+	std::priority_queue<Weighted, std::vector<Weighted>, std::greater<>> queue;
+	for( int32_t symbol = 0; symbol < 256; symbol++ ) {
+		if( frequencies[symbol] ) {
+			queue.emplace( frequencies[symbol], -( symbol + 1 ) );
+		}
+	}
+	if( queue.empty( ) ) {
+		return;
+	}
+	// A single symbol still needs one level to have a code
+	if( queue.size( ) == 1 ) {
+		queue.emplace( 0, -( ( ( -queue.top( ).second - 1 ) ^ 1 ) + 1 ) );
+	}
+	std::vector<std::array<int32_t, 2>> merged;
+	while( queue.size( ) > 1 ) {
+		const auto first = queue.top( );
+		queue.pop( );
+		const auto second = queue.top( );
+		queue.pop( );
+		merged.push_back( { first.second, second.second } );
+		queue.emplace( first.first + second.first, static_cast<int32_t>( merged.size( ) - 1 ) );
+	}
+
+	// Number the nodes from the root and assign codes
+	typedef struct {
+		int32_t merged;
+		int32_t node;
+		uint64_t code;
+		uint8_t length;
+	} Pending;
+	nodes.reserve( merged.size( ) );
+	nodes.push_back( Node{ {}, { 0, 0 } } );
+	std::vector<Pending> pending{ { queue.top( ).second, 0, 0, 0 } };
+	while( !pending.empty( ) ) {
+		const auto [current, index, code, length] = pending.back( );
+		pending.pop_back( );
+		for( int bit = 0; bit < 2; bit++ ) {
+			const auto child = merged[current][bit];
+			const auto childCode = code | ( static_cast<uint64_t>( bit ) << length );
+			if( child < 0 ) {
+				nodes[index].children[bit] = child;
+				codes[-child - 1] = childCode;
+				codeLengths[-child - 1] = static_cast<uint8_t>( length + 1 );
+				continue;
+			}
+			nodes[index].children[bit] = static_cast<int32_t>( nodes.size( ) );
+			pending.push_back( Pending{ child, static_cast<int32_t>( nodes.size( ) ), childCode, static_cast<uint8_t>( length + 1 ) } );
+			nodes.push_back( Node{ {}, { 0, 0 } } );
+		}
+	}
+
+	for( const auto symbol : sequence ) {
+		auto node = 0;
+		for( uint8_t level = 0; level < codeLengths[symbol]; level++ ) {
+			const auto bit = ( codes[symbol] >> level ) & 1;
+			nodes[node].bits.PushBack( bit );
+			node = nodes[node].children[bit];
+		}
+	}
+	for( auto& node : nodes ) {
+		node.bits.BuildRank( );
+	}
+}
+
+size_t HuffmanWaveletTree::Rank( uint8_t symbol, size_t i ) const {
+	if( codeLengths[symbol] == 0 ) {
+		return 0;
+	}
+	int32_t node = 0;
+	for( uint8_t level = 0; level < codeLengths[symbol] && i; level++ ) {
+		const auto bit = ( codes[symbol] >> level ) & 1;
+		const auto ones = nodes[node].bits.Rank1( i );
+		i = bit ? ones : i - ones;
+		node = nodes[node].children[bit];
+	}
+	return i;
+}
+
+uint8_t HuffmanWaveletTree::Access( size_t i ) const {
+	int32_t node = 0;
+	while( true ) {
+		const auto bit = nodes[node].bits.Get( i );
+		const auto ones = nodes[node].bits.Rank1( i );
+		i = bit ? ones : i - ones;
+		const auto child = nodes[node].children[bit];
+		if( child < 0 ) {
+			return static_cast<uint8_t>( -child - 1 );
+		}
+		node = child;
+	}
+}
+
+size_t HuffmanWaveletTree::MemoryUsage( ) const {
+	size_t usage = nodes.capacity( ) * sizeof( Node );
+	for( const auto& node : nodes ) {
+		usage += node.bits.MemoryUsage( );
+	}
+	return usage;
+}
+
+void HuffmanWaveletTree::Save( std::ostream& stream ) const {
+	WriteValue( stream, static_cast<uint64_t>( nodes.size( ) ) );
+	for( const auto& node : nodes ) {
+		WriteValue( stream, node.children );
+		node.bits.Save( stream );
+	}
+	WriteValue( stream, codes );
+	WriteValue( stream, codeLengths );
+}
+
+bool HuffmanWaveletTree::Load( std::istream& stream ) {
+	uint64_t nodeCount = 0;
+	if( !ReadValue( stream, nodeCount ) || nodeCount > 256 ) {
+		return false;
+	}
+	nodes.resize( static_cast<size_t>( nodeCount ) );
+	for( auto& node : nodes ) {
+		if( !ReadValue( stream, node.children ) || !node.bits.Load( stream ) ) {
+			return false;
+		}
+		// Inner nodes only point forward, so Rank and Access always terminate
+		for( const auto child : node.children ) {
+			if( child >= static_cast<int32_t>( nodes.size( ) ) || child < -256 || ( child >= 0 && child <= &node - nodes.data( ) ) ) {
+				return false;
+			}
+		}
+	}
+	if( !ReadValue( stream, codes ) || !ReadValue( stream, codeLengths ) ) {
+		return false;
+	}
+
+	// The code of every symbol has to lead to its own leaf, and every leaf has to belong to a symbol with a code
+	for( size_t symbol = 0; symbol < 256; symbol++ ) {
+		if( codeLengths[symbol] == 0 ) {
+			continue;
+		}
+		if( nodes.empty( ) || codeLengths[symbol] > 64 ) {
+			return false;
+		}
+		int32_t node = 0;
+		for( uint8_t level = 0; level < codeLengths[symbol]; level++ ) {
+			if( node < 0 ) {
+				return false;
+			}
+			node = nodes[node].children[( codes[symbol] >> level ) & 1];
+		}
+		if( node != -static_cast<int32_t>( symbol + 1 ) ) {
+			return false;
+		}
+	}
+	// Each child has one bit for every bit of its parent that leads to it
+	for( const auto& node : nodes ) {
+		const auto ones = node.bits.Rank1( node.bits.Size( ) );
+		for( int bit = 0; bit < 2; bit++ ) {
+			const auto child = node.children[bit];
+			const auto expected = bit ? ones : node.bits.Size( ) - ones;
+			if( child < 0 ? codeLengths[-child - 1] == 0 : nodes[child].bits.Size( ) != expected ) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// SA-IS suffix sorting by induced sorting of the LMS substrings, the text may be bytes or ints
+// Suffixes that are a prefix of another one sort first, as if the text was terminated by a unique smallest symbol
+template<typename Text>
+static std::vector<int32_t> BuildSuffixArray( const Text& text, int32_t upper ) {
+	const auto n = static_cast<int32_t>( text.size( ) );
+	if( n == 0 ) {
+		return {};
+	}
+	if( n < 16 ) {
+		std::vector<int32_t> sa( n );
+		std::iota( sa.begin( ), sa.end( ), 0 );
+		std::ranges::sort( sa, [&]( int32_t a, int32_t b ) {
+			return std::lexicographical_compare( text.begin( ) + a, text.end( ), text.begin( ) + b, text.end( ) );
+		} );
+		return sa;
+	}
+
+	std::vector<int32_t> sa( n );
+	std::vector<uint8_t> isS( n );
+	for( auto i = n - 2; i >= 0; i-- ) {
+		isS[i] = text[i] == text[i + 1] ? isS[i + 1] : text[i] < text[i + 1];
+	}
+
+	// Bucket starts for S and L suffixes of each symbol
+	std::vector<int32_t> startL( upper + 2 ), startS( upper + 2 );
+	for( int32_t i = 0; i < n; i++ ) {
+		if( !isS[i] ) {
+			startS[text[i]]++;
+		}
+		else {
+			startL[text[i] + 1]++;
+		}
+	}
+	for( int32_t i = 0; i <= upper; i++ ) {
+		startS[i] += startL[i];
+		if( i < upper ) {
+			startL[i + 1] += startS[i];
+		}
+	}
+
+	const auto induce = [&]( const std::vector<int32_t>& lms ) {
+		std::ranges::fill( sa, -1 );
+		std::vector<int32_t> bucket( upper + 1 );
+		std::copy( startS.begin( ), startS.begin( ) + upper + 1, bucket.begin( ) );
+		for( const auto d : lms ) {
+			if( d != n ) {
+				sa[bucket[text[d]]++] = d;
+			}
+		}
+		std::copy( startL.begin( ), startL.begin( ) + upper + 1, bucket.begin( ) );
+		sa[bucket[text[n - 1]]++] = n - 1;
+		for( int32_t i = 0; i < n; i++ ) {
+			const auto v = sa[i];
+			if( v >= 1 && !isS[v - 1] ) {
+				sa[bucket[text[v - 1]]++] = v - 1;
+			}
+		}
+		std::copy( startL.begin( ), startL.begin( ) + upper + 1, bucket.begin( ) );
+		for( auto i = n - 1; i >= 0; i-- ) {
+			const auto v = sa[i];
+			if( v >= 1 && isS[v - 1] ) {
+				sa[--bucket[text[v - 1] + 1]] = v - 1;
+			}
+		}
+	};
+
+	std::vector<int32_t> lmsIndex( n + 1, -1 );
+	std::vector<int32_t> lms;
+	for( int32_t i = 1; i < n; i++ ) {
+		if( !isS[i - 1] && isS[i] ) {
+			lmsIndex[i] = static_cast<int32_t>( lms.size( ) );
+			lms.push_back( i );
+		}
+	}
+	const auto m = static_cast<int32_t>( lms.size( ) );
+	induce( lms );
+
+	if( m ) {
+		// Name the sorted LMS substrings and sort them recursively
+		std::vector<int32_t> sortedLms;
+		sortedLms.reserve( m );
+		for( const auto v : sa ) {
+			if( lmsIndex[v] != -1 ) {
+				sortedLms.push_back( v );
+			}
+		}
+		std::vector<int32_t> reduced( m );
+		int32_t reducedUpper = 0;
+		reduced[lmsIndex[sortedLms[0]]] = 0;
+		for( int32_t i = 1; i < m; i++ ) {
+			auto l = sortedLms[i - 1], r = sortedLms[i];
+			const auto endL = lmsIndex[l] + 1 < m ? lms[lmsIndex[l] + 1] : n;
+			const auto endR = lmsIndex[r] + 1 < m ? lms[lmsIndex[r] + 1] : n;
+			auto same = true;
+			if( endL - l != endR - r ) {
+				same = false;
+			}
+			else {
+				while( l < endL && text[l] == text[r] ) {
+					l++;
+					r++;
+				}
+				if( l == n || text[l] != text[r] ) {
+					same = false;
+				}
+			}
+			if( !same ) {
+				reducedUpper++;
+			}
+			reduced[lmsIndex[sortedLms[i]]] = reducedUpper;
+		}
+		lmsIndex = {};
+
+		const auto reducedSa = BuildSuffixArray( reduced, reducedUpper );
+		for( int32_t i = 0; i < m; i++ ) {
+			sortedLms[i] = lms[reducedSa[i]];
+		}
+		induce( sortedLms );
+	}
+	return sa;
+}
+
+FMIndex::Block::Block( const uint8_t* text, size_t offset, size_t length, size_t overlap, size_t sampleRate )
+	: offset( offset ), length( length ), overlap( overlap ), sampleRate( sampleRate ), primaryRow( 0 ) {
+	// Row 0 is the empty suffix, the suffix array of the block follows
+	const auto suffixArray = BuildSuffixArray( std::span( text, length ), 255 );
+
+	std::vector<uint8_t> bwtSymbols( length + 1 );
+	bwtSymbols[0] = length ? text[length - 1] : 0;
+	for( size_t row = 1; row <= length; row++ ) {
+		const auto position = static_cast<size_t>( suffixArray[row - 1] );
+		if( position == 0 ) {
+			primaryRow = row;
+			bwtSymbols[row] = 0;
+		}
+		else {
+			bwtSymbols[row] = text[position - 1];
+		}
+	}
+
+	sampledPositionRows.resize( ( length + sampleRate - 1 ) / sampleRate );
+	for( size_t row = 0; row <= length; row++ ) {
+		const auto position = row ? static_cast<size_t>( suffixArray[row - 1] ) : length;
+		const auto isSampled = position % sampleRate == 0;
+		sampledRows.PushBack( isSampled );
+		if( isSampled ) {
+			samples.push_back( static_cast<uint32_t>( position ) );
+			if( position < length ) {
+				sampledPositionRows[position / sampleRate] = static_cast<uint32_t>( row );
+			}
+		}
+	}
+	sampledRows.BuildRank( );
+	overlapBytes.assign( text + length - overlap, text + length );
+
+	// The empty suffix sorts before all others
+	std::array<size_t, 256> counts{};
+	for( size_t i = 0; i < length; i++ ) {
+		counts[text[i]]++;
+	}
+	symbolStarts[0] = 1;
+	for( size_t symbol = 0; symbol < 256; symbol++ ) {
+		symbolStarts[symbol + 1] = symbolStarts[symbol] + counts[symbol];
+	}
+
+	bwt = HuffmanWaveletTree( bwtSymbols );
+}
+
+size_t FMIndex::Block::RankBWT( uint8_t symbol, size_t row ) const {
+	// The terminator is stored as 0 in the primary row
+	auto rank = bwt.Rank( symbol, row );
+	if( symbol == 0 && primaryRow < row ) {
+		rank--;
+	}
+	return rank;
+}
+
+std::pair<size_t, size_t> FMIndex::Block::FindRows( const uint8_t* pattern, size_t patternLength ) const {
+	size_t first = 0, last = length + 1;
+	for( auto i = patternLength; i-- > 0 && first < last; ) {
+		first = symbolStarts[pattern[i]] + RankBWT( pattern[i], first );
+		last = symbolStarts[pattern[i]] + RankBWT( pattern[i], last );
+	}
+	return { first, std::max( first, last ) };
+}
+
+size_t FMIndex::Block::LocateRow( size_t row ) const {
+	// Walk backwards through the text until a sampled position is reached
+	size_t steps = 0;
+	while( !sampledRows.Get( row ) ) {
+		const auto symbol = bwt.Access( row );
+		row = symbolStarts[symbol] + RankBWT( symbol, row );
+		steps++;
+	}
+	return offset + samples[sampledRows.Rank1( row )] + steps;
+}
+
+void FMIndex::Block::Extract( size_t position, size_t count, uint8_t* destination ) const {
+	// The BWT symbol of a row is the byte before its suffix, row 0 is the empty suffix at the end
+	const auto end = std::min( ( position + count + sampleRate - 1 ) / sampleRate * sampleRate, length );
+	size_t row = end == length ? 0 : sampledPositionRows[end / sampleRate];
+	for( auto i = end; i > position; i-- ) {
+		const auto symbol = bwt.Access( row );
+		if( i <= position + count ) {
+			destination[i - 1 - position] = symbol;
+		}
+		row = symbolStarts[symbol] + RankBWT( symbol, row );
+	}
+}
+
+size_t FMIndex::Block::MemoryUsage( ) const {
+	return sizeof( Block ) + bwt.MemoryUsage( ) + sampledRows.MemoryUsage( ) + ( samples.capacity( ) + sampledPositionRows.capacity( ) ) * sizeof( uint32_t ) + overlapBytes.capacity( );
+}
+
+void FMIndex::Block::Save( std::ostream& stream ) const {
+	for( const auto value : { offset, length, overlap, sampleRate, primaryRow } ) {
+		WriteValue( stream, static_cast<uint64_t>( value ) );
+	}
+	for( const auto start : symbolStarts ) {
+		WriteValue( stream, static_cast<uint64_t>( start ) );
+	}
+	bwt.Save( stream );
+	sampledRows.Save( stream );
+	WriteVector( stream, samples );
+	WriteVector( stream, sampledPositionRows );
+	WriteVector( stream, overlapBytes );
+}
+
+bool FMIndex::Block::Load( std::istream& stream ) {
+	for( auto value : { &offset, &length, &overlap, &sampleRate, &primaryRow } ) {
+		uint64_t stored = 0;
+		if( !ReadValue( stream, stored ) ) {
+			return false;
+		}
+		*value = static_cast<size_t>( stored );
+	}
+	for( auto& start : symbolStarts ) {
+		uint64_t stored = 0;
+		if( !ReadValue( stream, stored ) ) {
+			return false;
+		}
+		start = static_cast<size_t>( stored );
+	}
+	if( !bwt.Load( stream ) || !sampledRows.Load( stream ) || !ReadVector( stream, samples ) || !ReadVector( stream, sampledPositionRows ) || !ReadVector( stream, overlapBytes ) ) {
+		return false;
+	}
+
+	// Queries index with these without further checks
+	if( sampleRate == 0 || primaryRow > length || bwt.Size( ) != length + 1 || sampledRows.Size( ) != length + 1 ) {
+		return false;
+	}
+	if( samples.size( ) != sampledRows.Rank1( sampledRows.Size( ) ) || std::ranges::any_of( samples, [&]( uint32_t sample ) { return sample > length; } ) ) {
+		return false;
+	}
+	if( sampledPositionRows.size( ) != ( length + sampleRate - 1 ) / sampleRate || std::ranges::any_of( sampledPositionRows, [&]( uint32_t row ) { return row > length; } ) || overlapBytes.size( ) != overlap ) {
+		return false;
+	}
+	return symbolStarts.front( ) == 1 && symbolStarts.back( ) == length + 1 && std::ranges::is_sorted( symbolStarts );
+}
+
+FMIndex::FMIndex( const ByteSnapshot& snapshot, size_t sampleRate ) {
+	// Blocks are built one after another so only one suffix array exists at a time
+	for( const auto& segment : snapshot.segments ) {
+		for( size_t start = 0; start < segment.size; start += BlockSize ) {
+			const auto end = std::min( segment.size, start + BlockSize + BlockOverlap );
+			const auto overlap = start + BlockSize < segment.size ? end - ( start + BlockSize ) : 0;
+			blocks.emplace_back( snapshot.bytes.data( ) + segment.offset + start, segment.offset + start, end - start, overlap, std::max<size_t>( sampleRate, 1 ) );
+		}
+	}
+}
+
+static size_t CountLinear( const uint8_t* data, size_t size, const uint8_t* pattern, size_t length ) {
+	size_t count = 0;
+	for( size_t i = 0; i + length <= size; i++ ) {
+		count += std::memcmp( data + i, pattern, length ) == 0;
+	}
+	return count;
+}
+
+uint64_t FMIndex::Count( const uint8_t* pattern, size_t length ) const {
+	length = std::min( length, BlockOverlap );
+	uint64_t count = 0;
+	for( const auto& block : blocks ) {
+		if( length == 0 ) {
+			count += block.length - block.overlap;
+			continue;
+		}
+		const auto [first, last] = block.FindRows( pattern, length );
+		count += last - first;
+		// Matches inside the overlap are found by the next block as well
+		if( block.overlap ) {
+			count -= CountLinear( block.overlapBytes.data( ), block.overlap, pattern, length );
+		}
+	}
+	return count;
+}
+
+std::pmr::vector<size_t> FMIndex::Locate( const uint8_t* pattern, size_t length, size_t maxMatches, std::pmr::memory_resource* memory ) const {
+	std::pmr::vector<size_t> matches( memory );
+	length = std::min( length, BlockOverlap );
+	for( const auto& block : blocks ) {
+		const auto [first, last] = block.FindRows( pattern, length );
+		for( auto row = first; row < last; row++ ) {
+			const auto position = block.LocateRow( row );
+			// Reported by the next block
+			if( block.overlap && position >= block.offset + block.length - block.overlap ) {
+				continue;
+			}
+			matches.push_back( position );
+		}
+	}
+	std::ranges::sort( matches );
+	if( matches.size( ) > maxMatches ) {
+		matches.resize( maxMatches );
+	}
+	return matches;
+}
+
+std::optional<std::pmr::vector<size_t>> FMIndex::FindMatches( const Signature& signature, size_t maxMatches, size_t maxCandidates, std::pmr::memory_resource* memory, Deadline deadline, bool* timedOut ) const {
+	// Longer signatures may not fit into a single block
+	if( signature.size( ) > BlockOverlap || std::ranges::any_of( signature, []( const auto& b ) { return IsJump( b ); } ) ) {
+		return std::nullopt;
+	}
+
+	// Rarest run of concrete bytes
+	std::pmr::vector<uint8_t> run( memory ), rarestRun( memory );
+	size_t rarestOffset = 0;
+	auto rarestCount = UINT64_MAX;
+	for( size_t i = 0; i <= signature.size( ); i++ ) {
+		if( i < signature.size( ) && !signature[i].isWildcard ) {
+			run.push_back( signature[i].value );
+			continue;
+		}
+		if( !run.empty( ) ) {
+			const auto count = Count( run.data( ), run.size( ) );
+			if( count < rarestCount ) {
+				rarestCount = count;
+				rarestRun = run;
+				rarestOffset = i - run.size( );
+			}
+			run.clear( );
+		}
+	}
+	if( rarestCount == 0 ) {
+		return std::pmr::vector<size_t>( memory );
+	}
+	// Signatures of only wildcards have no run to locate
+	if( rarestRun.empty( ) || rarestCount > maxCandidates ) {
+		return std::nullopt;
+	}
+
+	std::pmr::vector<size_t> matches( memory );
+	std::pmr::vector<uint8_t> data( signature.size( ), memory );
+	size_t verified = 0;
+	for( const auto position : Locate( rarestRun.data( ), rarestRun.size( ), SIZE_MAX, memory ) ) {
+		// Only callers raising maxCandidates verify enough candidates for the clock to matter
+		if( ++verified % DefaultMaxCandidates == 0 && IsDeadlineExpired( deadline ) ) {
+			if( timedOut ) {
+				*timedOut = true;
+			}
+			break;
+		}
+		if( position < rarestOffset ) {
+			continue;
+		}
+		// The last block starting before the match holds all of it, unless it crosses the end of a segment
+		const auto start = position - rarestOffset;
+		const auto next = std::ranges::upper_bound( blocks, start, { }, &Block::offset );
+		if( next == blocks.begin( ) ) {
+			continue;
+		}
+		const auto& block = *std::prev( next );
+		if( start + signature.size( ) > block.offset + block.length ) {
+			continue;
+		}
+		block.Extract( start - block.offset, signature.size( ), data.data( ) );
+		if( std::ranges::all_of( std::views::iota( size_t( 0 ), signature.size( ) ), [&]( size_t i ) { return signature[i].isWildcard || data[i] == signature[i].value; } ) ) {
+			matches.push_back( start );
+			if( matches.size( ) >= maxMatches ) {
+				break;
+			}
+		}
+	}
+	return matches;
+}
+
+size_t FMIndex::MemoryUsage( ) const {
+	size_t usage = 0;
+	for( const auto& block : blocks ) {
+		usage += block.MemoryUsage( );
+	}
+	return usage;
+}
+
+void FMIndex::Save( std::ostream& stream ) const {
+	WriteValue( stream, static_cast<uint64_t>( blocks.size( ) ) );
+	for( const auto& block : blocks ) {
+		block.Save( stream );
+	}
+}
+
+std::expected<FMIndex, std::string> FMIndex::Load( std::istream& stream, const ByteSnapshot& snapshot ) {
+	uint64_t blockCount = 0;
+	if( !ReadValue( stream, blockCount ) || blockCount > snapshot.bytes.size( ) / BlockSize + snapshot.segments.size( ) ) {
+		return std::unexpected( "Invalid FM-index block count" );
+	}
+	std::vector<Block> blocks( static_cast<size_t>( blockCount ) );
+	for( auto& block : blocks ) {
+		if( !block.Load( stream ) ) {
+			return std::unexpected( "Truncated FM-index block" );
+		}
+		if( block.offset > snapshot.bytes.size( ) || block.length > snapshot.bytes.size( ) - block.offset || block.overlap > block.length ) {
+			return std::unexpected( "FM-index block outside of the image" );
+		}
+	}
+	// FindMatches looks blocks up by offset
+	if( !std::ranges::is_sorted( blocks, { }, &Block::offset ) ) {
+		return std::unexpected( "FM-index blocks out of order" );
+	}
+	return FMIndex( std::move( blocks ) );
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <expected>
+#include <istream>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ByteSnapshot.h"
+#include "SignatureTypes.h"
+#include "Utils.h"
+
+#ifndef SIGMAKER_FM_BLOCK_SIZE
+#	define SIGMAKER_FM_BLOCK_SIZE ( 32 << 20 )
+#endif
+
+// Compressed full text index over the snapshot for machines that can not afford a suffix array
+// The BWT is kept in a Huffman shaped wavelet tree together with a suffix array sampled every N text positions
+// Counting a byte string takes time proportional to its length, locating each match up to N extra steps
+// Candidates are verified against text extracted from the index, so the bytes of the snapshot are only read while building
+// This module does not depend on the IDA SDK
+
+// Bit vector with rank support, one 32 bit count per 512 bits
+class RankBitVector {
+public:
+	void PushBack( bool bit );
+	// Has to be called once after the last PushBack
+	void BuildRank( );
+
+	bool Get( size_t i ) const {
+		return ( words[i / 64] >> ( i % 64 ) ) & 1;
+	}
+	// Ones in [0, i)
+	size_t Rank1( size_t i ) const;
+	size_t Size( ) const {
+		return size;
+	}
+	size_t MemoryUsage( ) const {
+		return words.capacity( ) * sizeof( uint64_t ) + blockRanks.capacity( ) * sizeof( uint32_t );
+	}
+
+	void Save( std::ostream& stream ) const;
+	bool Load( std::istream& stream );
+
+private:
+	std::vector<uint64_t> words;
+	std::vector<uint32_t> blockRanks;
+	size_t size = 0;
+};
+
+// Frequent symbols get short codes, so the tree needs about the zero order entropy in bits per symbol
+class HuffmanWaveletTree {
+public:
+	HuffmanWaveletTree( ) = default;
+	explicit HuffmanWaveletTree( const std::vector<uint8_t>& sequence );
+
+	// Occurences of symbol in [0, i)
+	size_t Rank( uint8_t symbol, size_t i ) const;
+	uint8_t Access( size_t i ) const;
+	size_t Size( ) const {
+		return nodes.empty( ) ? 0 : nodes.front( ).bits.Size( );
+	}
+	size_t MemoryUsage( ) const;
+
+	void Save( std::ostream& stream ) const;
+	bool Load( std::istream& stream );
+
+private:
+	typedef struct {
+		RankBitVector bits;
+		int32_t children[2];	// Leaves are stored as -( symbol + 1 )
+	} Node;
+
+	std::vector<Node> nodes;				// Root first
+	std::array<uint64_t, 256> codes{};		// Path from the root, first step in the lowest bit
+	std::array<uint8_t, 256> codeLengths{};	// 0 for symbols that do not occur
+};
+
+class FMIndex {
+public:
+	// Up to 64 steps to locate a match or extract bytes, the two sample arrays take 8 bytes per 64 bytes of code
+	static constexpr size_t DefaultSampleRate = 64;
+	// Construction memory is bounded by the block size, about 14 bytes per byte of a block
+	// The engine test shrinks it with SIGMAKER_FM_BLOCK_SIZE so small images span several blocks
+	static constexpr size_t BlockSize = SIGMAKER_FM_BLOCK_SIZE;
+	// Blocks of a segment overlap by this much, longer strings are only counted by their first BlockOverlap bytes
+	static constexpr size_t BlockOverlap = 4096;
+	// Signatures whose rarest run has more matches are left to other searches
+	static constexpr size_t DefaultMaxCandidates = 64;
+
+	explicit FMIndex( const ByteSnapshot& snapshot, size_t sampleRate = DefaultSampleRate );
+
+	// Exact for strings up to BlockOverlap bytes, an upper bound for longer ones
+	uint64_t Count( const uint8_t* pattern, size_t length ) const;
+	// Sorted snapshot offsets of the matches, stops after maxMatches
+	std::pmr::vector<size_t> Locate( const uint8_t* pattern, size_t length, size_t maxMatches = SIZE_MAX, std::pmr::memory_resource* memory = std::pmr::get_default_resource( ) ) const;
+
+	// Counts the concrete runs of the signature and verifies the matches of the rarest one
+	// Returns nothing if even the rarest run has more than maxCandidates matches, for signatures with jumps or only wildcards and for those longer than BlockOverlap
+	// The result and the temporaries are allocated from memory, once the deadline expires it holds the matches verified so far and timedOut is set
+	std::optional<std::pmr::vector<size_t>> FindMatches( const Signature& signature, size_t maxMatches = SIZE_MAX, size_t maxCandidates = DefaultMaxCandidates, std::pmr::memory_resource* memory = std::pmr::get_default_resource( ), Deadline deadline = NoDeadline, bool* timedOut = nullptr ) const;
+
+	size_t MemoryUsage( ) const;
+
+	// For the index cache, the snapshot has to be the one the index was built from
+	void Save( std::ostream& stream ) const;
+	static std::expected<FMIndex, std::string> Load( std::istream& stream, const ByteSnapshot& snapshot );
+
+private:
+	class Block {
+	public:
+		Block( ) = default;
+		Block( const uint8_t* text, size_t offset, size_t length, size_t overlap, size_t sampleRate );
+
+		// Rows of the BWT whose suffixes start with the pattern, [first, second)
+		std::pair<size_t, size_t> FindRows( const uint8_t* pattern, size_t length ) const;
+		// Snapshot offset of the suffix in a row
+		size_t LocateRow( size_t row ) const;
+		// Copies the bytes at [position, position + count) of the block, walking backwards from the next sampled position
+		void Extract( size_t position, size_t count, uint8_t* destination ) const;
+		size_t MemoryUsage( ) const;
+
+		void Save( std::ostream& stream ) const;
+		bool Load( std::istream& stream );
+
+		size_t offset;		// Snapshot offset of the first byte
+		size_t length;
+		size_t overlap;		// Bytes at the end that the next block starts with
+		std::vector<uint8_t> overlapBytes;	// Copy of them, Count removes the matches inside
+
+	private:
+		size_t RankBWT( uint8_t symbol, size_t row ) const;
+
+		size_t sampleRate;
+		size_t primaryRow;	// Row of the whole block, its BWT symbol is the terminator which is stored as 0
+		std::array<size_t, 257> symbolStarts{};	// First row of the suffixes starting with each symbol
+		HuffmanWaveletTree bwt;
+		RankBitVector sampledRows;		// Rows whose suffix starts at a multiple of sampleRate
+		std::vector<uint32_t> samples;	// Their positions, in row order
+		std::vector<uint32_t> sampledPositionRows;	// Row of the suffix at each multiple of sampleRate, in text order
+	};
+
+	explicit FMIndex( std::vector<Block> blocks ) : blocks( std::move( blocks ) ) {
+	}
+
+	std::vector<Block> blocks;	// Sorted by offset
+};
@@ -0,0 +1,113 @@
+#include "Fingerprint.h"
+#include "BinaryIO.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <fstream>
+
+// File layout, little endian:
+//   magic, version, operand type bitmask, function count
+//   per function: hash, address, size, name length, name
+constexpr char FingerprintFileMagic[4] = { 'S', 'M', 'F', 'P' };
+// Version 2 hashes the data inside functions as concrete bytes
+constexpr uint32_t FingerprintFileVersion = 2;
+
+uint64_t HashNormalizedFunction( const Signature& normalized ) {
+	// FNV-1a, over 9 bit symbols so wildcards never collide with a concrete byte
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for( const auto& b : normalized ) {
+		const uint32_t symbol = b.isWildcard ? 0x100 : b.value;
+		hash = ( hash ^ ( symbol & 0xFF ) ) * 0x100000001B3ull;
+		hash = ( hash ^ ( symbol >> 8 ) ) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+FingerprintIndex::FingerprintIndex( std::vector<FunctionFingerprint> functionFingerprints, uint32_t operandTypeBitmask )
+	: fingerprints( std::move( functionFingerprints ) ), operandTypeBitmask( operandTypeBitmask ) {
+	std::ranges::stable_sort( fingerprints, {}, &FunctionFingerprint::hash );
+	for( size_t i = 0; i < fingerprints.size( ); ) {
+		auto end = i + 1;
+		while( end < fingerprints.size( ) && fingerprints[end].hash == fingerprints[i].hash ) {
+			end++;
+		}
+		ranges.emplace( fingerprints[i].hash, std::pair{ static_cast<uint32_t>( i ), static_cast<uint32_t>( end - i ) } );
+		i = end;
+	}
+}
+
+std::span<const FunctionFingerprint> FingerprintIndex::Find( uint64_t hash ) const {
+	const auto it = ranges.find( hash );
+	if( it == ranges.end( ) ) {
+		return {};
+	}
+	return std::span( fingerprints ).subspan( it->second.first, it->second.second );
+}
+
+std::expected<void, std::string> FingerprintIndex::Save( const std::string& path ) const {
+	std::ofstream file( path, std::ios::binary | std::ios::trunc );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+
+	file.write( FingerprintFileMagic, sizeof( FingerprintFileMagic ) );
+	WriteValue( file, FingerprintFileVersion );
+	WriteValue( file, operandTypeBitmask );
+	WriteValue( file, static_cast<uint32_t>( fingerprints.size( ) ) );
+	for( const auto& fingerprint : fingerprints ) {
+		const auto nameLength = static_cast<uint16_t>( std::min<size_t>( fingerprint.name.size( ), UINT16_MAX ) );
+		WriteValue( file, fingerprint.hash );
+		WriteValue( file, fingerprint.address );
+		WriteValue( file, fingerprint.size );
+		WriteValue( file, nameLength );
+		file.write( fingerprint.name.data( ), nameLength );
+	}
+
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to write {}", path ) );
+	}
+	return {};
+}
+
+std::expected<FingerprintIndex, std::string> FingerprintIndex::Load( const std::string& path ) {
+	std::ifstream file( path, std::ios::binary );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+
+	char magic[sizeof( FingerprintFileMagic )] = {};
+	uint32_t version = 0, bitmask = 0, count = 0;
+	if( !file.read( magic, sizeof( magic ) ) || std::memcmp( magic, FingerprintFileMagic, sizeof( magic ) ) != 0 ) {
+		return std::unexpected( std::format( "{} is not a fingerprint file", path ) );
+	}
+	if( !ReadValue( file, version ) || version != FingerprintFileVersion ) {
+		return std::unexpected( std::format( "{} has unsupported version {}", path, version ) );
+	}
+	if( !ReadValue( file, bitmask ) || !ReadValue( file, count ) ) {
+		return std::unexpected( std::format( "{} is truncated", path ) );
+	}
+
+	// Every record takes at least its fixed fields, so a damaged count cannot cause a huge allocation
+	constexpr uint64_t MinimumRecordSize = sizeof( uint64_t ) + sizeof( uint64_t ) + sizeof( uint32_t ) + sizeof( uint16_t );
+	const auto position = file.tellg( );
+	file.seekg( 0, std::ios::end );
+	const auto remaining = static_cast<uint64_t>( file.tellg( ) - position );
+	file.seekg( position );
+	if( !file || count > remaining / MinimumRecordSize ) {
+		return std::unexpected( std::format( "{} is truncated", path ) );
+	}
+
+	std::vector<FunctionFingerprint> fingerprints( count );
+	for( auto& fingerprint : fingerprints ) {
+		uint16_t nameLength = 0;
+		if( !ReadValue( file, fingerprint.hash ) || !ReadValue( file, fingerprint.address ) || !ReadValue( file, fingerprint.size ) || !ReadValue( file, nameLength ) ) {
+			return std::unexpected( std::format( "{} is truncated", path ) );
+		}
+		fingerprint.name.resize( nameLength );
+		if( !file.read( fingerprint.name.data( ), nameLength ) ) {
+			return std::unexpected( std::format( "{} is truncated", path ) );
+		}
+	}
+	return FingerprintIndex( std::move( fingerprints ), bitmask );
+}
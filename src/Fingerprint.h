@@ -0,0 +1,50 @@
+#pragma once
+
+#include <expected>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SignatureTypes.h"
+
+// Hashes of normalized function bodies, to find functions that did not change between builds without signatures
+// This module does not depend on the IDA SDK, addresses are plain integers
+
+typedef struct {
+	uint64_t hash;
+	uint64_t address;	// Function start
+	uint32_t size;		// Length of the normalized instruction stream
+	std::string name;
+} FunctionFingerprint;
+
+// Functions shorter than this are mostly thunks and stubs that are identical everywhere
+constexpr size_t MinFingerprintSize = 8;
+
+// Hash of a normalized instruction stream, wildcards hash differently from any concrete byte
+uint64_t HashNormalizedFunction( const Signature& normalized );
+
+class FingerprintIndex {
+public:
+	FingerprintIndex( ) = default;
+	// Operands in the fingerprints were masked with this bitmask, indices built with different ones do not match
+	FingerprintIndex( std::vector<FunctionFingerprint> fingerprints, uint32_t operandTypeBitmask );
+
+	static std::expected<FingerprintIndex, std::string> Load( const std::string& path );
+	std::expected<void, std::string> Save( const std::string& path ) const;
+
+	// All functions with this hash, more than one means the fingerprint is ambiguous
+	std::span<const FunctionFingerprint> Find( uint64_t hash ) const;
+
+	const std::vector<FunctionFingerprint>& Fingerprints( ) const {
+		return fingerprints;
+	}
+	uint32_t OperandTypeBitmask( ) const {
+		return operandTypeBitmask;
+	}
+
+private:
+	std::vector<FunctionFingerprint> fingerprints; // Sorted by hash
+	std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> ranges; // Hash to first index and count
+	uint32_t operandTypeBitmask = 0;
+};
@@ -0,0 +1,181 @@
+#include "FuzzySearch.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+
+// Pigeonhole filter runs shorter than this match too often to be worth it
+constexpr size_t MinFilterRunLength = 3;
+
+// Number of mismatching concrete bytes at offset, stops counting above maxMismatches
+static size_t CountMismatches( const uint8_t* data, const Signature& signature, size_t maxMismatches ) {
+	size_t mismatches = 0;
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		if( !signature[i].isWildcard && data[i] != signature[i].value ) {
+			if( ++mismatches > maxMismatches ) {
+				break;
+			}
+		}
+	}
+	return mismatches;
+}
+
+// Bit-parallel Hamming matcher (bitap with one state word per allowed mismatch), patterns up to 64 bytes
+static void FindFuzzyMatchesBitap( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMismatches, std::vector<FuzzyMatch>& matches ) {
+	const auto length = signature.size( );
+	const auto matchBit = 1ULL << ( length - 1 );
+
+	// Bit j is set if byte value c is accepted at pattern position j
+	std::array<uint64_t, 256> byteMasks{};
+	for( size_t j = 0; j < length; j++ ) {
+		for( size_t c = 0; c < 256; c++ ) {
+			if( signature[j].isWildcard || signature[j].value == c ) {
+				byteMasks[c] |= 1ULL << j;
+			}
+		}
+	}
+
+	std::array<uint64_t, MaxFuzzyMismatches + 1> states{};
+	for( const auto& segment : snapshot.segments ) {
+		if( segment.size < length ) {
+			continue;
+		}
+		states.fill( 0 );
+
+		const auto data = snapshot.bytes.data( ) + segment.offset;
+		for( size_t i = 0; i < segment.size; i++ ) {
+			const auto byteMask = byteMasks[data[i]];
+			// states[d] bit j: pattern[0..j] ends here with at most d mismatches
+			auto previous = states[0];
+			states[0] = ( ( states[0] << 1 ) | 1 ) & byteMask;
+			for( size_t d = 1; d <= maxMismatches; d++ ) {
+				const auto current = states[d];
+				states[d] = ( ( ( current << 1 ) | 1 ) & byteMask ) | ( ( previous << 1 ) | 1 );
+				previous = current;
+			}
+
+			if( i + 1 < length || ( states[maxMismatches] & matchBit ) == 0 ) {
+				continue;
+			}
+			for( size_t d = 0; d <= maxMismatches; d++ ) {
+				if( states[d] & matchBit ) {
+					matches.push_back( FuzzyMatch{ segment.offset + i + 1 - length, d } );
+					break;
+				}
+			}
+		}
+	}
+}
+
+// Splits the concrete bytes into maxMismatches + 1 blocks, one of them has to match exactly
+// Returns the longest concrete run of each block as { position, length }
+static std::vector<std::pair<size_t, size_t>> GetPigeonholeRuns( const Signature& signature, size_t maxMismatches ) {
+	std::vector<size_t> concretePositions;
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		if( !signature[i].isWildcard ) {
+			concretePositions.push_back( i );
+		}
+	}
+
+	std::vector<std::pair<size_t, size_t>> runs;
+	const auto blockCount = maxMismatches + 1;
+	for( size_t block = 0; block < blockCount; block++ ) {
+		const auto first = block * concretePositions.size( ) / blockCount;
+		const auto last = ( block + 1 ) * concretePositions.size( ) / blockCount;
+
+		std::pair<size_t, size_t> best{ 0, 0 };
+		for( size_t i = first; i < last; ) {
+			auto j = i + 1;
+			while( j < last && concretePositions[j] == concretePositions[j - 1] + 1 ) {
+				j++;
+			}
+			if( j - i > best.second ) {
+				best = { concretePositions[i], j - i };
+			}
+			i = j;
+		}
+		runs.push_back( best );
+	}
+	return runs;
+}
+
+static void FindFuzzyMatchesFiltered( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMismatches, const std::vector<std::pair<size_t, size_t>>& runs, std::vector<FuzzyMatch>& matches ) {
+	const auto length = signature.size( );
+	std::vector<size_t> candidates;
+
+	for( const auto& [runPosition, runLength] : runs ) {
+		std::vector<uint8_t> run;
+		for( size_t i = 0; i < runLength; i++ ) {
+			run.push_back( signature[runPosition + i].value );
+		}
+		const std::boyer_moore_horspool_searcher searcher( run.begin( ), run.end( ) );
+
+		for( const auto& segment : snapshot.segments ) {
+			if( segment.size < length ) {
+				continue;
+			}
+			const auto begin = snapshot.bytes.begin( ) + segment.offset;
+			const auto end = begin + segment.size;
+			for( auto it = std::search( begin, end, searcher ); it != end; it = std::search( it + 1, end, searcher ) ) {
+				const auto runOffset = static_cast<size_t>( it - begin );
+				if( runOffset < runPosition || runOffset - runPosition + length > segment.size ) {
+					continue;
+				}
+				const auto candidate = segment.offset + runOffset - runPosition;
+				if( CountMismatches( snapshot.bytes.data( ) + candidate, signature, maxMismatches ) <= maxMismatches ) {
+					candidates.push_back( candidate );
+				}
+			}
+		}
+	}
+
+	// The same position can be found through several blocks
+	std::ranges::sort( candidates );
+	const auto [first, last] = std::ranges::unique( candidates );
+	candidates.erase( first, last );
+
+	for( const auto candidate : candidates ) {
+		matches.push_back( FuzzyMatch{ candidate, CountMismatches( snapshot.bytes.data( ) + candidate, signature, maxMismatches ) } );
+	}
+}
+
+static void FindFuzzyMatchesLinear( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMismatches, std::vector<FuzzyMatch>& matches ) {
+	const auto length = signature.size( );
+	for( const auto& segment : snapshot.segments ) {
+		for( size_t i = 0; i + length <= segment.size; i++ ) {
+			const auto distance = CountMismatches( snapshot.bytes.data( ) + segment.offset + i, signature, maxMismatches );
+			if( distance <= maxMismatches ) {
+				matches.push_back( FuzzyMatch{ segment.offset + i, distance } );
+			}
+		}
+	}
+}
+
+std::vector<FuzzyMatch> FindFuzzyMatches( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMismatches ) {
+	std::vector<FuzzyMatch> matches;
+	if( signature.empty( ) ) {
+		return matches;
+	}
+	maxMismatches = std::min( maxMismatches, MaxFuzzyMismatches );
+
+	// Exact runs are cheap to find with a skip table, use them whenever they are selective enough
+	const auto runs = GetPigeonholeRuns( signature, maxMismatches );
+	const auto shortestRun = std::ranges::min( runs, {}, []( const auto& run ) { return run.second; } ).second;
+	if( shortestRun >= MinFilterRunLength ) {
+		FindFuzzyMatchesFiltered( snapshot, signature, maxMismatches, runs, matches );
+	}
+	else if( signature.size( ) <= 64 ) {
+		FindFuzzyMatchesBitap( snapshot, signature, maxMismatches, matches );
+	}
+	else {
+		FindFuzzyMatchesLinear( snapshot, signature, maxMismatches, matches );
+	}
+
+	std::ranges::sort( matches, []( const auto& a, const auto& b ) {
+		if( a.distance != b.distance ) {
+			return a.distance < b.distance;
+		}
+		return a.offset < b.offset;
+	} );
+	return matches;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ByteSnapshot.h"
+#include "SignatureTypes.h"
+
+// Approximate signature search, finds positions where at most N concrete bytes differ
+
+constexpr size_t MaxFuzzyMismatches = 4;
+
+typedef struct {
+	size_t offset;		// Position in the snapshot
+	size_t distance;	// Number of mismatching concrete bytes
+} FuzzyMatch;
+
+// Results are sorted by distance, then position
+std::vector<FuzzyMatch> FindFuzzyMatches( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMismatches );
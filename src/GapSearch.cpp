@@ -0,0 +1,226 @@
+#include "GapSearch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <set>
+
+// Fixed part of a signature between two jumps
+typedef struct {
+	size_t begin;		// Range in the signature
+	size_t end;
+	size_t jumpMin;		// Gap to the next fragment
+	size_t jumpMax;
+	size_t anchor;		// Rarest concrete byte relative to begin, SIZE_MAX if the fragment only has wildcards
+} SignatureFragment;
+
+bool HasJumps( const Signature& signature ) {
+	return std::ranges::any_of( signature, []( const auto& b ) { return IsJump( b ); } );
+}
+
+// Leading and trailing jumps do not constrain a match and are dropped, adjacent jumps are merged
+static std::vector<SignatureFragment> SplitFragments( const ByteSnapshot& snapshot, const Signature& signature ) {
+	std::vector<SignatureFragment> fragments;
+	size_t begin = SIZE_MAX;
+	for( size_t i = 0; i <= signature.size( ); i++ ) {
+		const auto isEnd = i == signature.size( );
+		if( !isEnd && !IsJump( signature[i] ) ) {
+			if( begin == SIZE_MAX ) {
+				begin = i;
+			}
+			continue;
+		}
+		if( begin != SIZE_MAX ) {
+			fragments.push_back( SignatureFragment{ begin, i, 0, 0, SIZE_MAX } );
+			begin = SIZE_MAX;
+		}
+		if( !isEnd && !fragments.empty( ) ) {
+			fragments.back( ).jumpMin += signature[i].jumpMin;
+			fragments.back( ).jumpMax += signature[i].jumpMax;
+		}
+	}
+	if( !fragments.empty( ) ) {
+		fragments.back( ).jumpMin = fragments.back( ).jumpMax = 0;
+	}
+
+	for( auto& fragment : fragments ) {
+		for( size_t i = fragment.begin; i < fragment.end; i++ ) {
+			if( !signature[i].isWildcard && ( fragment.anchor == SIZE_MAX || snapshot.histogram[signature[i].value] < snapshot.histogram[signature[fragment.begin + fragment.anchor].value] ) ) {
+				fragment.anchor = i - fragment.begin;
+			}
+		}
+	}
+	return fragments;
+}
+
+// Expected number of matches of a fragment if bytes were independent, log scale
+static double EstimateFragmentMatches( const ByteSnapshot& snapshot, const Signature& signature, const SignatureFragment& fragment ) {
+	const auto total = static_cast<double>( std::max<size_t>( snapshot.bytes.size( ), 1 ) );
+	auto estimate = std::log( total );
+	for( size_t i = fragment.begin; i < fragment.end; i++ ) {
+		if( !signature[i].isWildcard ) {
+			estimate += std::log( std::max<double>( static_cast<double>( snapshot.histogram[signature[i].value] ), 0.5 ) / total );
+		}
+	}
+	return estimate;
+}
+
+static bool MatchesFragment( const uint8_t* data, const Signature& signature, const SignatureFragment& fragment ) {
+	for( size_t i = fragment.begin; i < fragment.end; i++ ) {
+		if( !signature[i].isWildcard && data[i - fragment.begin] != signature[i].value ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+class GapMatcher {
+public:
+	GapMatcher( const ByteSnapshot& snapshot, const Signature& signature, const std::vector<SignatureFragment>& fragments, const SnapshotSegment& segment )
+		: snapshot( snapshot ), signature( signature ), fragments( fragments ), segment( segment ) {
+	}
+
+	// Calls callback( position ) for every match of a fragment starting in [first, last], stops if it returns true
+	template<typename Callback>
+	bool ForEachFragmentMatch( size_t index, size_t first, size_t last, Callback&& callback ) const {
+		const auto& fragment = fragments[index];
+		const auto length = fragment.end - fragment.begin;
+		const auto segmentEnd = segment.offset + segment.size;
+		if( first < segment.offset ) {
+			first = segment.offset;
+		}
+		if( segmentEnd < length ) {
+			return false;
+		}
+		last = std::min( last, segmentEnd - length );
+		if( first > last ) {
+			return false;
+		}
+
+		// Fragment of wildcards matches everywhere
+		if( fragment.anchor == SIZE_MAX ) {
+			for( auto position = first; position <= last; position++ ) {
+				if( callback( position ) ) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Bounded window search, skip to the anchor byte
+		const auto anchorValue = signature[fragment.begin + fragment.anchor].value;
+		auto position = first;
+		while( position <= last ) {
+			const auto data = snapshot.bytes.data( );
+			const auto found = static_cast<const uint8_t*>( std::memchr( data + position + fragment.anchor, anchorValue, last - position + 1 ) );
+			if( !found ) {
+				break;
+			}
+			position = static_cast<size_t>( found - data ) - fragment.anchor;
+			if( MatchesFragment( data + position, signature, fragment ) && callback( position ) ) {
+				return true;
+			}
+			position++;
+		}
+		return false;
+	}
+
+	// Checks if the fragments after index can be placed after a fragment ending at end
+	bool MatchesRight( size_t index, size_t end ) const {
+		if( index == fragments.size( ) ) {
+			return true;
+		}
+		const auto& previous = fragments[index - 1];
+		return ForEachFragmentMatch( index, end + previous.jumpMin, end + previous.jumpMax, [&]( size_t position ) {
+			return MatchesRight( index + 1, position + fragments[index].end - fragments[index].begin );
+		} );
+	}
+
+	// Collects all possible match starts for a fragment before index placed at position
+	void CollectStarts( size_t index, size_t position, std::set<size_t>& starts ) const {
+		if( index == 0 ) {
+			starts.insert( position );
+			return;
+		}
+		const auto& fragment = fragments[index - 1];
+		const auto length = fragment.end - fragment.begin;
+		if( position < length + fragment.jumpMin ) {
+			return;
+		}
+		const auto last = position - length - fragment.jumpMin;
+		const auto first = position >= length + fragment.jumpMax ? position - length - fragment.jumpMax : 0;
+		ForEachFragmentMatch( index - 1, first, last, [&]( size_t previousPosition ) {
+			CollectStarts( index - 1, previousPosition, starts );
+			return false;
+		} );
+	}
+
+private:
+	const ByteSnapshot& snapshot;
+	const Signature& signature;
+	const std::vector<SignatureFragment>& fragments;
+	const SnapshotSegment& segment;
+};
+
+// Reading the clock for every match of the rarest fragment would cost more than matching it
+constexpr size_t DeadlineCheckInterval = 1024;
+
+std::vector<size_t> FindGapSignatureMatches( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMatches, Deadline deadline, bool* timedOut ) {
+	const auto fragments = SplitFragments( snapshot, signature );
+	if( fragments.empty( ) || maxMatches == 0 ) {
+		return {};
+	}
+
+	// Only the rarest fragment is searched in the whole image, the others in windows around it
+	size_t rarest = 0;
+	auto rarestEstimate = EstimateFragmentMatches( snapshot, signature, fragments[0] );
+	for( size_t i = 1; i < fragments.size( ); i++ ) {
+		const auto estimate = EstimateFragmentMatches( snapshot, signature, fragments[i] );
+		if( estimate < rarestEstimate ) {
+			rarest = i;
+			rarestEstimate = estimate;
+		}
+	}
+	const auto rarestLength = fragments[rarest].end - fragments[rarest].begin;
+	// Farthest the rarest fragment can be from the match start
+	size_t rarestMaxOffset = 0;
+	for( size_t i = 0; i < rarest; i++ ) {
+		rarestMaxOffset += fragments[i].end - fragments[i].begin + fragments[i].jumpMax;
+	}
+
+	std::set<size_t> starts;
+	size_t candidates = 0;
+	bool isTimedOut = false;
+	for( const auto& segment : snapshot.segments ) {
+		const GapMatcher matcher( snapshot, signature, fragments, segment );
+		matcher.ForEachFragmentMatch( rarest, segment.offset, segment.offset + segment.size, [&]( size_t position ) {
+			if( ++candidates % DeadlineCheckInterval == 0 && IsDeadlineExpired( deadline ) ) {
+				isTimedOut = true;
+				return true;
+			}
+			// Starts found from here on are past the first maxMatches ones
+			if( starts.size( ) >= maxMatches && position > *starts.rbegin( ) + rarestMaxOffset ) {
+				return true;
+			}
+			if( matcher.MatchesRight( rarest + 1, position + rarestLength ) ) {
+				matcher.CollectStarts( rarest, position, starts );
+				// One position of the rarest fragment can complete several matches, only the first maxMatches are kept
+				while( starts.size( ) > maxMatches ) {
+					starts.erase( std::prev( starts.end( ) ) );
+				}
+			}
+			return false;
+		} );
+		if( starts.size( ) >= maxMatches || isTimedOut ) {
+			break;
+		}
+		if( IsDeadlineExpired( deadline ) ) {
+			isTimedOut = true;
+			break;
+		}
+	}
+	if( timedOut && isTimedOut ) {
+		*timedOut = true;
+	}
+	return std::vector<size_t>( starts.begin( ), starts.end( ) );
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "ByteSnapshot.h"
+#include "SignatureTypes.h"
+#include "Utils.h"
+
+// Search for signatures containing variable length jumps like "E8 ? ? ? ? [2-6] 48 8B"
+
+bool HasJumps( const Signature& signature );
+
+// Returns the snapshot offsets of all match starts, sorted, only those found so far and sets timedOut once the deadline expires
+std::vector<size_t> FindGapSignatureMatches( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMatches = SIZE_MAX, Deadline deadline = NoDeadline, bool* timedOut = nullptr );
@@ -0,0 +1,141 @@
+#include "IndexCache.h"
+#include "BinaryIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <vector>
+
+// File layout, native byte order:
+//   magic, version, image hash, image size, kind, parameters
+//   the index as written by its Save function
+// Files are named after the key, so the header only guards against damaged or foreign files
+constexpr char IndexFileMagic[4] = { 'S', 'M', 'I', 'X' };
+// Has to change whenever the Save format of any index changes
+constexpr uint32_t IndexFileVersion = 1;
+constexpr auto IndexFileExtension = ".sigidx";
+// Temporary files of stores that crashed or were killed, live ones are written to continuously
+constexpr auto StaleTemporaryAge = std::chrono::minutes( 10 );
+
+std::filesystem::path IndexCache::PathOf( const IndexCacheKey& key ) const {
+	return directory / std::format( "{:016X}-{}-{}-{}-v{}{}", key.imageHash, key.imageSize, static_cast<uint32_t>( key.kind ), key.parameters, IndexFileVersion, IndexFileExtension );
+}
+
+std::optional<std::ifstream> IndexCache::Open( const IndexCacheKey& key ) const {
+	if( !IsEnabled( ) ) {
+		return std::nullopt;
+	}
+	const auto path = PathOf( key );
+	std::ifstream file( path, std::ios::binary );
+	if( !file ) {
+		return std::nullopt;
+	}
+
+	char magic[sizeof( IndexFileMagic )] = {};
+	uint32_t version = 0, kind = 0, parameters = 0;
+	uint64_t imageHash = 0, imageSize = 0;
+	if( !file.read( magic, sizeof( magic ) ) || std::memcmp( magic, IndexFileMagic, sizeof( magic ) ) != 0
+		|| !ReadValue( file, version ) || !ReadValue( file, imageHash ) || !ReadValue( file, imageSize ) || !ReadValue( file, kind ) || !ReadValue( file, parameters )
+		|| version != IndexFileVersion || imageHash != key.imageHash || imageSize != key.imageSize || kind != static_cast<uint32_t>( key.kind ) || parameters != key.parameters ) {
+		return std::nullopt;
+	}
+
+	// The modification time orders the files for eviction
+	std::error_code error;
+	std::filesystem::last_write_time( path, std::filesystem::file_time_type::clock::now( ), error );
+	return file;
+}
+
+std::expected<void, std::string> IndexCache::Store( const IndexCacheKey& key, const std::function<void( std::ostream& )>& write ) {
+	if( !IsEnabled( ) ) {
+		return {};
+	}
+	std::error_code error;
+	std::filesystem::create_directories( directory, error );
+	if( error ) {
+		return std::unexpected( std::format( "Failed to create {}: {}", directory.string( ), error.message( ) ) );
+	}
+
+	const auto path = PathOf( key );
+	auto temporaryPath = path;
+	temporaryPath += std::format( ".{}.tmp", std::chrono::steady_clock::now( ).time_since_epoch( ).count( ) );
+	{
+		std::ofstream file( temporaryPath, std::ios::binary | std::ios::trunc );
+		if( !file ) {
+			return std::unexpected( std::format( "Failed to open {}", temporaryPath.string( ) ) );
+		}
+		file.write( IndexFileMagic, sizeof( IndexFileMagic ) );
+		WriteValue( file, IndexFileVersion );
+		WriteValue( file, key.imageHash );
+		WriteValue( file, key.imageSize );
+		WriteValue( file, static_cast<uint32_t>( key.kind ) );
+		WriteValue( file, key.parameters );
+		write( file );
+		if( !file.flush( ) ) {
+			file.close( );
+			std::filesystem::remove( temporaryPath, error );
+			return std::unexpected( std::format( "Failed to write {}", temporaryPath.string( ) ) );
+		}
+	}
+
+	std::filesystem::rename( temporaryPath, path, error );
+	if( error ) {
+		std::filesystem::remove( temporaryPath, error );
+		return std::unexpected( std::format( "Failed to store {}", path.string( ) ) );
+	}
+	Evict( );
+	return {};
+}
+
+void IndexCache::Remove( const IndexCacheKey& key ) const {
+	std::error_code error;
+	std::filesystem::remove( PathOf( key ), error );
+}
+
+void IndexCache::Evict( ) const {
+	typedef struct {
+		std::filesystem::path path;
+		std::filesystem::file_time_type lastUse;
+		uint64_t size;
+	} CachedFile;
+
+	std::vector<CachedFile> files;
+	uint64_t totalSize = 0;
+	std::error_code error;
+	for( const auto& entry : std::filesystem::directory_iterator( directory, error ) ) {
+		std::error_code entryError;
+		if( !entry.is_regular_file( entryError ) ) {
+			continue;
+		}
+		const auto size = entry.file_size( entryError );
+		const auto lastUse = entry.last_write_time( entryError );
+		if( entryError ) {
+			continue;
+		}
+		// Named like "<index file>.<time>.tmp" by Store
+		const auto& path = entry.path( );
+		if( path.extension( ) == ".tmp" && path.stem( ).stem( ).extension( ) == IndexFileExtension ) {
+			if( std::filesystem::file_time_type::clock::now( ) - lastUse > StaleTemporaryAge ) {
+				std::filesystem::remove( path, entryError );
+			}
+			continue;
+		}
+		if( path.extension( ) != IndexFileExtension ) {
+			continue;
+		}
+		files.push_back( CachedFile{ path, lastUse, size } );
+		totalSize += size;
+	}
+
+	// Least recently used first, an index larger than the whole budget is removed as well
+	std::ranges::sort( files, {}, &CachedFile::lastUse );
+	for( const auto& file : files ) {
+		if( totalSize <= budget ) {
+			break;
+		}
+		if( std::filesystem::remove( file.path, error ) ) {
+			totalSize -= file.size;
+		}
+	}
+}
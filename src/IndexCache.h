@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+
+// On-disk cache of search indices shared by all databases, addressed by a hash of the image and the index parameters
+// Databases of the same binary find the indices another one built, files above the size budget are evicted least recently used first
+// This module does not depend on the IDA SDK
+
+enum class IndexKind : uint32_t {
+	PositionIndex = 1,
+	FMIndex
+};
+
+typedef struct {
+	uint64_t imageHash;		// ByteSnapshot::Hash
+	uint64_t imageSize;
+	IndexKind kind;
+	uint32_t parameters;	// E.g. the sample rate of an FM-index
+} IndexCacheKey;
+
+class IndexCache {
+public:
+	IndexCache( std::filesystem::path directory, uint64_t budget ) : directory( std::move( directory ) ), budget( budget ) {
+	}
+
+	// A budget of 0 disables the cache
+	void SetBudget( uint64_t newBudget ) {
+		budget = newBudget;
+	}
+	bool IsEnabled( ) const {
+		return budget > 0;
+	}
+
+	// Positioned after the header, also marks the file as recently used
+	std::optional<std::ifstream> Open( const IndexCacheKey& key ) const;
+
+	// Written to a temporary file that is renamed when complete, so other IDA instances never read a partial index
+	// Temporary files left behind by stores that did not finish are removed by the next store once they are old
+	std::expected<void, std::string> Store( const IndexCacheKey& key, const std::function<void( std::ostream& )>& write );
+
+	// For files that failed to load
+	void Remove( const IndexCacheKey& key ) const;
+
+private:
+	std::filesystem::path PathOf( const IndexCacheKey& key ) const;
+	void Evict( ) const;
+
+	std::filesystem::path directory;
+	std::atomic<uint64_t> budget;	// The warm-up reads the cache on another thread
+};
@@ -1,6 +1,30 @@
 #include "Main.h"
 #include "Utils.h"
 #include "SignatureUtils.h"
+#include "ResolverExport.h"
+#include "ByteSnapshot.h"
+#include "FuzzySearch.h"
+#include "GapSearch.h"
+#include "Corpus.h"
+#include "Fingerprint.h"
+#include "ScanCost.h"
+#include "NarrowingSearch.h"
+#include "BytePositionIndex.h"
+#include "FMIndex.h"
+#include "ThreadPool.h"
+#include "CooperativeTask.h"
+#include "UniquePrefixSearch.h"
+#include "Probes.h"
+#include "Arena.h"
+#include "QueryTrace.h"
+#include "IndexCache.h"
+
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <optional>
 
 bool IS_ARM = false;
 
@@ -65,82 +89,697 @@ static bool GetOperand( const insn_t& instruction, uint8_t* operandOffset, uint8
 			continue;
 		}
 
+		// The operand ends where the next encoded value starts, e.g. the imm8 after the disp32 of "cmp dword ptr [rip+x], 1"
+		size_t operandEnd = instruction.size;
+		for( const auto& other : instruction.ops ) {
+			if( other.type == o_void ) {
+				break;
+			}
+			for( const auto offset : { static_cast<size_t>( other.offb ), static_cast<size_t>( other.offo ) } ) {
+				if( offset > op.offb && offset < operandEnd ) {
+					operandEnd = offset;
+				}
+			}
+		}
+		// Immediates are never wider than their data size, an imm8 sign extended to a dword operand is bounded by the instruction end
+		if( op.type == o_imm ) {
+			operandEnd = std::min( operandEnd, op.offb + get_dtype_size( op.dtype ) );
+		}
+
 		*operandOffset = op.offb;
-		*operandLength = instruction.size - op.offb;
+		*operandLength = static_cast<uint8_t>( operandEnd - op.offb );
 		return true;
 	}
 	return false;
 }
 
-static std::vector<ea_t> FindSignatureOccurences( std::string_view idaSignature, bool skipMoreThanOne = false ) {
+// Appends the bytes of a decoded instruction, operands become wildcards if enabled
+static void AddInstructionToSignature( Signature& signature, const insn_t& instruction, bool wildcardOperands, uint32_t operandTypeBitmask, bool captureOperands, uint8_t& captureCount ) {
+	const auto address = instruction.ea;
+	const auto instructionLength = instruction.size;
+	[[maybe_unused]] const auto signatureSize = signature.size( );
+
+	uint8_t operandOffset = 0, operandLength = 0;
+	if( wildcardOperands && GetOperand( instruction, &operandOffset, &operandLength, operandTypeBitmask ) && operandLength > 0 ) {
+		// Add opcodes
+		AddBytesToSignature( signature, address, operandOffset, false );
+		// Wildcards for operands, optionally captured so their values can be extracted from matches
+		const auto captureGroup = ( captureOperands && captureCount < UINT8_MAX ) ? ++captureCount : 0;
+		const auto operandEnd = std::min<size_t>( operandOffset + operandLength, instructionLength );
+		AddBytesToSignature( signature, address + operandOffset, operandEnd - operandOffset, true, captureGroup );
+		// Bytes after the operand, e.g. the operator of an operand on the "left side" or the immediate after a displacement
+		AddBytesToSignature( signature, address + operandEnd, instructionLength - operandEnd, false );
+	}
+	else {
+		// No operand, add all bytes
+		AddBytesToSignature( signature, address, instructionLength, false );
+	}
+	assert( signature.size( ) == signatureSize + instructionLength );
+}
+
+// Searches are split into chunks of this size so deadlines are checked well below a millisecond
+constexpr ea_t SearchChunkSize = 0x40000;
+
+// Occurences counted per step when generating with a deadline, to rank partial results
+constexpr size_t PartialResultMaxOccurences = 100;
+
+// Background jobs run without a wait box
+template<typename... Args>
+static void UpdateWaitBox( const char* format, Args... args ) {
+	if( !CooperativeScheduler::IsInJob( ) ) {
+		replace_wait_box( format, args... );
+	}
+}
+
+// Copy of the image and the indices over it, built on first use and kept until the database changes
+// In FM mode the bytes are released between actions, the searches that scan them read the image again
+static std::optional<ByteSnapshot> CurrentSnapshot;
+static bool IsSnapshotReleased = false;
+static std::optional<ScanCostModel> CurrentScanCostModel;
+static std::optional<BytePositionIndex> CurrentPositionIndex;
+
+static const ByteSnapshot& GetByteSnapshot( ) {
+	if( !CurrentSnapshot ) {
+		CurrentSnapshot.emplace( BuildByteSnapshot( ) );
+	}
+	else if( IsSnapshotReleased ) {
+		UpdateWaitBox( "Reading image..." );
+		CurrentSnapshot.value( ) = BuildByteSnapshot( );
+		IsSnapshotReleased = false;
+	}
+	return CurrentSnapshot.value( );
+}
+
+// Segments of the snapshot, enough to map offsets to addresses without reading released bytes again
+static const ByteSnapshot& GetSnapshotLayout( ) {
+	return CurrentSnapshot ? CurrentSnapshot.value( ) : GetByteSnapshot( );
+}
+
+// Byte pair statistics for scan cost estimates
+static const ScanCostModel& GetScanCostModel( ) {
+	if( !CurrentScanCostModel ) {
+		CurrentScanCostModel.emplace( GetByteSnapshot( ) );
+	}
+	return CurrentScanCostModel.value( );
+}
+
+// Identifies the image in query traces and the index cache
+static std::optional<uint64_t> CurrentImageHash;
+
+static uint64_t GetImageHash( ) {
+	if( !CurrentImageHash ) {
+		CurrentImageHash = GetByteSnapshot( ).Hash( );
+	}
+	return CurrentImageHash.value( );
+}
+
+// Indices of images seen before are loaded from the IDA user directory, shared by all databases
+static IndexCache& GetIndexCache( ) {
+	static IndexCache cache( std::filesystem::path( get_user_idadir( ) ) / "sigmaker" / "cache", 0 );
+	return cache;
+}
+
+// Nothing if the cache does not have the index, an error if the file is damaged
+// Does not use the IDA SDK, so the warm-up can read the file on another thread
+template<typename Index>
+static std::expected<std::optional<Index>, std::string> ReadCachedIndex( const IndexCacheKey& key, const ByteSnapshot& snapshot ) {
+	auto file = GetIndexCache( ).Open( key );
+	if( !file ) {
+		return std::optional<Index>( );
+	}
+	auto index = Index::Load( file.value( ), snapshot );
+	if( !index.has_value( ) ) {
+		return std::unexpected( index.error( ) );
+	}
+	return std::optional<Index>( std::move( index.value( ) ) );
+}
+
+// Damaged files are removed, so the rebuilt index is stored again
+template<typename Index>
+static std::optional<Index> AcceptCachedIndex( std::expected<std::optional<Index>, std::string> cached, const IndexCacheKey& key ) {
+	if( !cached.has_value( ) ) {
+		msg( "Index cache: %s, rebuilding\n", cached.error( ).c_str( ) );
+		GetIndexCache( ).Remove( key );
+		return std::nullopt;
+	}
+	return std::move( cached.value( ) );
+}
+
+// Nothing if the cache is disabled or does not have the index
+template<typename Index>
+static std::optional<Index> LoadCachedIndex( IndexKind kind, uint32_t parameters ) {
+	if( !GetIndexCache( ).IsEnabled( ) ) {
+		return std::nullopt;
+	}
+	const IndexCacheKey key{ GetImageHash( ), GetByteSnapshot( ).bytes.size( ), kind, parameters };
+	return AcceptCachedIndex( ReadCachedIndex<Index>( key, GetByteSnapshot( ) ), key );
+}
+
+template<typename Index>
+static void StoreCachedIndex( const Index& index, IndexKind kind, uint32_t parameters ) {
+	auto& cache = GetIndexCache( );
+	if( !cache.IsEnabled( ) ) {
+		return;
+	}
+	UpdateWaitBox( "Caching index..." );
+	const IndexCacheKey key{ GetImageHash( ), GetByteSnapshot( ).bytes.size( ), kind, parameters };
+	if( const auto result = cache.Store( key, [&index]( std::ostream& stream ) { index.Save( stream ); } ); !result.has_value( ) ) {
+		msg( "Index cache: %s\n", result.error( ).c_str( ) );
+	}
+}
+
+// Returns nullptr if the image is too large to be indexed
+static const BytePositionIndex* GetBytePositionIndex( ) {
+	if( !CurrentPositionIndex ) {
+		const auto& snapshot = GetByteSnapshot( );
+		if( !BytePositionIndex::Supports( snapshot ) ) {
+			return nullptr;
+		}
+		UpdateWaitBox( "Indexing image..." );
+		if( auto cached = LoadCachedIndex<BytePositionIndex>( IndexKind::PositionIndex, 0 ) ) {
+			CurrentPositionIndex.emplace( std::move( cached.value( ) ) );
+		}
+		else {
+			CurrentPositionIndex.emplace( snapshot );
+			if( !CurrentPositionIndex->IsComplete( ) ) {
+				CurrentPositionIndex.reset( );
+				return nullptr;
+			}
+			StoreCachedIndex( CurrentPositionIndex.value( ), IndexKind::PositionIndex, 0 );
+		}
+	}
+	return &CurrentPositionIndex.value( );
+}
+
+// Compact alternative to the position index, selected in the main dialog
+static bool UseFMIndex = false;
+static std::optional<FMIndex> CurrentFMIndex;
+
+static const FMIndex& GetFMIndex( ) {
+	if( !CurrentFMIndex ) {
+		const auto& snapshot = GetByteSnapshot( );
+		UpdateWaitBox( "Building FM-index..." );
+		if( auto cached = LoadCachedIndex<FMIndex>( IndexKind::FMIndex, FMIndex::DefaultSampleRate ) ) {
+			CurrentFMIndex.emplace( std::move( cached.value( ) ) );
+		}
+		else {
+			CurrentFMIndex.emplace( snapshot );
+			StoreCachedIndex( CurrentFMIndex.value( ), IndexKind::FMIndex, FMIndex::DefaultSampleRate );
+		}
+		msg( "FM-index: %llu MB for %llu MB of code\n", CurrentFMIndex->MemoryUsage( ) >> 20, snapshot.bytes.size( ) >> 20 );
+	}
+	return CurrentFMIndex.value( );
+}
+
+// The image may have changed since the last invocation
+static void ResetImageIndices( ) {
+	CurrentFMIndex.reset( );
+	CurrentPositionIndex.reset( );
+	CurrentScanCostModel.reset( );
+	CurrentImageHash.reset( );
+	CurrentSnapshot.reset( );
+	IsSnapshotReleased = false;
+}
+
+// Opt-in log of all queries on the image, for replaying them outside of IDA
+static std::unique_ptr<QueryTraceRecorder> QueryRecorder;
+
+// Which search answered a query
+enum class SearchPath : uint8_t {
+	Gap = 0,
+	FMIndex,
+	PositionIndex,
+	BinSearch
+};
+constexpr const char* SearchPathNames[] = { "Gap search", "FM-index", "Position index", "bin_search3" };
+
+// Debug mode that repeats every index search with bin_search3 and compares the matches, the timings of both are summed up per index
+static bool IsSelfCheckEnabled = false;
+
+typedef struct {
+	size_t queries;
+	size_t mismatches;
+	uint64_t indexNs;
+	uint64_t binSearchNs;
+} SelfCheckTotals;
+
+static std::array<SelfCheckTotals, 4> SelfCheckStatistics{};
+
+// Searches that answer from the snapshot, which path answered is stored in searchPath
+// Returns nothing if the image has to be searched with bin_search3
+static std::optional<std::pmr::vector<ea_t>> SearchAccelerated( const Signature& signature, size_t maxOccurences, Deadline deadline, bool* timedOut, std::pmr::memory_resource* memory, SearchPath& searchPath ) {
+	// bin_search3 can not handle variable length jumps
+	if( HasJumps( signature ) ) {
+		searchPath = SearchPath::Gap;
+		const auto& snapshot = GetByteSnapshot( );
+		std::pmr::vector<ea_t> results( memory );
+		for( const auto offset : FindGapSignatureMatches( snapshot, signature, maxOccurences, deadline, timedOut ) ) {
+			results.push_back( snapshot.OffsetToEa( offset ) );
+		}
+		return results;
+	}
+
+	// Building an index takes longer than most time limits, a query with a deadline uses the chunked search until one is built
+	const auto mayBuildIndex = deadline == NoDeadline;
+
+	// The FM-index only answers if a run of the signature is rare, otherwise the image is searched
+	if( UseFMIndex ) {
+		if( !CurrentFMIndex && !mayBuildIndex ) {
+			return std::nullopt;
+		}
+		const auto& snapshot = GetSnapshotLayout( );
+		if( const auto matches = GetFMIndex( ).FindMatches( signature, maxOccurences, FMIndex::DefaultMaxCandidates, memory, deadline, timedOut ) ) {
+			searchPath = SearchPath::FMIndex;
+			std::pmr::vector<ea_t> results( memory );
+			for( const auto offset : matches.value( ) ) {
+				results.push_back( snapshot.OffsetToEa( offset ) );
+			}
+			return results;
+		}
+	}
+
+	// The position index answers by intersecting bitmaps instead of scanning the image
+	else if( const auto index = CurrentPositionIndex || mayBuildIndex ? GetBytePositionIndex( ) : nullptr ) {
+		searchPath = SearchPath::PositionIndex;
+		if( IsDeadlineExpired( deadline ) ) {
+			*timedOut = true;
+			return std::pmr::vector<ea_t>( memory );
+		}
+		const auto& snapshot = GetByteSnapshot( );
+		std::pmr::vector<ea_t> results( memory );
+		for( const auto offset : index->FindMatches( signature, maxOccurences, memory ) ) {
+			results.push_back( snapshot.OffsetToEa( offset ) );
+		}
+		return results;
+	}
+	return std::nullopt;
+}
+
+static std::pmr::vector<ea_t> SearchWithBinSearch( const Signature& signature, size_t maxOccurences, Deadline deadline, bool* timedOut, std::pmr::memory_resource* memory ) {
 	// Convert signature string to searchable struct
+	const auto idaSignature = BuildIDASignatureString( signature, false, false );
 	compiled_binpat_vec_t binaryPattern;
-	parse_binpat_str( &binaryPattern, inf_get_min_ea(), idaSignature.data( ), 16 );
+	parse_binpat_str( &binaryPattern, inf_get_min_ea(), idaSignature.c_str( ), 16 );
+
+	// Search for occurences, returns false once the search has to stop
+	std::pmr::vector<ea_t> results( memory );
+	const auto searchRange = [&]( ea_t ea, ea_t endEa ) {
+		while( true ) {
+			if( IsDeadlineExpired( deadline ) ) {
+				*timedOut = true;
+				return false;
+			}
 
-	// Search for occurences
-	std::vector<ea_t> results;
-	auto ea = inf_get_min_ea();
-	while( true ) {
-		auto occurence = bin_search3( ea, inf_get_max_ea(), binaryPattern, BIN_SEARCH_NOCASE | BIN_SEARCH_FORWARD );
+			// Chunks overlap by the signature length, so matches on chunk borders are found
+			const auto chunkEnd = ( endEa - ea > SearchChunkSize + signature.size( ) ) ? ea + SearchChunkSize + signature.size( ) : endEa;
+			auto occurence = bin_search3( ea, chunkEnd, binaryPattern, BIN_SEARCH_NOCASE | BIN_SEARCH_FORWARD );
+			SIGMAKER_PROBE3( scan_chunk, static_cast<uint64_t>( ea ), static_cast<uint64_t>( chunkEnd ), static_cast<uint64_t>( occurence ) );
 
-		// Signature not found anymore
-		if( occurence == BADADDR ) {
+			// Signature not found in this chunk
+			if( occurence == BADADDR ) {
+				if( chunkEnd == endEa ) {
+					return true;
+				}
+				ea += SearchChunkSize;
+				continue;
+			}
+
+			results.push_back( occurence );
+
+			//  In case we only care about uniqueness, return after more than one result
+			if( results.size( ) >= maxOccurences ) {
+				return false;
+			}
+
+			ea = occurence + 1;
+		}
+	};
+
+	// Runs of adjacent segments, the gaps between them of sparse 64 bit images would only cost empty searches
+	for( auto segment = get_first_seg( ); segment; ) {
+		const auto runStart = segment->start_ea;
+		auto runEnd = segment->end_ea;
+		for( segment = get_next_seg( runStart ); segment && segment->start_ea == runEnd; segment = get_next_seg( segment->start_ea ) ) {
+			runEnd = segment->end_ea;
+		}
+		if( !searchRange( runStart, runEnd ) ) {
 			break;
 		}
+	}
+	return results;
+}
 
-		//  In case we only care about uniqueness, return after more than one result
-		if( skipMoreThanOne && results.size( ) > 1 ) {
-			break;
+// Both searches report the first maxOccurences matches in address order, so they have to agree exactly
+static void CheckAgainstBinSearch( const Signature& signature, size_t maxOccurences, const std::pmr::vector<ea_t>& results, SearchPath searchPath, uint64_t nanoseconds ) {
+	bool timedOut = false;
+	const auto start = std::chrono::steady_clock::now( );
+	const auto expected = SearchWithBinSearch( signature, maxOccurences, NoDeadline, &timedOut, results.get_allocator( ).resource( ) );
+	auto& totals = SelfCheckStatistics[static_cast<size_t>( searchPath )];
+	totals.queries++;
+	totals.indexNs += nanoseconds;
+	totals.binSearchNs += static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ) - start ).count( ) );
+	if( std::ranges::equal( results, expected ) ) {
+		return;
+	}
+	totals.mismatches++;
+
+	// The first match only one of them reported, with the bytes around it to reproduce the query
+	const auto [result, expectedResult] = std::ranges::mismatch( results, expected );
+	const auto isMissing = result == results.end( ) || ( expectedResult != expected.end( ) && *expectedResult < *result );
+	const auto ea = isMissing ? *expectedResult : *result;
+	constexpr ea_t contextSize = 16;
+	std::string bytes;
+	for( auto current = ea - std::min( ea, contextSize ); current < ea + signature.size( ) + contextSize; current++ ) {
+		bytes += is_loaded( current ) ? std::format( "{:02X} ", get_byte( current ) ) : std::string( "?? " );
+		if( current + 1 == ea ) {
+			bytes += "| ";
+		}
+	}
+	msg( "Self-check mismatch: %s found %llu and bin_search3 %llu matches for %s\n", SearchPathNames[static_cast<size_t>( searchPath )], results.size( ), expected.size( ), BuildIDASignatureString( signature ).c_str( ) );
+	// The snapshot joins adjacent segments like bin_search3 does, a match across a gap between them points at the layout
+	const auto crossesSegments = getseg( ea ) != getseg( ea + signature.size( ) - 1 );
+	msg( "  %s @ %I64X%s, bytes from %I64X: %s\n", isMissing ? "Missed match" : "Wrong match", ea, crossesSegments ? " across segments" : "", ea - std::min( ea, contextSize ), bytes.c_str( ) );
+}
+
+static void PrintSelfCheckSummary( ) {
+	for( size_t i = 0; i < SelfCheckStatistics.size( ); i++ ) {
+		auto& totals = SelfCheckStatistics[i];
+		if( totals.queries == 0 ) {
+			continue;
 		}
+		const auto indexMs = totals.indexNs / 1e6;
+		const auto binSearchMs = totals.binSearchNs / 1e6;
+		msg( "Self-check: %s %llu queries, %llu mismatches, %0.2f ms vs bin_search3 %0.2f ms (%0.1fx)\n", SearchPathNames[i], totals.queries, totals.mismatches, indexMs, binSearchMs, indexMs > 0.0 ? binSearchMs / indexMs : 0.0 );
+		totals = SelfCheckTotals{ };
+	}
+}
 
-		results.push_back( occurence );
+// The wildcards are only counted while a tracer is attached
+static void FireQueryProbe( const Signature& signature, size_t matches, uint64_t nanoseconds ) {
+	if( SIGMAKER_PROBE_ENABLED( query ) ) {
+		SIGMAKER_PROBE4( query, static_cast<uint64_t>( signature.size( ) ), static_cast<uint64_t>( std::ranges::count_if( signature, []( const auto& b ) { return b.isWildcard; } ) ), static_cast<uint64_t>( matches ), nanoseconds );
+	}
+}
 
-		ea = occurence + 1;
+// Results and index temporaries are allocated from memory, e.g. the arena of an ArenaScope in hot loops
+static std::pmr::vector<ea_t> FindSignatureOccurences( const Signature& signature, size_t maxOccurences = SIZE_MAX, Deadline deadline = NoDeadline, bool* timedOut = nullptr, std::pmr::memory_resource* memory = std::pmr::get_default_resource( ) ) {
+	bool isTimedOut = false;
+	auto searchPath = SearchPath::BinSearch;
+	// Only timed for the diagnostics that report it, the clock is not free
+	const auto isTimed = IsSelfCheckEnabled || QueryRecorder || SIGMAKER_PROBE_ENABLED( query );
+	const auto start = isTimed ? std::chrono::steady_clock::now( ) : std::chrono::steady_clock::time_point( );
+	auto accelerated = SearchAccelerated( signature, maxOccurences, deadline, &isTimedOut, memory, searchPath );
+	auto results = accelerated ? std::move( accelerated.value( ) ) : SearchWithBinSearch( signature, maxOccurences, deadline, &isTimedOut, memory );
+	const auto nanoseconds = isTimed ? static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ) - start ).count( ) ) : 0;
+
+	// bin_search3 can not search jumps, and searches cut short by the deadline may have found less
+	if( IsSelfCheckEnabled && ( searchPath == SearchPath::FMIndex || searchPath == SearchPath::PositionIndex ) && !isTimedOut ) {
+		CheckAgainstBinSearch( signature, maxOccurences, results, searchPath, nanoseconds );
+	}
+	FireQueryProbe( signature, results.size( ), nanoseconds );
+	if( QueryRecorder ) {
+		QueryRecorder->Record( signature, maxOccurences == SIZE_MAX ? UINT64_MAX : maxOccurences, results.size( ), nanoseconds, isTimedOut );
+	}
+	if( timedOut ) {
+		*timedOut = isTimedOut;
 	}
 	return results;
 }
 
-static bool IsSignatureUnique( std::string_view idaSignature ) {
-	return FindSignatureOccurences( idaSignature, true ).size( ) == 1;
+// Maps and indexes the files of a corpus, errors are printed
+static void LoadCorpus( Corpus& corpus, const std::vector<std::string>& paths, const char* name ) {
+	UpdateWaitBox( "Indexing %s...", name );
+	for( const auto& error : corpus.Load( paths ) ) {
+		msg( "%s\n", error.c_str( ) );
+	}
+	msg( "%s: %llu files, %llu MB, index %llu MB\n", name, corpus.FileCount( ), corpus.TotalSize( ) >> 20, corpus.MemoryUsage( ) >> 20 );
+}
+
+// Other binaries signatures must not match in, loaded on first use after the paths changed
+static std::vector<std::string> NegativeCorpusPaths;
+static bool NegativeCorpusDirty = false;
+
+static const Corpus& GetNegativeCorpus( ) {
+	static Corpus corpus;
+	if( NegativeCorpusDirty ) {
+		NegativeCorpusDirty = false;
+		LoadCorpus( corpus, NegativeCorpusPaths, "Negative corpus" );
+	}
+	return corpus;
+}
+
+// Other builds of the same binary, one file per build
+static std::vector<std::string> CrossBuildPaths;
+static bool CrossBuildDirty = false;
+
+static const Corpus& GetCrossBuildCorpus( ) {
+	static Corpus corpus;
+	if( CrossBuildDirty ) {
+		CrossBuildDirty = false;
+		LoadCorpus( corpus, CrossBuildPaths, "Other builds" );
+	}
+	return corpus;
+}
+
+static size_t CountNegativeCorpusOccurences( const Signature& signature, size_t limit = 1 ) {
+	const auto& corpus = GetNegativeCorpus( );
+	return corpus.IsEmpty( ) ? 0 : corpus.CountOccurences( signature, limit );
+}
+
+static bool IsSignatureUnique( const Signature& signature ) {
+	return FindSignatureOccurences( signature, 2 ).size( ) == 1 && CountNegativeCorpusOccurences( signature ) == 0;
+}
+
+// Instruction stream of a function body with operands masked like in signatures, data inside the function is kept as concrete bytes
+static Signature BuildNormalizedFunction( const func_t* function, bool wildcardOperands, uint32_t operandTypeBitmask ) {
+	Signature normalized;
+	uint8_t captureCount = 0;
+	auto currentAddress = function->start_ea;
+	while( currentAddress < function->end_ea ) {
+		insn_t instruction;
+		const auto currentInstructionLength = decode_insn( &instruction, currentAddress );
+		if( currentInstructionLength <= 0 ) {
+			// Functions that only differ in their data are not identical
+			auto nextAddress = next_head( currentAddress, function->end_ea );
+			if( nextAddress == BADADDR ) {
+				nextAddress = function->end_ea;
+			}
+			AddBytesToSignature( normalized, currentAddress, static_cast<size_t>( nextAddress - currentAddress ), false );
+			currentAddress = nextAddress;
+			continue;
+		}
+		AddInstructionToSignature( normalized, instruction, wildcardOperands, operandTypeBitmask, false, captureCount );
+		currentAddress += currentInstructionLength;
+	}
+	return normalized;
+}
+
+// Nothing for functions too short to tell apart
+static std::optional<FunctionFingerprint> FingerprintFunction( const func_t* function, bool wildcardOperands, uint32_t operandTypeBitmask ) {
+	const auto normalized = BuildNormalizedFunction( function, wildcardOperands, operandTypeBitmask );
+	if( normalized.size( ) < MinFingerprintSize ) {
+		return std::nullopt;
+	}
+	qstring name;
+	get_func_name( &name, function->start_ea );
+	return FunctionFingerprint{ HashNormalizedFunction( normalized ), function->start_ea, static_cast<uint32_t>( normalized.size( ) ), name.c_str( ) };
+}
+
+static std::expected<FingerprintIndex, std::string> BuildFingerprintIndex( bool wildcardOperands, uint32_t operandTypeBitmask ) {
+	std::vector<FunctionFingerprint> fingerprints;
+	const auto functionCount = get_func_qty( );
+	for( size_t i = 0; i < functionCount; i++ ) {
+		// Handle IDA "cancel" event
+		if( user_cancelled( ) ) {
+			return std::unexpected( "Aborted" );
+		}
+		if( i % 1000 == 0 ) {
+			UpdateWaitBox( "Fingerprinting function %llu of %llu...", i + 1, functionCount );
+		}
+		if( auto fingerprint = FingerprintFunction( getn_func( i ), wildcardOperands, operandTypeBitmask ) ) {
+			fingerprints.push_back( std::move( fingerprint.value( ) ) );
+		}
+	}
+	return FingerprintIndex( std::move( fingerprints ), operandTypeBitmask );
+}
+
+// Fingerprints of all functions in this database, rebuilt when the normalization or the number of functions changed
+// The IDB listener drops the key when bytes or segments change, the index warm-up builds them ahead of the first generation
+typedef std::tuple<bool, uint32_t, size_t> DatabaseFingerprintsKey;
+static FingerprintIndex DatabaseFingerprints;
+static std::optional<DatabaseFingerprintsKey> DatabaseFingerprintsBuiltFor;
+
+// Twins of the function checked last, generating for the cursor or several XREFs of one function checks the same one again
+typedef std::tuple<ea_t, bool, uint32_t> IdenticalFunctionsKey;
+static std::optional<IdenticalFunctionsKey> LastIdenticalFunctionsKey;
+static std::vector<ea_t> LastIdenticalFunctions;
+
+// Counts invalidations, a build that yields in between must not store its outdated fingerprints
+static size_t DatabaseFingerprintsGeneration = 0;
+
+static void InvalidateDatabaseFingerprints( ) {
+	DatabaseFingerprintsBuiltFor.reset( );
+	LastIdenticalFunctionsKey.reset( );
+	DatabaseFingerprintsGeneration++;
+}
+
+static void SetDatabaseFingerprints( FingerprintIndex index, const DatabaseFingerprintsKey& key ) {
+	DatabaseFingerprints = std::move( index );
+	DatabaseFingerprintsBuiltFor = key;
+	LastIdenticalFunctionsKey.reset( );
+}
+
+static const FingerprintIndex& GetDatabaseFingerprints( bool wildcardOperands, uint32_t operandTypeBitmask ) {
+	const auto key = DatabaseFingerprintsKey{ wildcardOperands, operandTypeBitmask, get_func_qty( ) };
+	if( DatabaseFingerprintsBuiltFor != key ) {
+		auto result = BuildFingerprintIndex( wildcardOperands, operandTypeBitmask );
+		if( result.has_value( ) ) {
+			SetDatabaseFingerprints( std::move( result.value( ) ), key );
+		}
+		else {
+			DatabaseFingerprints = FingerprintIndex( );
+			InvalidateDatabaseFingerprints( );
+		}
+	}
+	return DatabaseFingerprints;
+}
+
+// Other functions with the same normalized body, no signature that stays inside such a function can be unique
+static const std::vector<ea_t>& FindIdenticalFunctions( const func_t* function, bool wildcardOperands, uint32_t operandTypeBitmask ) {
+	const auto& index = GetDatabaseFingerprints( wildcardOperands, operandTypeBitmask );
+	const auto key = IdenticalFunctionsKey{ function->start_ea, wildcardOperands, operandTypeBitmask };
+	if( LastIdenticalFunctionsKey == key ) {
+		return LastIdenticalFunctions;
+	}
+
+	LastIdenticalFunctions.clear( );
+	LastIdenticalFunctionsKey = key;
+	const auto normalized = BuildNormalizedFunction( function, wildcardOperands, operandTypeBitmask );
+	if( normalized.size( ) < MinFingerprintSize ) {
+		return LastIdenticalFunctions;
+	}
+	for( const auto& candidate : index.Find( HashNormalizedFunction( normalized ) ) ) {
+		if( candidate.address == function->start_ea ) {
+			continue;
+		}
+		// The cached index may be outdated, compare the actual code
+		const auto other = get_func( candidate.address );
+		if( !other || other->start_ea != candidate.address ) {
+			continue;
+		}
+		const auto otherNormalized = BuildNormalizedFunction( other, wildcardOperands, operandTypeBitmask );
+		if( std::ranges::equal( normalized, otherNormalized, []( const auto& a, const auto& b ) { return a.isWildcard == b.isWildcard && ( a.isWildcard || a.value == b.value ); } ) ) {
+			LastIdenticalFunctions.push_back( other->start_ea );
+		}
+	}
+	return LastIdenticalFunctions;
 }
 
-static std::expected<Signature, std::string> GenerateUniqueSignatureForEA( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, uint32_t operandTypeBitmask, size_t maxSignatureLength = 1000, bool askLongerSignature = true ) {
+// Fires generate_start now and generate_end however generation finishes
+// The clock is only read while a tracer is attached to generate_end, one attached in between reports 0 ns
+struct GenerationProbe {
+	explicit GenerationProbe( ea_t ea ) : ea( ea ) {
+		SIGMAKER_PROBE1( generate_start, static_cast<uint64_t>( ea ) );
+		if( SIGMAKER_PROBE_ENABLED( generate_end ) ) {
+			start = std::chrono::steady_clock::now( );
+		}
+	}
+	~GenerationProbe( ) {
+		if( SIGMAKER_PROBE_ENABLED( generate_end ) ) {
+			const auto nanoseconds = start == std::chrono::steady_clock::time_point( ) ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ) - start ).count( );
+			SIGMAKER_PROBE4( generate_end, static_cast<uint64_t>( ea ), static_cast<uint64_t>( length ), static_cast<uint64_t>( occurences ), static_cast<uint64_t>( nanoseconds ) );
+		}
+	}
+
+	ea_t ea;
+	size_t length = 0;
+	size_t occurences = 0;
+	std::chrono::steady_clock::time_point start;
+};
+
+// With a deadline, the least ambiguous signature found so far is returned when time runs out, the maximum length is reached or the signature leaves the function
+// occurenceCount receives its occurences then
+// Yields after each instruction when run as a background job, those never ask for a longer signature
+static Task<std::expected<Signature, std::string>> GenerateUniqueSignatureForEA( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, uint32_t operandTypeBitmask, bool captureOperands, size_t maxSignatureLength = 1000, bool askLongerSignature = true, Deadline deadline = NoDeadline, size_t* occurenceCount = nullptr ) {
+	GenerationProbe probe( ea );
 	if( ea == BADADDR ) {
-		return std::unexpected( "Invalid address" );
+		co_return std::unexpected( "Invalid address" );
 	}
 
 	if( !is_code( get_flags( ea ) ) ) {
-		return std::unexpected( "Can not create code signature for data" );
+		co_return std::unexpected( "Can not create code signature for data" );
 	}
 
 	Signature signature;
 	size_t sigPartLength = 0;
+	uint8_t captureCount = 0;
 
-	auto currentFunction = get_func( ea );
+	// Last signature with a completely counted number of occurences
+	size_t bestPartialLength = 0;
+	size_t bestPartialOccurences = 0;
+
+	if( occurenceCount ) {
+		*occurenceCount = 0;
+	}
+
+	// The func_t may be freed while the job is suspended, only its start is kept across co_await
+	const auto currentFunction = get_func( ea );
+	const auto functionStart = currentFunction ? currentFunction->start_ea : BADADDR;
+
+	// Extending can never help if the same code exists elsewhere and the signature has to stay inside the function
+	if( currentFunction && !continueOutsideOfFunction ) {
+		const auto twins = FindIdenticalFunctions( currentFunction, wildcardOperands, operandTypeBitmask );
+		if( !twins.empty( ) ) {
+			co_return std::unexpected( std::format( "Function has {} identical cop{}, first @ {:X}", twins.size( ), twins.size( ) == 1 ? "y" : "ies", twins.front( ) ) );
+		}
+	}
+
+	// Longer signatures than this only happen if the user asked to continue, 16 bytes covers the last instruction
+	signature.reserve( maxSignatureLength + 16 );
+
+	// With a deadline, generation that has to stop early returns the last completely counted signature instead of the reason
+	const auto partialResult = [&]( const char* reason ) -> std::expected<Signature, std::string> {
+		if( deadline == NoDeadline || bestPartialLength == 0 ) {
+			return std::unexpected( reason );
+		}
+		signature.resize( bestPartialLength );
+		TrimSignature( signature );
+		if( occurenceCount ) {
+			*occurenceCount = bestPartialOccurences;
+		}
+		probe.length = signature.size( );
+		probe.occurences = bestPartialOccurences;
+		return signature;
+	};
 
 	auto currentAddress = ea;
 	while( true ) {
+		co_await YieldPoint{ };
+
+		// Query temporaries of this step, there is no suspension point before it ends
+		ArenaScope arena;
+
 		// Handle IDA "cancel" event
 		if( user_cancelled( ) ) {
-			return std::unexpected( "Aborted" );
+			co_return std::unexpected( "Aborted" );
 		}
 
 		insn_t instruction;
 		auto currentInstructionLength = decode_insn( &instruction, currentAddress );
 		if( currentInstructionLength <= 0 ) {
 			if( signature.empty( ) ) {
-				return std::unexpected( "Failed to decode first instruction" );
+				co_return std::unexpected( "Failed to decode first instruction" );
 			}
 
 			msg( "Signature reached end of executable code @ %I64X\n", currentAddress );
 			auto signatureString = BuildIDASignatureString( signature );
 			msg( "NOT UNIQUE Signature for %I64X: %s\n", ea, signatureString.c_str( ) );
-			return std::unexpected( "Signature not unique" );
+			co_return std::unexpected( "Signature not unique" );
 		}
 
 		// Length check in case the signature becomes too long
 		if( sigPartLength > maxSignatureLength ) {
-			if( askLongerSignature ) {
+			if( askLongerSignature && !CooperativeScheduler::IsInJob( ) ) {
 				auto result = ask_yn( ASKBTN_YES, "Signature is already at %llu bytes. Continue?", signature.size( ) );
 				if( result == 1 ) { // Yes 
 					sigPartLength = 0;
@@ -149,61 +788,72 @@ static std::expected<Signature, std::string> GenerateUniqueSignatureForEA( ea_t
 					// Print the signature we have so far, even though its not unique
 					auto signatureString = BuildIDASignatureString( signature );
 					msg( "NOT UNIQUE Signature for %I64X: %s\n", ea, signatureString.c_str( ) );
-					return std::unexpected( "Signature not unique" );
+					co_return std::unexpected( "Signature not unique" );
 				}
 				else { // Cancel
-					return std::unexpected( "Aborted" );
+					co_return std::unexpected( "Aborted" );
 				}
 			}
 			else {
-				return std::unexpected( "Signature exceeded maximum length" );
+				co_return partialResult( "Signature exceeded maximum length" );
 			}
 		}
 		sigPartLength += currentInstructionLength;
 
-		uint8_t operandOffset = 0, operandLength = 0;
-		if( wildcardOperands && GetOperand( instruction, &operandOffset, &operandLength, operandTypeBitmask ) && operandLength > 0 ) {
-			// Add opcodes
-			AddBytesToSignature( signature, currentAddress, operandOffset, false );
-			// Wildcards for operands
-			AddBytesToSignature( signature, currentAddress + operandOffset, operandLength, true );
-			// If the operand is on the "left side", add the operator from the "right side"
-			if( operandOffset == 0 ) {
-				AddBytesToSignature( signature, currentAddress + operandLength, currentInstructionLength - operandLength, false );
-			}
-		}
-		else {
-			// No operand, add all bytes
-			AddBytesToSignature( signature, currentAddress, currentInstructionLength, false );
-		}
+		AddInstructionToSignature( signature, instruction, wildcardOperands, operandTypeBitmask, captureOperands, captureCount );
 
-		auto currentSig = BuildIDASignatureString( signature );
-		if( IsSignatureUnique( currentSig ) ) {
+		// Without deadline we only care about uniqueness, with one we count further to rank partial results
+		bool timedOut = false;
+		auto occurences = FindSignatureOccurences( signature, deadline == NoDeadline ? 2 : PartialResultMaxOccurences, deadline, &timedOut, arena.Resource( ) ).size( );
+
+		// A unique signature must not match anywhere in the negative corpus either
+		if( !timedOut && occurences == 1 ) {
+			occurences += CountNegativeCorpusOccurences( signature, deadline == NoDeadline ? 1 : PartialResultMaxOccurences - 1 );
+		}
+		if( !timedOut && occurences == 1 ) {
 			// Remove wildcards at end for output
 			TrimSignature( signature );
 
+			if( occurenceCount ) {
+				*occurenceCount = 1;
+			}
+			probe.length = signature.size( );
+			probe.occurences = 1;
+
 			// Return the signature we generated
-			return signature;
+			co_return signature;
+		}
+
+		// Out of time, fall back to the best signature we have
+		if( timedOut || IsDeadlineExpired( deadline ) ) {
+			if( !timedOut ) {
+				bestPartialLength = signature.size( );
+				bestPartialOccurences = occurences;
+			}
+			co_return partialResult( "Deadline exceeded" );
 		}
+		bestPartialLength = signature.size( );
+		bestPartialOccurences = occurences;
 		currentAddress += currentInstructionLength;
 
-		// Break if we leave function
-		if( !continueOutsideOfFunction && currentFunction && get_func( currentAddress ) != currentFunction ) {
-			return std::unexpected( "Signature left function scope" );
+		// Break if we leave function, or the function was deleted while the job was suspended
+		if( !continueOutsideOfFunction && functionStart != BADADDR && ( !get_func( functionStart ) || get_func( currentAddress ) != get_func( functionStart ) ) ) {
+			co_return partialResult( "Signature left function scope" );
 		}
 
 	}
-	return std::unexpected( "Unknown" );
+	co_return std::unexpected( "Unknown" );
 }
 
 // Function for code selection
-static std::expected<Signature, std::string> GenerateSignatureForEARange( ea_t eaStart, ea_t eaEnd, bool wildcardOperands, uint32_t operandTypeBitmask ) {
+static std::expected<Signature, std::string> GenerateSignatureForEARange( ea_t eaStart, ea_t eaEnd, bool wildcardOperands, uint32_t operandTypeBitmask, bool captureOperands ) {
 	if( eaStart == BADADDR || eaEnd == BADADDR ) {
 		return std::unexpected( "Invalid address" );
 	}
 
 	Signature signature;
 	size_t sigPartLength = 0;
+	uint8_t captureCount = 0;
 
 	// Copy data section, no wildcards
 	if( !is_code( get_flags( eaStart ) ) ) {
@@ -236,21 +886,7 @@ static std::expected<Signature, std::string> GenerateSignatureForEARange( ea_t e
 
 		sigPartLength += currentInstructionLength;
 
-		uint8_t operandOffset = 0, operandLength = 0;
-		if( wildcardOperands && GetOperand( instruction, &operandOffset, &operandLength, operandTypeBitmask ) && operandLength > 0 ) {
-			// Add opcodes
-			AddBytesToSignature( signature, currentAddress, operandOffset, false );
-			// Wildcards for operands
-			AddBytesToSignature( signature, currentAddress + operandOffset, operandLength, true );
-			// If the operand is on the "left side", add the operator from the "right side"
-			if( operandOffset == 0 ) {
-				AddBytesToSignature( signature, currentAddress + operandLength, currentInstructionLength - operandLength, false );
-			}
-		}
-		else {
-			// No operand, add all bytes
-			AddBytesToSignature( signature, currentAddress, currentInstructionLength, false );
-		}
+		AddInstructionToSignature( signature, instruction, wildcardOperands, operandTypeBitmask, captureOperands, captureCount );
 		currentAddress += currentInstructionLength;
 
 		if( currentAddress >= eaEnd ) {
@@ -262,202 +898,521 @@ static std::expected<Signature, std::string> GenerateSignatureForEARange( ea_t e
 	return std::unexpected( "Unknown" );
 }
 
-void PrintSignatureForEA( const std::expected<Signature, std::string>& signature, ea_t ea, SignatureType sigType ) {
-	if( !signature.has_value( ) ) {
-		msg( "Error: %s\n", signature.error( ).c_str( ) );
-		return;
+// Bytes before and after the target in which cross build signatures may start
+constexpr ea_t CrossBuildWindowSize = 0x100;
+
+// Finds the shortest signature starting near ea that is unique in the database and occurs exactly once in every other build
+// With rankByScanCost the signature that is cheapest to find at runtime wins instead of the shortest
+static std::expected<CrossBuildSignature, std::string> GenerateCrossBuildSignatureForEA( ea_t ea, bool wildcardOperands, uint32_t operandTypeBitmask, bool captureOperands, size_t maxSignatureLength, bool rankByScanCost, Deadline deadline = NoDeadline ) {
+	if( ea == BADADDR ) {
+		return std::unexpected( "Invalid address" );
 	}
-	const auto signatureStr = FormatSignature( signature.value( ), sigType );
-	msg( "Signature for %I64X: %s\n", ea, signatureStr.c_str( ) );
-}
 
-static void FindXRefs( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, std::vector<std::tuple<ea_t, Signature>>& xrefSignatures, size_t maxSignatureLength, uint32_t operandTypeBitmask ) {
-	xrefblk_t xref{};
+	const auto& builds = GetCrossBuildCorpus( );
+	if( builds.IsEmpty( ) ) {
+		return std::unexpected( "No other builds configured" );
+	}
 
-	// Count code xrefs
-	size_t xrefCount = 0;
-	for( auto xref_ok = xref.first_to( ea, XREF_FAR ); xref_ok; xref_ok = xref.next_to( ) ) {
-		if( !is_code( get_flags( xref.from ) ) ) {
-			continue;
+	// Instruction starts in the window, closest to the target first
+	std::vector<ea_t> starts;
+	const auto windowStart = ea > CrossBuildWindowSize ? ea - CrossBuildWindowSize : 0;
+	const auto windowEnd = ea + CrossBuildWindowSize;
+	for( auto head = ea; head != BADADDR && head < windowEnd; head = next_head( head, windowEnd ) ) {
+		if( is_code( get_flags( head ) ) ) {
+			starts.push_back( head );
 		}
-		++xrefCount;
 	}
+	for( auto head = prev_head( ea, windowStart ); head != BADADDR; head = prev_head( head, windowStart ) ) {
+		if( is_code( get_flags( head ) ) ) {
+			starts.push_back( head );
+		}
+	}
+	std::ranges::stable_sort( starts, {}, [ea]( ea_t start ) { return start > ea ? start - ea : ea - start; } );
 
-	size_t shortestSignatureLength = maxSignatureLength + 1;
-
-	size_t i = 0;
-	for( auto xref_ok = xref.first_to( ea, XREF_FAR ); xref_ok; xref_ok = xref.next_to( ), ++i ) {
-
-		// Instantly abort
+	std::optional<CrossBuildSignature> best;
+	double bestScanCost = 0.0;
+	for( size_t i = 0; i < starts.size( ); i++ ) {
+		// Handle IDA "cancel" event
 		if( user_cancelled( ) ) {
-			break;
+			return std::unexpected( "Aborted" );
 		}
 
-		// Skip data refs, xref.iscode is not what we want though
-		if( !is_code( get_flags( xref.from ) ) ) {
-			continue;
+		// Keep what we have when running out of time
+		if( IsDeadlineExpired( deadline ) ) {
+			break;
 		}
 
-		replace_wait_box( "Processing xref %llu of %llu (%0.1f%%)...\n\nSuitable Signatures: %llu\nShortest Signature: %llu Bytes", i + 1, xrefCount, ( static_cast<float>( i ) / xrefCount ) * 100.0f, xrefSignatures.size( ), ( shortestSignatureLength <= maxSignatureLength ? shortestSignatureLength : 0 ) );
+		UpdateWaitBox( "Checking start %llu of %llu...\n\nShortest Signature: %llu Bytes", i + 1, starts.size( ), best ? best->signature.size( ) : 0 );
 
-		// Genreate signature for xref
-		auto signature = GenerateUniqueSignatureForEA( xref.from, wildcardOperands, continueOutsideOfFunction, operandTypeBitmask, maxSignatureLength, false );
-		if( !signature.has_value( ) ) {
-			continue;
-		}
+		Signature signature;
+		uint8_t captureCount = 0;
+		auto currentAddress = starts[i];
+		while( true ) {
+			insn_t instruction;
+			const auto currentInstructionLength = decode_insn( &instruction, currentAddress );
+			if( currentInstructionLength <= 0 ) {
+				break;
+			}
+			AddInstructionToSignature( signature, instruction, wildcardOperands, operandTypeBitmask, captureOperands, captureCount );
+			currentAddress += currentInstructionLength;
 
-		// Update for statistics
-		if( signature.value( ).size( ) < shortestSignatureLength ) {
-			shortestSignatureLength = signature.value( ).size( );
-		}
+			auto candidate = signature;
+			TrimSignature( candidate );
+			if( candidate.empty( ) ) {
+				continue;
+			}
 
-		xrefSignatures.push_back( std::make_pair( xref.from, signature.value( ) ) );
-	}
+			// Ties go to the start closer to the target, which was checked first
+			if( candidate.size( ) > maxSignatureLength || ( best && !rankByScanCost && candidate.size( ) >= best->signature.size( ) ) ) {
+				break;
+			}
 
-	// Sort signatures by length
-	std::ranges::sort( xrefSignatures, []( const auto& a, const auto& b ) -> bool { return std::get<1>( a ).size( ) < std::get<1>( b ).size( ); } );
-}
+			// The index queries are cheap, the database is only searched once every build has exactly one match
+			const auto counts = builds.CountOccurencesPerFile( candidate, 2 );
 
-static void PrintXRefSignaturesForEA( ea_t ea, const std::vector<std::tuple<ea_t, Signature>>& xrefSignatures, SignatureType sigType, size_t topCount ) {
-	if( xrefSignatures.empty( ) ) {
-		msg( "No XREFs have been found for your address\n" );
-		return;
+			// Code at this start differs in some build, a longer signature can not match there either
+			if( std::ranges::find( counts, 0 ) != counts.end( ) ) {
+				break;
+			}
+			if( std::ranges::any_of( counts, []( size_t count ) { return count > 1; } ) ) {
+				continue;
+			}
+			if( IsSignatureUnique( candidate ) ) {
+				const auto scanCost = rankByScanCost ? GetScanCostModel( ).Estimate( candidate ).cost : 0.0;
+				if( !best || scanCost < bestScanCost ) {
+					best = CrossBuildSignature{ starts[i], std::move( candidate ) };
+					bestScanCost = scanCost;
+				}
+				break;
+			}
+		}
 	}
 
-	auto topLength = std::min( topCount, xrefSignatures.size( ) );
-	msg( "Top %llu Signatures out of %llu xrefs for %I64X:\n", topLength, xrefSignatures.size( ), ea );
-	for( size_t i = 0; i < topLength; i++ ) {
-		const auto& [originAddress, signature] = xrefSignatures[i];
-		const auto signatureStr = FormatSignature( signature, sigType );
-		msg( "XREF Signature #%i @ %I64X: %s\n", i + 1, originAddress, signatureStr.c_str( ) );
+	if( !best ) {
+		return std::unexpected( IsDeadlineExpired( deadline ) ? "Deadline exceeded" : "No signature near the address occurs exactly once in every build" );
 	}
+	return best.value( );
 }
 
-static void PrintSelectedCode( ea_t start, ea_t end, SignatureType sigType, bool wildcardOperands, uint32_t operandBitmask ) {
-	const auto selectionSize = end - start;
-	// Create signature of fixed size from selection
-
-	auto signature = GenerateSignatureForEARange( start, end, wildcardOperands, operandBitmask );
+static void PrintCrossBuildSignatureForEA( const std::expected<CrossBuildSignature, std::string>& signature, ea_t ea, SignatureType sigType, size_t buildCount ) {
 	if( !signature.has_value( ) ) {
 		msg( "Error: %s\n", signature.error( ).c_str( ) );
 		return;
 	}
+	const auto& [address, bytes] = signature.value( );
+	const auto signatureStr = FormatSignature( bytes, sigType );
+	const auto scanCost = GetScanCostModel( ).Estimate( bytes );
+	msg( "Signature for %I64X in all %llu builds @ %I64X (target at match %c 0x%llX, scan cost %s): %s\n", ea, buildCount + 1, address, ea >= address ? '+' : '-', ea >= address ? ea - address : address - ea, FormatScanCost( scanCost.cost ).c_str( ), signatureStr.c_str( ) );
+}
 
-	const auto signatureStr = FormatSignature( signature.value( ), sigType );
-	msg( "Code for %I64X-%I64X: %s\n", start, end, signatureStr.c_str( ) );
+static size_t CountAmbiguousFingerprints( const FingerprintIndex& index ) {
+	return std::ranges::count_if( index.Fingerprints( ), [&]( const auto& fingerprint ) { return index.Find( fingerprint.hash ).size( ) > 1; } );
 }
 
-static void SearchSignatureString( std::string input ) {
-	// Try to figure out what signature type is used
-	// We will convert it to IDA style
-	std::string convertedSignatureString;
+static void ExportFingerprints( const std::string& path, uint32_t operandTypeBitmask ) {
+	const auto index = BuildFingerprintIndex( true, operandTypeBitmask );
+	if( !index.has_value( ) ) {
+		msg( "Error: %s\n", index.error( ).c_str( ) );
+		return;
+	}
+	if( const auto result = index.value( ).Save( path ); !result.has_value( ) ) {
+		msg( "Error: %s\n", result.error( ).c_str( ) );
+		return;
+	}
+	msg( "Exported %llu function fingerprints (%llu ambiguous) to %s\n", index.value( ).Fingerprints( ).size( ), CountAmbiguousFingerprints( index.value( ) ), path.c_str( ) );
+}
 
-	std::string stringMask;
+// Looks up every function of this database in the fingerprints of another one
+static void MatchFingerprints( const std::string& path ) {
+	const auto other = FingerprintIndex::Load( path );
+	if( !other.has_value( ) ) {
+		msg( "Error: %s\n", other.error( ).c_str( ) );
+		return;
+	}
 
-	// Try to detect a string mask like "xx????xx?xx"
-	// Assume string mask always starts with x, and we don't just have one byte
-	std::smatch match;
-	if( std::regex_search( input, match, std::regex( R"(x(?:x|\?)+)" ) ) ) {
-		stringMask = match[0].str( );
+	// Both sides have to be normalized the same way
+	const auto local = BuildFingerprintIndex( true, other.value( ).OperandTypeBitmask( ) );
+	if( !local.has_value( ) ) {
+		msg( "Error: %s\n", local.error( ).c_str( ) );
+		return;
 	}
-	// Try to find binary style bitmask like "0b101110" and convert it to a string mask
-	else if( std::regex_search( input, match, std::regex( R"(0b(?:[0,1])+)" ) ) ) {
-		auto bits = match[0].str( ).substr( 2 );
-		std::string reversedBits( bits.rbegin( ), bits.rend( ) );
-		for( const auto& b : reversedBits ) {
-			stringMask += ( b == '1' ? 'x' : '?' );
+
+	size_t matched = 0, ambiguous = 0, unmatched = 0;
+	for( const auto& fingerprint : local.value( ).Fingerprints( ) ) {
+		const auto matches = other.value( ).Find( fingerprint.hash );
+		const auto twins = local.value( ).Find( fingerprint.hash ).size( );
+		if( matches.empty( ) ) {
+			unmatched++;
+			continue;
+		}
+		if( matches.size( ) == 1 && twins == 1 ) {
+			msg( "Match: %I64X %s <- %I64X %s\n", fingerprint.address, fingerprint.name.c_str( ), matches.front( ).address, matches.front( ).name.c_str( ) );
+			matched++;
+			continue;
 		}
+		msg( "AMBIGUOUS: %I64X %s (%llu functions here, %llu there, first %I64X %s)\n", fingerprint.address, fingerprint.name.c_str( ), twins, matches.size( ), matches.front( ).address, matches.front( ).name.c_str( ) );
+		ambiguous++;
 	}
+	msg( "Fingerprints: %llu matched, %llu ambiguous, %llu changed or missing\n", matched, ambiguous, unmatched );
+}
 
-	if( !stringMask.empty( ) ) {
-		// Since we have a mask, search for the bytes
+// Last generated signature, the search action starts with it
+static std::string LastSignature;
 
-		std::vector<std::string> rawByteStrings;
-		// Search for \x00\x11\x22 type arrays
-		if( GetRegexMatches( input, std::regex( R"(\\x(?:[0-9A-F]{2}))" ), rawByteStrings ) && rawByteStrings.size( ) == stringMask.length( ) ) {
-			Signature convertedSignature;
-			for( size_t i = 0; const auto & m : rawByteStrings ) {
-				SignatureByte b{ static_cast<uint8_t>( std::stoi( m.substr( 2 ), nullptr, 16 ) ), stringMask[i++] == '?' };
-				convertedSignature.push_back( b );
-			}
-			convertedSignatureString = BuildIDASignatureString( convertedSignature );
+void PrintSignatureForEA( const std::expected<Signature, std::string>& signature, ea_t ea, SignatureType sigType, size_t occurences = 1 ) {
+	if( !signature.has_value( ) ) {
+		msg( "Error: %s\n", signature.error( ).c_str( ) );
+		return;
+	}
+	const auto signatureStr = FormatSignature( signature.value( ), sigType );
+	LastSignature = signatureStr;
+	if( occurences > 1 ) {
+		msg( "PARTIAL Signature for %I64X (%s%llu occurences, no unique signature within the limits): %s\n", ea, occurences >= PartialResultMaxOccurences ? ">=" : "", occurences, signatureStr.c_str( ) );
+		return;
+	}
+	const auto scanCost = GetScanCostModel( ).Estimate( signature.value( ) );
+	msg( "Signature for %I64X (scan cost %s: %llu candidates x %llu bytes): %s\n", ea, FormatScanCost( scanCost.cost ).c_str( ), scanCost.candidates, scanCost.verifyLength, signatureStr.c_str( ) );
+}
+
+static Task<void> FindXRefs( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, std::vector<XRefSignature>& xrefSignatures, size_t maxSignatureLength, uint32_t operandTypeBitmask, bool captureOperands, bool rankByScanCost, Deadline deadline = NoDeadline ) {
+	// Sources of the code xrefs, the job yields between them and the analyst may change the xrefs meanwhile
+	std::vector<ea_t> sources;
+	xrefblk_t xref{};
+	for( auto xref_ok = xref.first_to( ea, XREF_FAR ); xref_ok; xref_ok = xref.next_to( ) ) {
+		if( is_code( get_flags( xref.from ) ) ) {
+			sources.push_back( xref.from );
 		}
-		// Search for 0x00, 0x11, 0x22 type arrays
-		else if( GetRegexMatches( input, std::regex( R"((?:0x(?:[0-9A-F]{2}))+)" ), rawByteStrings ) && rawByteStrings.size( ) == stringMask.length( ) ) {
-			Signature convertedSignature;
-			for( size_t i = 0; const auto & m : rawByteStrings ) {
-				SignatureByte b{ static_cast<uint8_t>( std::stoi( m.substr( 2 ), nullptr, 16 ) ), stringMask[i++] == '?' };
-				convertedSignature.push_back( b );
-			}
-			convertedSignatureString = BuildIDASignatureString( convertedSignature );
+	}
+	const auto xrefCount = sources.size( );
+	xrefSignatures.reserve( xrefSignatures.size( ) + xrefCount );
+
+	size_t shortestSignatureLength = maxSignatureLength + 1;
+
+	for( size_t i = 0; i < xrefCount; i++ ) {
+		const auto from = sources[i];
+		co_await YieldPoint{ };
+
+		// Instantly abort
+		if( user_cancelled( ) ) {
+			break;
 		}
-		else {
-			msg( "Detected mask \"%s\" but failed to match corresponding bytes\n", stringMask.c_str( ) );
+
+		// Keep what we have when running out of time
+		if( IsDeadlineExpired( deadline ) ) {
+			break;
+		}
+
+		// The source may have been undefined while the job was suspended
+		if( !is_code( get_flags( from ) ) ) {
+			continue;
+		}
+
+		UpdateWaitBox( "Processing xref %llu of %llu (%0.1f%%)...\n\nSuitable Signatures: %llu\nShortest Signature: %llu Bytes", i + 1, xrefCount, ( static_cast<float>( i ) / xrefCount ) * 100.0f, xrefSignatures.size( ), ( shortestSignatureLength <= maxSignatureLength ? shortestSignatureLength : 0 ) );
+
+		// Genreate signature for xref
+		size_t occurences = 0;
+		auto signature = co_await GenerateUniqueSignatureForEA( from, wildcardOperands, continueOutsideOfFunction, operandTypeBitmask, captureOperands, maxSignatureLength, false, deadline, &occurences );
+		SIGMAKER_PROBE3( xref, static_cast<uint64_t>( from ), static_cast<uint64_t>( signature.has_value( ) ? signature.value( ).size( ) : 0 ), static_cast<uint64_t>( signature.has_value( ) ? occurences : 0 ) );
+		if( !signature.has_value( ) ) {
+			continue;
+		}
+
+		// Update for statistics
+		if( occurences == 1 && signature.value( ).size( ) < shortestSignatureLength ) {
+			shortestSignatureLength = signature.value( ).size( );
+		}
+
+		xrefSignatures.push_back( XRefSignature{ from, signature.value( ), occurences, GetScanCostModel( ).Estimate( signature.value( ) ).cost } );
+	}
+
+	// Partial results are only of interest if no unique signature was found in time
+	if( std::ranges::any_of( xrefSignatures, []( const auto& s ) { return s.occurences == 1; } ) ) {
+		std::erase_if( xrefSignatures, []( const auto& s ) { return s.occurences != 1; } );
+	}
+
+	// Sort signatures by ambiguity, then length or expected scan cost
+	std::ranges::sort( xrefSignatures, [rankByScanCost]( const auto& a, const auto& b ) -> bool {
+		if( a.occurences != b.occurences ) {
+			return a.occurences < b.occurences;
+		}
+		if( rankByScanCost && a.scanCost != b.scanCost ) {
+			return a.scanCost < b.scanCost;
+		}
+		return a.signature.size( ) < b.signature.size( );
+	} );
+}
+
+static void PrintXRefSignaturesForEA( ea_t ea, const std::vector<XRefSignature>& xrefSignatures, SignatureType sigType, size_t topCount ) {
+	if( xrefSignatures.empty( ) ) {
+		msg( "No XREFs have been found for your address\n" );
+		return;
+	}
+
+	auto topLength = std::min( topCount, xrefSignatures.size( ) );
+	msg( "Top %llu Signatures out of %llu xrefs for %I64X:\n", topLength, xrefSignatures.size( ), ea );
+	LastSignature = FormatSignature( xrefSignatures.front( ).signature, sigType );
+	for( size_t i = 0; i < topLength; i++ ) {
+		const auto& [originAddress, signature, occurences, scanCost] = xrefSignatures[i];
+		const auto signatureStr = FormatSignature( signature, sigType );
+		if( occurences > 1 ) {
+			msg( "PARTIAL XREF Signature #%i @ %I64X (%s%llu occurences): %s\n", i + 1, originAddress, occurences >= PartialResultMaxOccurences ? ">=" : "", occurences, signatureStr.c_str( ) );
+			continue;
+		}
+		msg( "XREF Signature #%i @ %I64X (scan cost %s): %s\n", i + 1, originAddress, FormatScanCost( scanCost ).c_str( ), signatureStr.c_str( ) );
+	}
+	if( xrefSignatures.front( ).occurences > 1 ) {
+		msg( "Time limit reached before a unique signature was found\n" );
+	}
+}
+
+static void PrintSelectedCode( ea_t start, ea_t end, SignatureType sigType, bool wildcardOperands, uint32_t operandBitmask, bool captureOperands ) {
+	const auto selectionSize = end - start;
+	// Create signature of fixed size from selection
+
+	auto signature = GenerateSignatureForEARange( start, end, wildcardOperands, operandBitmask, captureOperands );
+	if( !signature.has_value( ) ) {
+		msg( "Error: %s\n", signature.error( ).c_str( ) );
+		return;
+	}
+
+	const auto signatureStr = FormatSignature( signature.value( ), sigType );
+	msg( "Code for %I64X-%I64X: %s\n", start, end, signatureStr.c_str( ) );
+}
+
+// Occurences of the signature for ea after each added instruction until it is unique, the image is only scanned once
+static std::expected<std::vector<ProfileStep>, std::string> BuildUniquenessProfile( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, uint32_t operandTypeBitmask, size_t maxSignatureLength = 1000 ) {
+	if( ea == BADADDR ) {
+		return std::unexpected( "Invalid address" );
+	}
+
+	if( !is_code( get_flags( ea ) ) ) {
+		return std::unexpected( "Can not create code signature for data" );
+	}
+
+	const auto& snapshot = GetByteSnapshot( );
+	NarrowingSearch search( snapshot );
+
+	Signature signature;
+	uint8_t captureCount = 0;
+	std::vector<ProfileStep> steps;
+	auto currentFunction = get_func( ea );
+	auto currentAddress = ea;
+	while( true ) {
+		// Handle IDA "cancel" event
+		if( user_cancelled( ) ) {
+			return std::unexpected( "Aborted" );
+		}
+
+		insn_t instruction;
+		const auto currentInstructionLength = decode_insn( &instruction, currentAddress );
+		if( currentInstructionLength <= 0 ) {
+			break;
+		}
+		AddInstructionToSignature( signature, instruction, wildcardOperands, operandTypeBitmask, false, captureCount );
+
+		const auto occurences = search.Extend( signature );
+		steps.push_back( ProfileStep{ currentAddress, signature.size( ), occurences } );
+		if( occurences <= 1 || signature.size( ) >= maxSignatureLength ) {
+			break;
+		}
+		currentAddress += currentInstructionLength;
+
+		// Stop if we leave function
+		if( !continueOutsideOfFunction && currentFunction && get_func( currentAddress ) != currentFunction ) {
+			break;
 		}
 	}
+
+	if( steps.empty( ) ) {
+		return std::unexpected( "Failed to decode first instruction" );
+	}
+	return steps;
+}
+
+// Table with a bar per step, one # per quarter decade of occurences
+static void PrintUniquenessProfile( ea_t ea, const std::vector<ProfileStep>& steps ) {
+	msg( "Uniqueness profile for %I64X:\n", ea );
+	msg( "   #  Address           Bytes  Occurences\n" );
+	for( size_t i = 0; i < steps.size( ); i++ ) {
+		const auto& [address, length, occurences] = steps[i];
+		const auto bar = std::string( static_cast<size_t>( std::ceil( std::log10( occurences + 1.0 ) * 4.0 ) ), '#' );
+		msg( "%s\n", std::format( "{:4}  {:016X}  {:5}  {:10} {}", i + 1, address, length, occurences, bar ).c_str( ) );
+	}
+	if( steps.back( ).occurences == 1 ) {
+		msg( "Unique after %llu instructions, %llu bytes\n", steps.size( ), steps.back( ).length );
+	}
 	else {
-		// We did not find a specific mask, so try formats with included wildcards 
+		msg( "Not unique after %llu instructions\n", steps.size( ) );
+	}
+}
+
+// Rows are appended so profiles of many targets end up in one file
+static std::expected<void, std::string> AppendUniquenessProfileCSV( const std::string& path, ea_t ea, const std::vector<ProfileStep>& steps ) {
+	std::error_code error;
+	const auto writeHeader = !std::filesystem::exists( path, error ) || std::filesystem::file_size( path, error ) == 0;
 
-		// Remove braces in case you have makers in your IDA style signature 
-		input = std::regex_replace( input, std::regex( R"([\)\(\[\]]+)" ), "" );
+	std::ofstream file( path, std::ios::app );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+	if( writeHeader ) {
+		file << "target,step,address,length,occurences\n";
+	}
+	for( size_t i = 0; i < steps.size( ); i++ ) {
+		file << std::format( "0x{:X},{},0x{:X},{},{}\n", ea, i + 1, steps[i].address, steps[i].length, steps[i].occurences );
+	}
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to write {}", path ) );
+	}
+	return {};
+}
 
-		// Remove whitespace at beginning, questionmarks and spaces at the end, and add one space for the following step
-		input = std::regex_replace( input, std::regex( "^\\s+" ), "" );
-		input = std::regex_replace( input, std::regex( "[? ]+$" ), "" ) + " ";
+// Per task group totals and the busy time of each thread, uneven busy times point at chunks that are too coarse
+static void PrintTaskTrace( const std::vector<TaskTrace>& trace, size_t threadCount ) {
+	if( trace.empty( ) ) {
+		msg( "Task trace: no parallel tasks ran\n" );
+		return;
+	}
+	typedef struct {
+		size_t tasks;
+		double totalMs;
+		double longestMs;
+	} GroupTotals;
+	std::vector<std::pair<std::string_view, GroupTotals>> groups;
+	std::vector<double> busyMs( threadCount );	// Threads outside of the pool last
+	auto end = trace.front( ).start;
+	for( const auto& task : trace ) {
+		const auto ms = std::chrono::duration<double, std::milli>( task.duration ).count( );
+		auto group = std::ranges::find( groups, std::string_view( task.name ), &std::pair<std::string_view, GroupTotals>::first );
+		if( group == groups.end( ) ) {
+			group = groups.insert( groups.end( ), { task.name, GroupTotals{ 0, 0.0, 0.0 } } );
+		}
+		group->second.tasks++;
+		group->second.totalMs += ms;
+		group->second.longestMs = std::max( group->second.longestMs, ms );
+		busyMs[task.worker >= 0 ? static_cast<size_t>( task.worker ) : threadCount - 1] += ms;
+		end = std::max( end, task.start + task.duration );
+	}
 
-		// Replace double question marks with single ones to convert x64Dbg style to IDA style
-		// We need spaces between signature bytes, because we can not recognize if a signature uses one or two question marks per wildcard
-		input = std::regex_replace( input, std::regex( R"(\?\? )" ), "? " );
+	msg( "Task trace over %.1f ms:\n", std::chrono::duration<double, std::milli>( end - trace.front( ).start ).count( ) );
+	for( const auto& [name, totals] : groups ) {
+		msg( "%s\n", std::format( "  {:<16} {:6} tasks  {:10.2f} ms  longest {:8.2f} ms", name, totals.tasks, totals.totalMs, totals.longestMs ).c_str( ) );
+	}
+	for( size_t i = 0; i < busyMs.size( ); i++ ) {
+		msg( "%s\n", std::format( "  {:<16} {:10.2f} ms busy", i + 1 < busyMs.size( ) ? std::format( "worker {}", i ) : std::string( "IDA thread" ), busyMs[i] ).c_str( ) );
+	}
+}
 
-		// Direct match for IDA type signature
-		if( std::regex_match( input, std::regex( R"((?:(?:[A-F0-9]{2}\s+)|(?:\?\s+))+)" ) ) ) {
-			// Just use it
-			convertedSignatureString = input;
+// Prints the bytes found at a fuzzy match, mismatches as [expected->actual]
+static std::string FormatFuzzyMatch( const ByteSnapshot& snapshot, const Signature& signature, size_t offset ) {
+	std::string result;
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		const auto actual = snapshot.bytes[offset + i];
+		if( !result.empty( ) ) {
+			result += " ";
+		}
+		if( signature[i].isWildcard ) {
+			result += "?";
+		}
+		else if( signature[i].value != actual ) {
+			result += std::format( "[{:02X}->{:02X}]", signature[i].value, actual );
 		}
 		else {
-			// Just try the other formats without wildcards
+			result += std::format( "{:02X}", actual );
+		}
+	}
+	return result;
+}
 
-			std::vector<std::string> rawByteStrings;
-			// Search for \x00\x11\x22 type arrays
+static void SearchFuzzySignature( const Signature& signature, size_t maxMismatches ) {
+	if( HasJumps( signature ) ) {
+		msg( "Approximate search does not support jumps\n" );
+		return;
+	}
 
-			if( GetRegexMatches( input, std::regex( R"(\\x(?:[0-9A-F]{2}))" ), rawByteStrings ) && rawByteStrings.size( ) > 1 ) {
-				Signature convertedSignature;
-				for( size_t i = 0; const auto & m : rawByteStrings ) {
-					SignatureByte b{ static_cast<uint8_t>( std::stoi( m.substr( 2 ) ), nullptr, 16 ), false };
-					convertedSignature.push_back( b );
-				}
-				convertedSignatureString = BuildIDASignatureString( convertedSignature );
-			}
-			// Search for 0x00, 0x11, 0x22 type arrays
-			else if( GetRegexMatches( input, std::regex( R"((?:0x(?:[0-9A-F]{2}))+)" ), rawByteStrings ) && rawByteStrings.size( ) > 1 ) {
-				Signature convertedSignature;
-				for( size_t i = 0; const auto & m : rawByteStrings ) {
-					SignatureByte b{ static_cast<uint8_t>( std::stoi( m.substr( 2 ) ), nullptr, 16 ), false };
-					convertedSignature.push_back( b );
-				}
-				convertedSignatureString = BuildIDASignatureString( convertedSignature );
+	const auto concreteBytes = std::ranges::count_if( signature, []( const auto& b ) { return !b.isWildcard; } );
+	if( static_cast<size_t>( concreteBytes ) <= maxMismatches * 2 ) {
+		msg( "Signature has too few concrete bytes to allow %llu mismatches\n", maxMismatches );
+		return;
+	}
+
+	const auto& snapshot = GetByteSnapshot( );
+	const auto matches = FindFuzzyMatches( snapshot, signature, maxMismatches );
+	if( matches.empty( ) ) {
+		msg( "No matches within %llu mismatching bytes\n", maxMismatches );
+		return;
+	}
+
+	constexpr size_t maxPrintedMatches = 100;
+	msg( "%llu match(es) within %llu mismatching bytes%s:\n", matches.size( ), maxMismatches, matches.size( ) > maxPrintedMatches ? ", showing the closest 100" : "" );
+	for( size_t i = 0; i < std::min( matches.size( ), maxPrintedMatches ); i++ ) {
+		const auto& match = matches[i];
+		msg( "Match @ %I64X (distance %llu): %s\n", snapshot.OffsetToEa( match.offset ), match.distance, FormatFuzzyMatch( snapshot, signature, match.offset ).c_str( ) );
+	}
+}
+
+// Reads the captured values of a match, 4 byte captures are also shown as resolved rel32 if they point into the database
+static std::string FormatCaptures( ea_t match, const std::vector<SignatureCapture>& captures ) {
+	std::string result;
+	for( const auto& capture : captures ) {
+		const auto captureEa = match + capture.offset;
+		result += std::format( " {{{}}} = ", capture.group );
+		switch( capture.length ) {
+		case 1:
+			result += std::format( "0x{:X}", get_byte( captureEa ) );
+			break;
+		case 2:
+			result += std::format( "0x{:X}", get_word( captureEa ) );
+			break;
+		case 4:
+		{
+			const auto value = get_dword( captureEa );
+			result += std::format( "0x{:X}", value );
+			// A rel32 is relative to the end of its instruction, which may hold an immediate after the capture
+			ea_t instructionEnd = captureEa + capture.length;
+			insn_t instruction;
+			if( const auto head = get_item_head( captureEa ); decode_insn( &instruction, head ) > 0 && instructionEnd <= head + instruction.size ) {
+				instructionEnd = head + instruction.size;
 			}
-			else {
-				msg( "Failed to match signature format\n" );
+			const auto target = instructionEnd + static_cast<int32_t>( value );
+			if( target >= inf_get_min_ea( ) && target < inf_get_max_ea( ) && is_mapped( target ) ) {
+				result += std::format( " (rel32 -> {:X})", target );
+			}
+			break;
+		}
+		case 8:
+			result += std::format( "0x{:X}", get_qword( captureEa ) );
+			break;
+		default:
+			for( size_t i = 0; i < capture.length; i++ ) {
+				result += std::format( "{}{:02X}", i ? " " : "", get_byte( captureEa + i ) );
 			}
+			break;
 		}
 	}
+	return result;
+}
 
-	if( convertedSignatureString.empty( ) ) {
-		msg( "Unrecognized signature type\n" );
-		return;
+// Returns the number of matches
+static std::expected<size_t, std::string> SearchSignatureString( std::string input ) {
+	auto convertedSignature = ParseSignatureString( input );
+	if( !convertedSignature.has_value( ) ) {
+		return std::unexpected( convertedSignature.error( ) );
 	}
 
 	// Print results
+	const auto convertedSignatureString = BuildIDASignatureString( convertedSignature.value( ) );
 	msg( "Signature: %s\n", convertedSignatureString.c_str( ) );
-	auto signatureMatches = FindSignatureOccurences( convertedSignatureString );
+	auto signatureMatches = FindSignatureOccurences( convertedSignature.value( ) );
 	if( signatureMatches.empty( ) ) {
 		msg( "Signature does not match!\n" );
-		return;
+		return 0;
 	}
+	const auto captures = GetSignatureCaptures( convertedSignature.value( ) );
 	for( const auto& ea : signatureMatches ) {
-		msg( "Match @ %I64X\n", ea );
+		msg( "Match @ %I64X%s\n", ea, FormatCaptures( ea, captures ).c_str( ) );
 	}
+	return signatureMatches.size( );
 }
 
 static uint32_t WildcardableOperandTypeBitmask = BIT( o_reg ) | BIT( o_mem ) | BIT( o_phrase ) | BIT( o_displ ) | BIT( o_imm ) | BIT( o_far ) | BIT( o_near ) | BIT( o_idpspec0 ) | BIT( o_idpspec1 ) | BIT( o_idpspec2 ) | BIT( o_idpspec3 ) | BIT( o_idpspec4 ) | BIT( o_idpspec5 );
@@ -482,12 +1437,959 @@ void ConfigureOperandWildcardBitmask( ) {
 	}
 }
 
-bool idaapi plugin_ctx_t::run( size_t ) {
+// Edits a list of paths, one per line, returns false if the dialog was cancelled
+static bool AskCorpusPaths( std::vector<std::string>& corpusPaths, const char* prompt ) {
+	std::string currentPaths;
+	for( const auto& path : corpusPaths ) {
+		currentPaths += path + "\n";
+	}
+
+	qstring paths;
+	if( !ask_text( &paths, 0, currentPaths.c_str( ), "%s", prompt ) ) {
+		return false;
+	}
+
+	corpusPaths.clear( );
+	std::istringstream stream( paths.c_str( ) );
+	for( std::string line; std::getline( stream, line ); ) {
+		line = std::regex_replace( line, std::regex( R"(^\s+|\s+$)" ), "" );
+		if( !line.empty( ) ) {
+			corpusPaths.push_back( line );
+		}
+	}
+	return true;
+}
+
+void ConfigureNegativeCorpus( ) {
+	if( AskCorpusPaths( NegativeCorpusPaths, "Files or directories signatures must not match in, one per line:" ) ) {
+		NegativeCorpusDirty = true;
+	}
+}
+
+void ConfigureCrossBuilds( ) {
+	if( AskCorpusPaths( CrossBuildPaths, "Other builds of this binary, one file per line, directories add every file in them:" ) ) {
+		CrossBuildDirty = true;
+	}
+}
+
+// Generates and prints the signature for ea, adds unique ones to the resolver export set if enabled
+// The time limit starts when the job first runs, not while it waits behind other background jobs
+static Task<void> CreateUniqueSignature( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, SignatureType sigType, bool captureOperands, bool collectForExport, bool askLongerSignature, std::chrono::milliseconds timeLimit ) {
+	const auto deadline = DeadlineAfter( timeLimit );
+	size_t occurences = 0;
+	auto signature = co_await GenerateUniqueSignatureForEA( ea, wildcardOperands, continueOutsideOfFunction, WildcardableOperandTypeBitmask, captureOperands, 1000, askLongerSignature, deadline, &occurences );
+	PrintSignatureForEA( signature, ea, sigType, occurences );
+	if( collectForExport && signature.has_value( ) && occurences == 1 ) {
+		AddToResolverExportSet( signature.value( ), ea, ea );
+	}
+}
+
+// Generates signatures up to 250 bytes length for the references to ea and prints the top 5
+// The time limit starts when the job first runs
+static Task<void> CreateXRefSignatures( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, SignatureType sigType, bool captureOperands, bool collectForExport, bool rankByScanCost, std::chrono::milliseconds timeLimit ) {
+	const auto deadline = DeadlineAfter( timeLimit );
+	std::vector<XRefSignature> xrefSignatures;
+	co_await FindXRefs( ea, wildcardOperands, continueOutsideOfFunction, xrefSignatures, 250, WildcardableOperandTypeBitmask, captureOperands, rankByScanCost, deadline );
+
+	PrintXRefSignaturesForEA( ea, xrefSignatures, sigType, 5 );
+	if( collectForExport && !xrefSignatures.empty( ) ) {
+		const auto& [originAddress, signature, occurences, scanCost] = xrefSignatures.front( );
+		if( occurences == 1 ) {
+			AddToResolverExportSet( signature, originAddress, ea );
+		}
+	}
+}
+
+// Set when bytes or segments of the database change
+static bool ImageChanged = true;
+
+// Background jobs share the IDA thread, a timer gives them a slice between UI events
+static CooperativeScheduler BackgroundJobs;
+static qtimer_t BackgroundTimer = nullptr;
+constexpr int BackgroundTimerInterval = 10;
+constexpr auto BackgroundSlice = std::chrono::milliseconds( 20 );
+
+static int idaapi RunBackgroundJobs( void* ) {
+	// The jobs search the snapshot of the image before the change
+	if( ImageChanged ) {
+		for( const auto& name : BackgroundJobs.CancelAll( ) ) {
+			msg( "Cancelled %s, the database changed\n", name.c_str( ) );
+		}
+		BackgroundTimer = nullptr;
+		return -1;
+	}
+	bool hasJobs = false;
+	try {
+		hasJobs = BackgroundJobs.RunSlice( BackgroundSlice );
+	}
+	catch( const std::exception& e ) {
+		msg( "Background job failed: %s\n", e.what( ) );
+		hasJobs = !BackgroundJobs.IsIdle( );
+	}
+	if( hasJobs ) {
+		return BackgroundTimerInterval;
+	}
+	// Unregisters the timer
+	BackgroundTimer = nullptr;
+	return -1;
+}
+
+static void StartBackgroundJob( Task<void> job, std::string name ) {
+	msg( "Queued %s, %llu background jobs\n", name.c_str( ), BackgroundJobs.JobCount( ) + 1 );
+	BackgroundJobs.Enqueue( std::move( job ), std::move( name ) );
+	if( !BackgroundTimer ) {
+		BackgroundTimer = register_timer( BackgroundTimerInterval, RunBackgroundJobs, nullptr );
+	}
+}
+
+// Jobs are only ever suspended while the timer is not running, so they stop right away
+static void CancelBackgroundJobs( ) {
+	for( const auto& name : BackgroundJobs.CancelAll( ) ) {
+		msg( "Cancelled %s\n", name.c_str( ) );
+	}
+	if( BackgroundTimer ) {
+		unregister_timer( BackgroundTimer );
+		BackgroundTimer = nullptr;
+	}
+}
+
+// Values of the main dialog, kept for its next invocation and used by the actions outside of it
+static struct {
+	short action = 0;
+	short outputFormat = 0;
+	short options = ( 1 << 0 | 0 << 1 | 1 << 7 );
+	sval_t timeLimit = 0;
+	sval_t threadCount = 0;
+	sval_t cacheSize = 1024;
+	short diagnostics = 0;	// Set in the diagnostics dialog
+} DialogValues;
+
+// Options for debugging the plugin itself, kept out of the main dialog
+static void ConfigureDiagnostics( ) {
+	const char format[] =
+		"STARTITEM 0\n"																																			// TabStop
+		"Diagnostics\n"																																			// Title
+		"<#Print how long the tasks of parallel scans took on each worker thread#Trace parallel tasks:C>\n"															// Checkbox Button 0
+		"<#Log every search on the image to a file and dump the image next to it, so tools/QueryReplay.cpp can replay them#Record query trace:C>\n"			// Checkbox Button 1
+		"<#Debug mode, repeat every index search with bin_search3, print mismatches and compare the timings of both#Self-check searches:C>>\n";				// Checkbox Button 2
+
+	auto diagnostics = DialogValues.diagnostics;
+	if( ask_form( format, &diagnostics ) ) {
+		DialogValues.diagnostics = diagnostics;
+	}
+}
+
+typedef struct {
+	SignatureType sigType;
+	bool wildcardOperands;
+	bool continueOutsideOfFunction;
+	bool collectForExport;
+	bool captureOperands;
+	bool rankByScanCost;
+	bool useFMIndex;
+	bool traceTasks;
+	bool runInBackground;
+	bool recordQueries;
+	bool selfCheck;
+	bool warmUpIndices;
+	std::chrono::milliseconds timeLimit;	// For jobs that may wait in the background queue first
+	Deadline deadline;
+} Settings;
+
+// The time limit starts now
+static Settings GetSettings( ) {
+	const auto options = DialogValues.options;
+	const auto diagnostics = DialogValues.diagnostics;
+	return Settings{
+		static_cast<SignatureType>( DialogValues.outputFormat ),
+		( options & ( 1 << 0 ) ) != 0,
+		( options & ( 1 << 1 ) ) != 0,
+		( options & ( 1 << 2 ) ) != 0,
+		( options & ( 1 << 3 ) ) != 0,
+		( options & ( 1 << 4 ) ) != 0,
+		( options & ( 1 << 5 ) ) != 0,
+		( diagnostics & ( 1 << 0 ) ) != 0,
+		( options & ( 1 << 6 ) ) != 0,
+		( diagnostics & ( 1 << 1 ) ) != 0,
+		( diagnostics & ( 1 << 2 ) ) != 0,
+		( options & ( 1 << 7 ) ) != 0,
+		std::chrono::milliseconds( std::max<sval_t>( DialogValues.timeLimit, 0 ) ),
+		DeadlineAfter( std::chrono::milliseconds( std::max<sval_t>( DialogValues.timeLimit, 0 ) ) )
+	};
+}
+
+static void StopQueryTrace( ) {
+	if( QueryRecorder ) {
+		msg( "Query trace: %llu queries saved to %s\n", QueryRecorder->QueryCount( ), QueryRecorder->Path( ).c_str( ) );
+		QueryRecorder.reset( );
+	}
+}
+
+// The replayer needs the image as well, it is dumped next to the trace
+static void StartQueryTrace( ) {
+	const auto path = ask_file( true, "*.sigtrace", "Save query trace" );
+	if( !path ) {
+		return;
+	}
+	const auto imagePath = std::filesystem::path( path ).replace_extension( ".sigimage" ).string( );
+
+	show_wait_box( "Dumping image..." );
+	const auto& snapshot = GetByteSnapshot( );
+	const auto saved = snapshot.Save( imagePath );
+	auto recorder = saved.has_value( ) ? QueryTraceRecorder::Open( path, GetImageHash( ), snapshot.bytes.size( ) ) : std::unexpected( saved.error( ) );
+	hide_wait_box( );
+
+	if( !recorder.has_value( ) ) {
+		msg( "Error: %s\n", recorder.error( ).c_str( ) );
+		return;
+	}
+	QueryRecorder = std::move( recorder.value( ) );
+	msg( "Recording queries to %s, image dumped to %s\n", path, imagePath.c_str( ) );
+}
+
+// Index warm-up after the auto-analysis, the job is defined below the action it shows its progress on
+static CooperativeScheduler WarmUpJobs;
+static qtimer_t WarmUpTimer = nullptr;
+
+// Set while an action of the plugin runs, the warm-up waits for it
+static bool IsActionRunning = false;
+
+static void CancelIndexWarmUp( ) {
+	WarmUpJobs.CancelAll( );
+	if( WarmUpTimer ) {
+		unregister_timer( WarmUpTimer );
+		WarmUpTimer = nullptr;
+	}
+}
+
+// Drops the snapshot and indices of a changed image, the jobs still queued for the old ones are cancelled
+static void DiscardChangedImage( ) {
+	if( ImageChanged ) {
+		// The jobs search the old snapshot, a trace can only be replayed against the image it was recorded on
+		CancelBackgroundJobs( );
+		CancelIndexWarmUp( );
+		StopQueryTrace( );
+		ResetImageIndices( );
+		ImageChanged = false;
+	}
+}
+
+// The FM-index verifies matches against its own copy of the text, so in FM mode only the segments of the snapshot are kept once nothing uses its bytes
+static void ReleaseSnapshotBytes( ) {
+	if( !UseFMIndex || !CurrentFMIndex || !CurrentSnapshot || IsSnapshotReleased || ImageChanged || IsActionRunning || !BackgroundJobs.IsIdle( ) || !WarmUpJobs.IsIdle( ) ) {
+		return;
+	}
+	// Both are derived from the bytes, the position index is not used in FM mode
+	GetImageHash( );
+	GetScanCostModel( );
+	CurrentPositionIndex.reset( );
+	CurrentSnapshot->bytes = std::vector<uint8_t>( );
+	IsSnapshotReleased = true;
+}
+
+static void ApplyIndexCacheSize( ) {
+	DialogValues.cacheSize = std::max<sval_t>( DialogValues.cacheSize, 0 );
+	GetIndexCache( ).SetBudget( static_cast<uint64_t>( DialogValues.cacheSize ) << 20 );
+}
+
+// Rebuilds the snapshot and indices if needed
+static void PrepareImage( const Settings& settings ) {
+	IsActionRunning = true;
+	IS_ARM = IsARM( );
+	DiscardChangedImage( );
+	UseFMIndex = settings.useFMIndex;
+	IsSelfCheckEnabled = settings.selfCheck;
+
+	if( settings.recordQueries && !QueryRecorder ) {
+		StartQueryTrace( );
+	}
+	else if( !settings.recordQueries ) {
+		StopQueryTrace( );
+	}
+
+	DialogValues.threadCount = std::max<sval_t>( DialogValues.threadCount, 0 );
+	SetThreadPoolSize( DialogValues.threadCount );
+	ApplyIndexCacheSize( );
+	GetThreadPool( ).EnableTrace( settings.traceTasks );
+	TakeArenaSpills( );
+}
+
+// Prints what the diagnostic options collected during the action and ends it
+static void FinishDiagnostics( const Settings& settings ) {
+	if( settings.traceTasks ) {
+		auto& threadPool = GetThreadPool( );
+		PrintTaskTrace( threadPool.TakeTrace( ), threadPool.ThreadCount( ) );
+		threadPool.EnableTrace( false );
+
+		// Should stay at 0 once the arenas have grown to the largest query
+		const auto spills = TakeArenaSpills( );
+		msg( "Query arenas: %llu arena overflows, %llu KB\n", spills.overflows, ( spills.bytes + 1023 ) >> 10 );
+	}
+	if( settings.selfCheck ) {
+		PrintSelfCheckSummary( );
+	}
+	IsActionRunning = false;
+	ReleaseSnapshotBytes( );
+}
+
+// Actions of the main dialog that also have their own hotkeys
+
+static void CreateUniqueSignatureAtCursor( const Settings& settings ) {
+	const auto ea = get_screen_ea( );
+
+	show_wait_box( "Generating signature..." );
+
+	// Identical functions make a signature inside the function impossible, offer references to the function instead
+	const auto function = get_func( ea );
+	if( function && !settings.continueOutsideOfFunction ) {
+		const auto twins = FindIdenticalFunctions( function, settings.wildcardOperands, WildcardableOperandTypeBitmask );
+		if( !twins.empty( ) ) {
+			hide_wait_box( );
+			msg( "Function %I64X has %llu identical copies, first @ %I64X\n", function->start_ea, twins.size( ), twins.front( ) );
+			if( ask_yn( ASKBTN_YES, "HIDECANCEL\nThe function has %llu identical copies, so no signature inside it can be unique.\nCreate XREF signatures for the function start instead?", twins.size( ) ) == ASKBTN_YES ) {
+				auto job = CreateXRefSignatures( function->start_ea, settings.wildcardOperands, settings.continueOutsideOfFunction, settings.sigType, settings.captureOperands, settings.collectForExport, settings.rankByScanCost, settings.timeLimit );
+				if( settings.runInBackground ) {
+					StartBackgroundJob( std::move( job ), std::format( "XREF signatures for {:X}", function->start_ea ) );
+				}
+				else {
+					show_wait_box( "Finding references and generating signatures. This can take a while..." );
+					job.RunToCompletion( );
+					hide_wait_box( );
+				}
+			}
+			return;
+		}
+	}
+
+	auto job = CreateUniqueSignature( ea, settings.wildcardOperands, settings.continueOutsideOfFunction, settings.sigType, settings.captureOperands, settings.collectForExport, settings.deadline == NoDeadline, settings.timeLimit );
+	if( settings.runInBackground ) {
+		hide_wait_box( );
+		StartBackgroundJob( std::move( job ), std::format( "signature for {:X}", ea ) );
+		return;
+	}
+	job.RunToCompletion( );
+
+	hide_wait_box( );
+}
+
+// Generates signatures up to 250 bytes length at the references to the current address
+static void CreateXRefSignaturesAtCursor( const Settings& settings ) {
+	const auto ea = get_screen_ea( );
+
+	auto job = CreateXRefSignatures( ea, settings.wildcardOperands, settings.continueOutsideOfFunction, settings.sigType, settings.captureOperands, settings.collectForExport, settings.rankByScanCost, settings.timeLimit );
+	if( settings.runInBackground ) {
+		StartBackgroundJob( std::move( job ), std::format( "XREF signatures for {:X}", ea ) );
+		return;
+	}
+
+	show_wait_box( "Finding references and generating signatures. This can take a while..." );
+
+	job.RunToCompletion( );
+
+	hide_wait_box( );
+}
+
+static void CopySelectedCode( const Settings& settings ) {
+	ea_t start, end;
+	if( read_range_selection( get_current_viewer( ), &start, &end ) ) {
+		show_wait_box( "Please stand by..." );
+
+		PrintSelectedCode( start, end, settings.sigType, settings.wildcardOperands, WildcardableOperandTypeBitmask, settings.captureOperands );
+
+		hide_wait_box( );
+	}
+	else {
+		msg( "Select a range to copy the code\n" );
+	}
+}
+
+// The input starts with the last generated signature
+static void SearchSignature( const Settings& ) {
+	qstring inputSignatureQstring = LastSignature.c_str( );
+	if( ask_str( &inputSignatureQstring, HIST_SRCH, "Enter a signature" ) ) {
+		show_wait_box( "Searching..." );
+
+		auto result = SearchSignatureString( inputSignatureQstring.c_str( ) );
+		if( !result.has_value( ) ) {
+			msg( "Error: %s\n", result.error( ).c_str( ) );
+		}
+
+		hide_wait_box( );
+
+		// Offer to look for the place the signature moved to
+		static sval_t maxMismatches = 2;
+		if( result.has_value( ) && result.value( ) == 0 && ask_long( &maxMismatches, "Signature does not match. Search for positions with up to N mismatching bytes (1-%llu)", MaxFuzzyMismatches ) ) {
+			maxMismatches = std::clamp<sval_t>( maxMismatches, 1, MaxFuzzyMismatches );
+
+			show_wait_box( "Searching..." );
+			SearchFuzzySignature( ParseSignatureString( inputSignatureQstring.c_str( ) ).value( ), maxMismatches );
+			hide_wait_box( );
+		}
+	}
+}
+
+// Runs one of the actions above with the last used options of the main dialog, without showing it
+class DirectActionHandler : public action_handler_t {
+public:
+	DirectActionHandler( void ( *action )( const Settings& ), bool needsDisassembly ) : action( action ), needsDisassembly( needsDisassembly ) {
+	}
+
+	int idaapi activate( action_activation_ctx_t* ) override {
+		const auto settings = GetSettings( );
+		PrepareImage( settings );
+		action( settings );
+		FinishDiagnostics( settings );
+		return 1;
+	}
+
+	action_state_t idaapi update( action_update_ctx_t* ctx ) override {
+		if( !needsDisassembly ) {
+			return AST_ENABLE_ALWAYS;
+		}
+		return ctx->widget_type == BWN_DISASM ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+	}
+
+private:
+	void ( *action )( const Settings& );
+	bool needsDisassembly;
+};
+
+static DirectActionHandler UniqueSignatureHandler( CreateUniqueSignatureAtCursor, true );
+static DirectActionHandler XRefSignaturesHandler( CreateXRefSignaturesAtCursor, true );
+static DirectActionHandler CopySelectionHandler( CopySelectedCode, true );
+static DirectActionHandler SearchSignatureHandler( SearchSignature, false );
+
+constexpr auto UniqueSignatureAction = "sigmaker:unique_signature";
+constexpr auto UniqueSignatureLabel = "Create unique signature here";
+constexpr auto XRefSignaturesAction = "sigmaker:xref_signatures";
+constexpr auto CopySelectionAction = "sigmaker:copy_selection";
+constexpr auto SearchSignatureAction = "sigmaker:search_signature";
+
+// The warm-up runs on its own slow timer and only while no action or background job is running, so it never competes with the analyst
+constexpr int WarmUpTimerInterval = 100;
+constexpr auto WarmUpSlice = std::chrono::milliseconds( 5 );
+// Bytes read from the database and hashed between two yield points, each takes a few milliseconds
+constexpr size_t WarmUpReadSize = 4 << 20;
+constexpr size_t WarmUpHashSize = 16 << 20;
+
+// Progress is shown in the label of the hotkey action, an empty status restores it
+static void ShowWarmUpStatus( const std::string& status ) {
+	const auto label = status.empty( ) ? std::string( UniqueSignatureLabel ) : std::format( "{} ({})", UniqueSignatureLabel, status );
+	update_action_label( UniqueSignatureAction, label.c_str( ) );
+}
+
+// Fingerprints the functions for the twin check in the background, the first generation would otherwise do it while the analyst waits
+static Task<void> WarmUpFingerprints( bool wildcardOperands ) {
+	const auto key = DatabaseFingerprintsKey{ wildcardOperands, WildcardableOperandTypeBitmask, get_func_qty( ) };
+	if( DatabaseFingerprintsBuiltFor == key ) {
+		co_return;
+	}
+	const auto generation = DatabaseFingerprintsGeneration;
+	const auto functionCount = std::get<2>( key );
+	std::vector<FunctionFingerprint> fingerprints;
+	for( size_t i = 0; i < functionCount; i++ ) {
+		if( i % 256 == 0 ) {
+			ShowWarmUpStatus( std::format( "fingerprinting {}%", i * 100 / functionCount ) );
+			co_await YieldPoint{ };
+			// Functions were added, deleted or changed in between, the next warm-up starts over
+			if( DatabaseFingerprintsGeneration != generation || get_func_qty( ) != functionCount ) {
+				co_return;
+			}
+		}
+		if( auto fingerprint = FingerprintFunction( getn_func( i ), wildcardOperands, WildcardableOperandTypeBitmask ) ) {
+			fingerprints.push_back( std::move( fingerprint.value( ) ) );
+		}
+	}
+	// A generation may have built them meanwhile
+	if( DatabaseFingerprintsBuiltFor != key ) {
+		SetDatabaseFingerprints( FingerprintIndex( std::move( fingerprints ), WildcardableOperandTypeBitmask ), key );
+	}
+}
+
+// Runs work on its own thread while the job yields, work must not use the IDA SDK
+// Destroying the suspended job waits for the work, so what it references has to outlive the job only
+template<typename Work>
+static Task<std::invoke_result_t<Work>> RunOffThread( Work work ) {
+	auto result = std::async( std::launch::async, std::move( work ) );
+	while( result.wait_for( std::chrono::milliseconds( 1 ) ) != std::future_status::ready ) {
+		co_await YieldPoint{ };
+	}
+	co_return result.get( );
+}
+
+// LoadCachedIndex for the warm-up, the image hash has to be known already
+template<typename Index>
+static Task<std::optional<Index>> LoadCachedIndexOffThread( IndexKind kind, uint32_t parameters ) {
+	if( !GetIndexCache( ).IsEnabled( ) ) {
+		co_return std::nullopt;
+	}
+	const auto& snapshot = GetByteSnapshot( );
+	const IndexCacheKey key{ GetImageHash( ), snapshot.bytes.size( ), kind, parameters };
+	auto cached = co_await RunOffThread( [key, &snapshot]( ) { return ReadCachedIndex<Index>( key, snapshot ); } );
+	co_return AcceptCachedIndex( std::move( cached ), key );
+}
+
+// StoreCachedIndex for the warm-up, the index must not change until the job is done
+template<typename Index>
+static Task<void> StoreCachedIndexOffThread( const Index& index, IndexKind kind, uint32_t parameters ) {
+	if( !GetIndexCache( ).IsEnabled( ) ) {
+		co_return;
+	}
+	const IndexCacheKey key{ GetImageHash( ), GetByteSnapshot( ).bytes.size( ), kind, parameters };
+	const auto result = co_await RunOffThread( [key, &index]( ) { return GetIndexCache( ).Store( key, [&index]( std::ostream& stream ) { index.Save( stream ); } ); } );
+	if( !result.has_value( ) ) {
+		msg( "Index cache: %s\n", result.error( ).c_str( ) );
+	}
+}
+
+// Reads the image and computes its hash in steps, the cache is read on another thread
+static Task<void> WarmUpSnapshot( ) {
+	if( !CurrentSnapshot || IsSnapshotReleased ) {
+		ByteSnapshotBuilder builder;
+		while( builder.Step( WarmUpReadSize ) ) {
+			ShowWarmUpStatus( std::format( "reading image {}%", builder.BytesRead( ) * 100 / std::max<uint64_t>( builder.TotalSize( ), 1 ) ) );
+			co_await YieldPoint{ };
+		}
+		// An action may have read it meanwhile
+		if( !CurrentSnapshot || IsSnapshotReleased ) {
+			CurrentSnapshot = builder.Finish( );
+			IsSnapshotReleased = false;
+		}
+	}
+	if( !CurrentImageHash && GetIndexCache( ).IsEnabled( ) ) {
+		ShowWarmUpStatus( "hashing image" );
+		ByteSnapshotHasher hasher( CurrentSnapshot.value( ) );
+		while( hasher.Step( WarmUpHashSize ) ) {
+			co_await YieldPoint{ };
+		}
+		CurrentImageHash = hasher.Value( );
+	}
+}
+
+static Task<void> WarmUpIndices( bool useFMIndex, bool wildcardOperands ) {
+	const auto start = std::chrono::steady_clock::now( );
+	// A loaded FM-index needs neither the bytes nor the hash
+	if( !useFMIndex || !CurrentFMIndex ) {
+		co_await WarmUpSnapshot( );
+	}
+
+	if( useFMIndex ) {
+		// Blocks of the FM-index take seconds each, so only a cached one is loaded, a missing one is built on first use
+		if( !CurrentFMIndex ) {
+			ShowWarmUpStatus( "loading index" );
+			auto cached = co_await LoadCachedIndexOffThread<FMIndex>( IndexKind::FMIndex, FMIndex::DefaultSampleRate );
+			if( cached && !CurrentFMIndex ) {
+				CurrentFMIndex.emplace( std::move( cached.value( ) ) );
+			}
+		}
+	}
+	else if( !CurrentPositionIndex && BytePositionIndex::Supports( GetByteSnapshot( ) ) ) {
+		const auto& snapshot = GetByteSnapshot( );
+		ShowWarmUpStatus( "loading index" );
+		auto cached = co_await LoadCachedIndexOffThread<BytePositionIndex>( IndexKind::PositionIndex, 0 );
+		if( cached ) {
+			if( !CurrentPositionIndex ) {
+				CurrentPositionIndex.emplace( std::move( cached.value( ) ) );
+			}
+		}
+		else {
+			co_await YieldPoint{ };
+			auto index = co_await BytePositionIndex::BuildIncrementally( snapshot, [lastPercent = size_t( 0 )]( size_t done, size_t total ) mutable {
+				if( const auto percent = done * 100 / total; percent != lastPercent ) {
+					ShowWarmUpStatus( std::format( "indexing {}%", percent ) );
+					lastPercent = percent;
+				}
+			} );
+			// An action may have built one meanwhile
+			if( !CurrentPositionIndex ) {
+				CurrentPositionIndex.emplace( std::move( index ) );
+				ShowWarmUpStatus( "caching index" );
+				co_await StoreCachedIndexOffThread( CurrentPositionIndex.value( ), IndexKind::PositionIndex, 0 );
+			}
+		}
+	}
+	co_await WarmUpFingerprints( wildcardOperands );
+	ShowWarmUpStatus( "" );
+	msg( "Index warm-up: done in %.0f ms\n", std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+}
+
+static int idaapi RunIndexWarmUp( void* ) {
+	// The snapshot the warm-up builds from is about to be replaced
+	if( ImageChanged ) {
+		WarmUpJobs.CancelAll( );
+		ShowWarmUpStatus( "" );
+		msg( "Index warm-up: stopped, the database changed\n" );
+		WarmUpTimer = nullptr;
+		return -1;
+	}
+	// Also skips slices the timer would run while an action processes UI events
+	if( IsActionRunning || !BackgroundJobs.IsIdle( ) ) {
+		return WarmUpTimerInterval;
+	}
+
+	bool hasJobs = false;
+	try {
+		hasJobs = WarmUpJobs.RunSlice( WarmUpSlice );
+	}
+	catch( const std::exception& e ) {
+		ShowWarmUpStatus( "" );
+		msg( "Index warm-up failed: %s\n", e.what( ) );
+		hasJobs = !WarmUpJobs.IsIdle( );
+	}
+	if( hasJobs ) {
+		return WarmUpTimerInterval;
+	}
+	ReleaseSnapshotBytes( );
+	// Unregisters the timer
+	WarmUpTimer = nullptr;
+	return -1;
+}
+
+// Called whenever the auto-analysis queue runs empty, does nothing if the index of the image is warm already
+static void StartIndexWarmUp( ) {
+	const auto settings = GetSettings( );
+	if( !settings.warmUpIndices || !WarmUpJobs.IsIdle( ) ) {
+		return;
+	}
+	DiscardChangedImage( );
+	const auto indexWarm = CurrentSnapshot && ( settings.useFMIndex ? CurrentFMIndex.has_value( ) : CurrentPositionIndex.has_value( ) );
+	if( indexWarm && DatabaseFingerprintsBuiltFor == DatabaseFingerprintsKey{ settings.wildcardOperands, WildcardableOperandTypeBitmask, get_func_qty( ) } ) {
+		return;
+	}
+
+	ApplyIndexCacheSize( );
+	UseFMIndex = settings.useFMIndex;
+	WarmUpJobs.Enqueue( WarmUpIndices( settings.useFMIndex, settings.wildcardOperands ), "index warm-up" );
+	if( !WarmUpTimer ) {
+		WarmUpTimer = register_timer( WarmUpTimerInterval, RunIndexWarmUp, nullptr );
+	}
+}
+
+struct IDBListener : public event_listener_t {
+	ssize_t idaapi on_event( ssize_t code, va_list ) override {
+		switch( code ) {
+		case idb_event::byte_patched:
+		case idb_event::segm_added:
+		case idb_event::segm_deleted:
+		case idb_event::segm_start_changed:
+		case idb_event::segm_end_changed:
+		case idb_event::segm_moved:
+		case idb_event::allsegs_moved:
+		case idb_event::closebase:
+			ImageChanged = true;
+			InvalidateDatabaseFingerprints( );
+			break;
+		// Function bounds changed without changing the number of functions
+		case idb_event::func_updated:
+		case idb_event::set_func_start:
+		case idb_event::set_func_end:
+			InvalidateDatabaseFingerprints( );
+			break;
+		case idb_event::auto_empty_finally:
+			StartIndexWarmUp( );
+			break;
+		default:
+			break;
+		}
+		return 0;
+	}
+};
+
+static IDBListener DatabaseChanges;
+
+// Signature for one row selected in the Functions or Names window
+typedef struct {
+	ea_t address;
+	std::string name;
+	Signature signature;	// Empty if generation failed
+	std::string status;		// Why it failed
+} BulkSignature;
+
+static std::vector<BulkSignature> BulkSignatures;
+
+// Decodes the instructions a signature for ea may use, up to maxSignatureLength bytes and inside the function unless it may leave
+static std::expected<PrefixSearchTarget, std::string> BuildPrefixSearchTarget( ea_t ea, bool wildcardOperands, bool continueOutsideOfFunction, uint32_t operandTypeBitmask, bool captureOperands, size_t maxSignatureLength ) {
+	if( !is_code( get_flags( ea ) ) ) {
+		return std::unexpected( "Not code" );
+	}
+	const auto function = get_func( ea );
+	if( function && !continueOutsideOfFunction ) {
+		const auto twins = FindIdenticalFunctions( function, wildcardOperands, operandTypeBitmask );
+		if( !twins.empty( ) ) {
+			return std::unexpected( std::format( "{} identical cop{}, first @ {:X}", twins.size( ), twins.size( ) == 1 ? "y" : "ies", twins.front( ) ) );
+		}
+	}
+
+	PrefixSearchTarget target;
+	uint8_t captureCount = 0;
+	for( auto currentAddress = ea; target.signature.size( ) < maxSignatureLength; ) {
+		insn_t instruction;
+		const auto currentInstructionLength = decode_insn( &instruction, currentAddress );
+		if( currentInstructionLength <= 0 ) {
+			break;
+		}
+		AddInstructionToSignature( target.signature, instruction, wildcardOperands, operandTypeBitmask, captureOperands, captureCount );
+		target.prefixLengths.push_back( target.signature.size( ) );
+		currentAddress += currentInstructionLength;
+		if( !continueOutsideOfFunction && function && get_func( currentAddress ) != function ) {
+			break;
+		}
+	}
+	if( target.prefixLengths.empty( ) ) {
+		return std::unexpected( "Failed to decode first instruction" );
+	}
+	return target;
+}
+
+// Same searches as FindSignatureOccurences without the bin_search3 fallback, which must not run outside of the IDA thread
+static MatchCounter MakeParallelMatchCounter( ) {
+	const auto& snapshot = GetByteSnapshot( );
+	const auto fmIndex = UseFMIndex ? &GetFMIndex( ) : nullptr;
+	const auto positionIndex = UseFMIndex ? nullptr : GetBytePositionIndex( );
+	const auto& corpus = GetNegativeCorpus( );
+	const auto recorder = QueryRecorder.get( );
+	return [&snapshot, fmIndex, positionIndex, &corpus, recorder]( const Signature& signature, size_t limit ) {
+		// Each thread queries from its own arena, so the workers do not contend on the heap
+		ArenaScope arena;
+		const auto isTimed = recorder || SIGMAKER_PROBE_ENABLED( query );
+		const auto start = isTimed ? std::chrono::steady_clock::now( ) : std::chrono::steady_clock::time_point( );
+		size_t matches = 0;
+		if( positionIndex ) {
+			matches = positionIndex->FindMatches( signature, limit, arena.Resource( ) ).size( );
+		}
+		else if( const auto fmMatches = fmIndex ? fmIndex->FindMatches( signature, limit, FMIndex::DefaultMaxCandidates, arena.Resource( ) ) : std::nullopt ) {
+			matches = fmMatches->size( );
+		}
+		else {
+			matches = FindGapSignatureMatches( snapshot, signature, limit ).size( );
+		}
+		if( isTimed ) {
+			const auto nanoseconds = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ) - start ).count( ) );
+			FireQueryProbe( signature, matches, nanoseconds );
+			if( recorder ) {
+				recorder->Record( signature, limit == SIZE_MAX ? UINT64_MAX : limit, matches, nanoseconds, false );
+			}
+		}
+		// A unique signature must not match anywhere in the negative corpus either
+		if( matches == 1 && !corpus.IsEmpty( ) ) {
+			matches += corpus.CountOccurences( signature, limit - 1 );
+		}
+		return matches;
+	};
+}
+
+// Instructions are decoded on the IDA thread, the uniqueness searches of all targets then run in parallel
+static void GenerateBulkSignatures( const std::vector<ea_t>& addresses, bool wildcardOperands, bool continueOutsideOfFunction, uint32_t operandTypeBitmask, bool captureOperands ) {
+	const auto start = std::chrono::steady_clock::now( );
+	BulkSignatures.clear( );
+
+	std::vector<PrefixSearchTarget> targets;
+	std::vector<size_t> targetRows;
+	for( size_t i = 0; i < addresses.size( ); i++ ) {
+		if( user_cancelled( ) ) {
+			return;
+		}
+		replace_wait_box( "Decoding %llu of %llu...", i + 1, addresses.size( ) );
+
+		const auto ea = addresses[i];
+		qstring name;
+		get_name( &name, ea );
+		auto& row = BulkSignatures.emplace_back( BulkSignature{ ea, name.c_str( ), {}, {} } );
+		auto target = BuildPrefixSearchTarget( ea, wildcardOperands, continueOutsideOfFunction, operandTypeBitmask, captureOperands, 1000 );
+		if( !target.has_value( ) ) {
+			row.status = target.error( );
+			continue;
+		}
+		targets.push_back( std::move( target.value( ) ) );
+		targetRows.push_back( i );
+	}
+
+	replace_wait_box( "Searching unique signatures for %llu addresses...", targets.size( ) );
+	const auto results = FindShortestUniquePrefixes( targets, MakeParallelMatchCounter( ), PartialResultMaxOccurences );
+
+	size_t unique = 0;
+	for( size_t t = 0; t < targets.size( ); t++ ) {
+		auto& row = BulkSignatures[targetRows[t]];
+		const auto& result = results[t];
+		if( !result.isChecked ) {
+			row.status = "Cancelled";
+		}
+		else if( result.length == 0 ) {
+			row.status = std::format( "Not unique, {}{} occurences", result.occurences >= PartialResultMaxOccurences ? ">=" : "", result.occurences );
+		}
+		else {
+			row.signature.assign( targets[t].signature.begin( ), targets[t].signature.begin( ) + result.length );
+			TrimSignature( row.signature );
+			unique++;
+		}
+	}
+	msg( "Bulk signatures: %llu of %llu unique in %.0f ms\n", unique, addresses.size( ), std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+}
+
+// Results of the last bulk generation, kept open next to the Functions window
+class BulkSignatureChooser : public chooser_t {
+public:
+	static constexpr const char* Title = PLUGIN_NAME ": bulk signatures";
+
+	BulkSignatureChooser( ) : chooser_t( CH_KEEP | CH_CAN_REFRESH, qnumber( widths ), widths, header, Title ) {
+	}
+
+	size_t idaapi get_count( ) const override {
+		return BulkSignatures.size( );
+	}
+
+	void idaapi get_row( qstrvec_t* cols, int*, chooser_item_attrs_t*, size_t n ) const override {
+		const auto& row = BulkSignatures[n];
+		( *cols )[0] = std::format( "{:X}", row.address ).c_str( );
+		( *cols )[1] = row.name.c_str( );
+		( *cols )[2] = row.signature.empty( ) ? "" : std::to_string( row.signature.size( ) ).c_str( );
+		( *cols )[3] = row.signature.empty( ) ? row.status.c_str( ) : FormatSignature( row.signature, static_cast<SignatureType>( DialogValues.outputFormat ) ).c_str( );
+	}
+
+	ea_t idaapi get_ea( size_t n ) const override {
+		return BulkSignatures[n].address;
+	}
+
+private:
+	static constexpr int widths[] = { 16 | CHCOL_HEX, 32, 6 | CHCOL_DEC, 80 };
+	static constexpr const char* header[] = { "Address", "Name", "Length", "Signature" };
+};
+
+static BulkSignatureChooser BulkChooser;
+
+// Creates signatures for all rows selected in the Functions or Names window
+struct BulkGenerateHandler : public action_handler_t {
+	int idaapi activate( action_activation_ctx_t* ctx ) override {
+		std::vector<ea_t> addresses;
+		for( const auto row : ctx->chooser_selection ) {
+			if( ctx->widget_type == BWN_FUNCS ) {
+				if( const auto function = getn_func( row ) ) {
+					addresses.push_back( function->start_ea );
+				}
+			}
+			else {
+				addresses.push_back( get_nlist_ea( row ) );
+			}
+		}
+		if( addresses.empty( ) ) {
+			return 0;
+		}
+
+		const auto settings = GetSettings( );
+		PrepareImage( settings );
+		show_wait_box( "Generating %llu signatures...", addresses.size( ) );
+		GenerateBulkSignatures( addresses, settings.wildcardOperands, settings.continueOutsideOfFunction, WildcardableOperandTypeBitmask, settings.captureOperands );
+		hide_wait_box( );
+		FinishDiagnostics( settings );
+
+		BulkChooser.choose( );
+		refresh_chooser( BulkSignatureChooser::Title );
+		return 1;
+	}
+
+	action_state_t idaapi update( action_update_ctx_t* ctx ) override {
+		return ctx->widget_type == BWN_FUNCS || ctx->widget_type == BWN_NAMES ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+	}
+};
+
+// Prints every generated signature in one block, ready to be copied from the output window
+struct BulkPrintHandler : public action_handler_t {
+	int idaapi activate( action_activation_ctx_t* ) override {
+		const auto sigType = static_cast<SignatureType>( DialogValues.outputFormat );
+		for( const auto& row : BulkSignatures ) {
+			if( !row.signature.empty( ) ) {
+				msg( "%s\n", std::format( "{:X} {}: {}", row.address, row.name, FormatSignature( row.signature, sigType ) ).c_str( ) );
+			}
+		}
+		return 1;
+	}
+
+	action_state_t idaapi update( action_update_ctx_t* ) override {
+		return AST_ENABLE_FOR_WIDGET;
+	}
+};
+
+// The resolver export of the main dialog then writes them out
+struct BulkExportHandler : public action_handler_t {
+	int idaapi activate( action_activation_ctx_t* ) override {
+		for( const auto& row : BulkSignatures ) {
+			if( !row.signature.empty( ) ) {
+				AddToResolverExportSet( row.signature, row.address, row.address );
+			}
+		}
+		return 1;
+	}
+
+	action_state_t idaapi update( action_update_ctx_t* ) override {
+		return AST_ENABLE_FOR_WIDGET;
+	}
+};
+
+static BulkGenerateHandler BulkGenerate;
+static BulkPrintHandler BulkPrint;
+static BulkExportHandler BulkExport;
 
-	// Check what processor we have
-	if( IsARM( ) ) {
-		IS_ARM = true;
+constexpr auto BulkGenerateAction = "sigmaker:bulk_generate";
+constexpr auto BulkPrintAction = "sigmaker:bulk_print";
+constexpr auto BulkExportAction = "sigmaker:bulk_export";
+
+// Adds the actions to the context menus they apply to
+struct PopupListener : public event_listener_t {
+	ssize_t idaapi on_event( ssize_t code, va_list va ) override {
+		if( code != ui_finish_populating_widget_popup ) {
+			return 0;
+		}
+		const auto widget = va_arg( va, TWidget* );
+		const auto popup = va_arg( va, TPopupMenu* );
+		const auto widgetType = get_widget_type( widget );
+		if( widgetType == BWN_DISASM ) {
+			for( const auto action : { UniqueSignatureAction, XRefSignaturesAction, CopySelectionAction, SearchSignatureAction } ) {
+				attach_action_to_popup( widget, popup, action, PLUGIN_NAME "/" );
+			}
+		}
+		else if( widgetType == BWN_FUNCS || widgetType == BWN_NAMES ) {
+			attach_action_to_popup( widget, popup, BulkGenerateAction );
+		}
+		else if( qstring title; widgetType == BWN_CHOOSER && get_widget_title( &title, widget ) && title == BulkSignatureChooser::Title ) {
+			attach_action_to_popup( widget, popup, BulkPrintAction );
+			attach_action_to_popup( widget, popup, BulkExportAction );
+		}
+		return 0;
 	}
+};
+
+static PopupListener Popups;
+
+plugin_ctx_t::plugin_ctx_t( ) {
+	const action_desc_t actions[] = {
+		ACTION_DESC_LITERAL_PLUGMOD( UniqueSignatureAction, UniqueSignatureLabel, &UniqueSignatureHandler, this, "Ctrl-Alt-Shift-S", "Create a unique signature for the current address with the last used options", -1 ),
+		ACTION_DESC_LITERAL_PLUGMOD( XRefSignaturesAction, "Create XREF signatures", &XRefSignaturesHandler, this, "Ctrl-Alt-Shift-X", "Create signatures at the references to the current address with the last used options", -1 ),
+		ACTION_DESC_LITERAL_PLUGMOD( CopySelectionAction, "Copy selected code as signature", &CopySelectionHandler, this, "Ctrl-Alt-Shift-C", "Print the selected code as signature with the last used options", -1 ),
+		ACTION_DESC_LITERAL_PLUGMOD( SearchSignatureAction, "Search for a signature", &SearchSignatureHandler, this, "Ctrl-Alt-Shift-F", "Search for a signature, starting with the last generated one", -1 ),
+		ACTION_DESC_LITERAL_PLUGMOD( BulkGenerateAction, "Create unique signatures for selection", &BulkGenerate, this, nullptr, "Create signatures for all selected functions or names at once", -1 ),
+		ACTION_DESC_LITERAL_PLUGMOD( BulkPrintAction, "Print all signatures", &BulkPrint, this, nullptr, "Print all generated signatures to the output window", -1 ),
+		ACTION_DESC_LITERAL_PLUGMOD( BulkExportAction, "Add all to resolver export set", &BulkExport, this, nullptr, "Collect all generated signatures for the C++ resolver export", -1 ),
+	};
+	for( const auto& action : actions ) {
+		register_action( action );
+	}
+	hook_event_listener( HT_UI, &Popups, this );
+	hook_event_listener( HT_IDB, &DatabaseChanges, this );
+
+	// Parallel work is cancelled from the wait box, the check only runs on this thread
+	// Installed before any action can use the pool, including the bulk action that does not go through the dialog
+	SetThreadPoolCancellationCheck( [ ]( ) { return user_cancelled( ); } );
+}
+
+plugin_ctx_t::~plugin_ctx_t( ) {
+	unhook_event_listener( HT_IDB, &DatabaseChanges );
+	unhook_event_listener( HT_UI, &Popups );
+	CancelIndexWarmUp( );
+	CancelBackgroundJobs( );
+	StopQueryTrace( );
+}
+
+bool idaapi plugin_ctx_t::run( size_t ) {
 
 	// Show dialog
 	const char format[] =
@@ -498,7 +2400,13 @@ bool idaapi plugin_ctx_t::run( size_t ) {
 		"<#Select an address, and create a code signature for it#Create unique Signature for current code address:R>\n"												// Radio Button 0
 		"<#Select an address or variable, and create code signatures for its references. Will output the shortest 5 signatures#Find shortest XREF Signature for current data or code address:R>\n"			// Radio Button 1
 		"<#Select 1+ instructions, and copy the bytes using the specified output format#Copy selected code:R>\n"													// Radio Button 2
-		"<#Paste any string containing your signature/mask and find matches#Search for a signature:R>>\n"															// Radio Button 3
+		"<#Paste any string containing your signature/mask and find matches#Search for a signature:R>\n"															// Radio Button 3
+		"<#Write a C++ header/source pair that resolves all collected signatures in one scan#Export collected signatures as C++ resolver:R>\n"					// Radio Button 4
+		"<#Find the shortest signature near the current address that occurs exactly once in this and all other builds#Create signature stable across other builds:R>\n"		// Radio Button 5
+		"<#Hash the normalized instructions of all functions and save them to a file#Export function fingerprints:R>\n"												// Radio Button 6
+		"<#Find functions of this database that are unchanged in the database a fingerprint file was exported from#Match function fingerprints from file:R>\n"	// Radio Button 7
+		"<#Show how the number of matches drops with each instruction added to the signature of the current address#Show uniqueness profile for current address:R>\n"	// Radio Button 8
+		"<#Stop all unique and XREF signature generations running in the background#Cancel background jobs:R>>\n"																// Radio Button 9
 
 		"Output format:\n"																																			// Title
 		"<#Example - E8 ? ? ? ? 45 33 F6 66 44 89 34 33#IDA Signature:R>\n"																							// Radio Button 0
@@ -508,80 +2416,130 @@ bool idaapi plugin_ctx_t::run( size_t ) {
 
 		"Options:\n"																																				// Title
 		"<#Enable wildcarding for operands, to improve stability of created signatures#Wildcards for operands:C>\n"													// Checkbox Button 0											
-		"<#Don't stop signature generation when reaching end of function#Continue when leaving function scope:C>>\n"												// Checkbox Button 1
-		"<#Configure operand types that should be wildcarded#Operand types...:B::::>\n";																			// Button 0
-
-	static short action = 0;
-	static short outputFormat = 0;
-	static short options = ( 1 << 0 | 0 << 1 );
+		"<#Don't stop signature generation when reaching end of function#Continue when leaving function scope:C>\n"												// Checkbox Button 1
+		"<#Collect generated signatures for the C++ resolver export#Add results to resolver export set:C>\n"														// Checkbox Button 2
+		"<#Mark wildcarded operands as capture groups, searching then prints their values#Capture wildcarded operands:C>\n"										// Checkbox Button 3
+		"<#Prefer XREF and cross build signatures that are cheapest for a runtime scanner over the shortest ones#Rank by expected scan cost:C>\n"						// Checkbox Button 4
+		"<#Use a compressed FM-index of about the image size instead of the faster position index, for large images on machines with little memory#Low memory index:C>\n"	// Checkbox Button 5
+		"<#Generate unique and XREF signatures while IDA stays usable, results are printed when done#Run in background:C>\n"											// Checkbox Button 6
+		"<#Build the snapshot and index of the image while IDA is idle after the auto-analysis, so the first signature does not wait for them#Build index after auto-analysis:C>>\n"		// Checkbox Button 7
+		"<#Return the best signature found so far when the time runs out, 0 disables the limit#Time limit in ms:D:10:10::>\n"										// Number input 0
+		"<#Threads shared by all parallel scans including the IDA thread, 0 uses all cores#Worker threads:D:10:10::>\n"											// Number input 1
+		"<#Indices of images seen before are loaded from the IDA user directory, shared by all databases, 0 disables the cache#Index cache in MB:D:10:10::>\n"		// Number input 2
+		"<#Configure operand types that should be wildcarded#Operand types...:B::::>\n"																			// Button 0
+		"<#Configure other binaries, like modules loaded into the same process, generated signatures must not match in#Negative corpus...:B::::>\n"					// Button 1
+		"<#Configure other builds of this binary for cross build signatures#Other builds...:B::::>\n"												// Button 2
+		"<#Options for debugging the plugin, like tracing tasks, recording queries and self-checking searches#Diagnostics...:B::::>\n";				// Button 3
+
+	auto& [action, outputFormat, options, timeLimit, threadCount, cacheSize, diagnostics] = DialogValues;
+	if( ask_form( format, &action, &outputFormat, &options, &timeLimit, &threadCount, &cacheSize, &ConfigureOperandWildcardBitmask, &ConfigureNegativeCorpus, &ConfigureCrossBuilds, &ConfigureDiagnostics ) ) {
+		const auto settings = GetSettings( );
+		PrepareImage( settings );
 
-	if( ask_form( format, &action, &outputFormat, &options, &ConfigureOperandWildcardBitmask ) ) {
-		const auto wildcardOperands = options & ( 1 << 0 );
-		const auto continueOutsideOfFunction = options & ( 1 << 1 );
-
-		const auto sigType = static_cast<SignatureType>( outputFormat );
 		switch( action ) {
 		case 0:
-		{
 			// Find unique signature for current address
-			const auto ea = get_screen_ea( );
-
-			show_wait_box( "Generating signature..." );
-
-			auto signature = GenerateUniqueSignatureForEA( ea, wildcardOperands, continueOutsideOfFunction, WildcardableOperandTypeBitmask );
-			PrintSignatureForEA( signature, ea, sigType );
-
-			hide_wait_box( );
+			CreateUniqueSignatureAtCursor( settings );
 			break;
-		}
 		case 1:
-		{
 			// Find XREFs for current selection, generate signatures up to 250 bytes length
+			CreateXRefSignaturesAtCursor( settings );
+			break;
+		case 2:
+			// Print selected code as signature
+			CopySelectedCode( settings );
+			break;
+		case 3:
+			// Search for a signature
+			SearchSignature( settings );
+			break;
+		case 4:
+		{
+			// Export collected signatures as resolver code
+			const auto& entries = GetResolverExportSet( );
+			if( entries.empty( ) ) {
+				msg( "No signatures collected yet, enable \"Add results to resolver export set\" first\n" );
+				break;
+			}
+			const auto path = ask_file( true, "*.h", "Save resolver header (%llu signatures)", entries.size( ) );
+			if( path ) {
+				auto basePath = std::filesystem::path( path ).replace_extension( ).string( );
+				auto result = ExportResolverCode( entries, basePath );
+				if( !result.has_value( ) ) {
+					msg( "Error: %s\n", result.error( ).c_str( ) );
+				}
+			}
+			break;
+		}
+		case 5:
+		{
+			// Find a signature that works in all builds
 			const auto ea = get_screen_ea( );
-			std::vector<std::tuple<ea_t, Signature>> xrefSignatures;
 
-			show_wait_box( "Finding references and generating signatures. This can take a while..." );
+			show_wait_box( "Generating cross build signature..." );
 
-			FindXRefs( ea, wildcardOperands, continueOutsideOfFunction, xrefSignatures, 250, WildcardableOperandTypeBitmask );
-
-			// Print top 5 shortest signatures
-			PrintXRefSignaturesForEA( ea, xrefSignatures, sigType, 5 );
+			auto signature = GenerateCrossBuildSignatureForEA( ea, settings.wildcardOperands, WildcardableOperandTypeBitmask, settings.captureOperands, 250, settings.rankByScanCost, settings.deadline );
+			PrintCrossBuildSignatureForEA( signature, ea, settings.sigType, GetCrossBuildCorpus( ).FileCount( ) );
+			if( settings.collectForExport && signature.has_value( ) ) {
+				AddToResolverExportSet( signature.value( ).signature, signature.value( ).address, ea );
+			}
 
 			hide_wait_box( );
 			break;
 		}
-		case 2:
+		case 6:
 		{
-			// Print selected code as signature
-			ea_t start, end;
-			if( read_range_selection( get_current_viewer( ), &start, &end ) ) {
-				show_wait_box( "Please stand by..." );
-
-				PrintSelectedCode( start, end, sigType, wildcardOperands, WildcardableOperandTypeBitmask );
-
+			// Export function fingerprints of this database
+			const auto path = ask_file( true, "*.sigfp", "Save function fingerprints" );
+			if( path ) {
+				show_wait_box( "Fingerprinting functions..." );
+				ExportFingerprints( path, WildcardableOperandTypeBitmask );
 				hide_wait_box( );
 			}
-			else {
-				msg( "Select a range to copy the code\n" );
+			break;
+		}
+		case 7:
+		{
+			// Match functions against fingerprints of another database
+			const auto path = ask_file( false, "*.sigfp", "Load function fingerprints of another database" );
+			if( path ) {
+				show_wait_box( "Matching function fingerprints..." );
+				MatchFingerprints( path );
+				hide_wait_box( );
 			}
 			break;
 		}
-		case 3:
+		case 8:
 		{
-			// Search for a signature
-			qstring inputSignatureQstring;
-			if( ask_str( &inputSignatureQstring, HIST_SRCH, "Enter a signature" ) ) {
-				show_wait_box( "Searching..." );
+			// Show the occurences after each instruction
+			const auto ea = get_screen_ea( );
 
-				SearchSignatureString( inputSignatureQstring.c_str( ) );
+			show_wait_box( "Building uniqueness profile..." );
+			const auto profile = BuildUniquenessProfile( ea, settings.wildcardOperands, settings.continueOutsideOfFunction, WildcardableOperandTypeBitmask );
+			hide_wait_box( );
 
-				hide_wait_box( );
+			if( !profile.has_value( ) ) {
+				msg( "Error: %s\n", profile.error( ).c_str( ) );
+				break;
+			}
+			PrintUniquenessProfile( ea, profile.value( ) );
+
+			const auto path = ask_file( true, "*.csv", "Append profile to CSV file (cancel to skip)" );
+			if( path ) {
+				if( const auto result = AppendUniquenessProfileCSV( path, ea, profile.value( ) ); !result.has_value( ) ) {
+					msg( "Error: %s\n", result.error( ).c_str( ) );
+				}
 			}
 			break;
 		}
+		case 9:
+			CancelBackgroundJobs( );
+			break;
 		default:
 			break;
 		}
+
+		FinishDiagnostics( settings );
 	}
 	return true;
 }
@@ -14,18 +14,25 @@
 
 #include "Version.h"
 #include "Plugin.h"
+#include "SignatureTypes.h"
 
-// Signature types and structures
-enum class SignatureType : uint32_t {
-	IDA = 0,
-	x64Dbg,
-	Signature_Mask,
-	SignatureByteArray_Bitmask
-};
+// Signature generated at a reference, more than one occurence marks a partial result
+typedef struct {
+	ea_t address;
+	Signature signature;
+	size_t occurences;
+	double scanCost;
+} XRefSignature;
 
+// Signature that occurs exactly once in the database and in every other build, starting near the target
 typedef struct {
-	uint8_t value;
-	bool isWildcard;
-} SignatureByte;
+	ea_t address;
+	Signature signature;
+} CrossBuildSignature;
 
-using Signature = std::vector<SignatureByte>;
+// Occurences of a signature after one more instruction was added
+typedef struct {
+	ea_t address;
+	size_t length;
+	size_t occurences;
+} ProfileStep;
@@ -0,0 +1,73 @@
+#include "NarrowingSearch.h"
+
+#include <algorithm>
+#include <cstring>
+
+static bool MatchesRange( const uint8_t* data, const Signature& signature, size_t begin, size_t end ) {
+	for( size_t i = begin; i < end; i++ ) {
+		if( !signature[i].isWildcard && data[i] != signature[i].value ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void NarrowingSearch::InitialScan( const Signature& signature ) {
+	// Skip to the rarest concrete byte, the caller made sure there is one
+	size_t anchor = SIZE_MAX;
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		if( !signature[i].isWildcard && ( anchor == SIZE_MAX || snapshot.histogram[signature[i].value] < snapshot.histogram[signature[anchor].value] ) ) {
+			anchor = i;
+		}
+	}
+
+	const auto data = snapshot.bytes.data( );
+	for( const auto& segment : snapshot.segments ) {
+		if( segment.size < signature.size( ) ) {
+			continue;
+		}
+		const auto segmentEnd = segment.offset + segment.size;
+		const auto last = segmentEnd - signature.size( );
+		auto position = segment.offset;
+		while( position <= last ) {
+			const auto found = static_cast<const uint8_t*>( std::memchr( data + position + anchor, signature[anchor].value, last - position + 1 ) );
+			if( !found ) {
+				break;
+			}
+			position = static_cast<size_t>( found - data ) - anchor;
+			if( MatchesRange( data + position, signature, 0, signature.size( ) ) ) {
+				candidates.push_back( position );
+				candidateEnds.push_back( segmentEnd );
+			}
+			position++;
+		}
+	}
+	scanned = true;
+}
+
+size_t NarrowingSearch::Extend( const Signature& signature ) {
+	if( !scanned ) {
+		// A signature of wildcards matches almost everywhere, wait for the first concrete byte
+		if( std::ranges::all_of( signature, []( const auto& b ) { return b.isWildcard; } ) ) {
+			return snapshot.bytes.size( ) >= signature.size( ) ? snapshot.bytes.size( ) - signature.size( ) + 1 : 0;
+		}
+		InitialScan( signature );
+		checkedLength = signature.size( );
+		return candidates.size( );
+	}
+
+	// Only the new bytes need to be checked
+	size_t kept = 0;
+	const auto data = snapshot.bytes.data( );
+	for( size_t i = 0; i < candidates.size( ); i++ ) {
+		if( candidates[i] + signature.size( ) <= candidateEnds[i] && MatchesRange( data + candidates[i], signature, checkedLength, signature.size( ) ) ) {
+			candidates[kept] = candidates[i];
+			candidateEnds[kept] = candidateEnds[i];
+			kept++;
+		}
+	}
+	candidates.resize( kept );
+	candidateEnds.resize( kept );
+	checkedLength = signature.size( );
+	return kept;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ByteSnapshot.h"
+#include "SignatureTypes.h"
+
+// Counts the occurences of a signature that grows step by step without rescanning the image
+// The image is scanned once, afterwards each step only checks the new bytes at the remaining candidates
+
+class NarrowingSearch {
+public:
+	explicit NarrowingSearch( const ByteSnapshot& snapshot ) : snapshot( snapshot ) {
+	}
+
+	// The signature must start with the one passed before, jumps are not supported
+	// Returns the number of matches of the whole signature
+	size_t Extend( const Signature& signature );
+
+	// Snapshot offsets of the current matches, empty until the signature has a concrete byte
+	const std::vector<size_t>& Candidates( ) const {
+		return candidates;
+	}
+
+private:
+	void InitialScan( const Signature& signature );
+
+	const ByteSnapshot& snapshot;
+	std::vector<size_t> candidates;
+	std::vector<size_t> candidateEnds;	// End of the segment each candidate is in
+	size_t checkedLength = 0;
+	bool scanned = false;
+};
@@ -8,8 +8,10 @@
 // Plugin specific definitions
 
 struct plugin_ctx_t : public plugmod_t {
-	~plugin_ctx_t( ) {
-	}
+	// Registers the actions for the context menus
+	plugin_ctx_t( );
+	// Cancels the background jobs
+	~plugin_ctx_t( );
 	virtual bool idaapi run( size_t ) override;
 };
 
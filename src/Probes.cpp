@@ -0,0 +1,14 @@
+#include "Probes.h"
+
+#ifdef SIGMAKER_HAS_PROBES
+// Stay in their own section so tracers find them through the probe notes
+#	define SIGMAKER_PROBE_SEMAPHORE( name ) volatile unsigned short sigmaker_##name##_semaphore __attribute__( ( section( ".probes" ) ) ) = 0
+
+extern "C" {
+SIGMAKER_PROBE_SEMAPHORE( generate_start );
+SIGMAKER_PROBE_SEMAPHORE( generate_end );
+SIGMAKER_PROBE_SEMAPHORE( query );
+SIGMAKER_PROBE_SEMAPHORE( xref );
+SIGMAKER_PROBE_SEMAPHORE( scan_chunk );
+}
+#endif
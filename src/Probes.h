@@ -0,0 +1,46 @@
+#pragma once
+
+// Static USDT probes for profiling live sessions on Linux, e.g.
+//   bpftrace -e 'usdt:/path/to/sigmaker.so:sigmaker:query { @ns = hist( arg3 ); }'
+// They are compiled in if <sys/sdt.h> is available, while nothing is attached each costs a nop and the test of its semaphore
+// Arguments that take work to compute, like timings, should only be computed if SIGMAKER_PROBE_ENABLED( name ) is true
+// Define SIGMAKER_DISABLE_PROBES to leave them out
+//
+// Probes and their arguments:
+//   generate_start	ea
+//   generate_end	ea, signature length, occurences (0 if it failed), ns
+//   query			signature length, wildcards, matches, ns
+//   xref			reference address, signature length, occurences (0 if it failed)
+//   scan_chunk		start ea, end ea, match or BADADDR
+
+#if !defined( SIGMAKER_DISABLE_PROBES ) && defined( __has_include )
+#	if __has_include( <sys/sdt.h> )
+// Tracers increment the semaphore of a probe while they are attached to it
+#		define _SDT_HAS_SEMAPHORES 1
+#		include <sys/sdt.h>
+#		define SIGMAKER_HAS_PROBES
+#	endif
+#endif
+
+#ifdef SIGMAKER_HAS_PROBES
+// Defined in Probes.cpp, sys/sdt.h refers to them by these names
+extern "C" {
+extern volatile unsigned short sigmaker_generate_start_semaphore;
+extern volatile unsigned short sigmaker_generate_end_semaphore;
+extern volatile unsigned short sigmaker_query_semaphore;
+extern volatile unsigned short sigmaker_xref_semaphore;
+extern volatile unsigned short sigmaker_scan_chunk_semaphore;
+}
+#	define SIGMAKER_PROBE_ENABLED( name ) __builtin_expect( sigmaker_##name##_semaphore != 0, 0 )
+#	define SIGMAKER_PROBE1( name, a ) DTRACE_PROBE1( sigmaker, name, a )
+#	define SIGMAKER_PROBE3( name, a, b, c ) DTRACE_PROBE3( sigmaker, name, a, b, c )
+#	define SIGMAKER_PROBE4( name, a, b, c, d ) DTRACE_PROBE4( sigmaker, name, a, b, c, d )
+#else
+#	define SIGMAKER_PROBE_ENABLED( name ) false
+// Arguments are not evaluated, naming them in sizeof only keeps the variables they use from being reported as unused
+template<typename... Arguments>
+int UnusedProbeArguments( const Arguments&... );
+#	define SIGMAKER_PROBE1( name, a ) ( ( void )sizeof( UnusedProbeArguments( a ) ) )
+#	define SIGMAKER_PROBE3( name, a, b, c ) ( ( void )sizeof( UnusedProbeArguments( a, b, c ) ) )
+#	define SIGMAKER_PROBE4( name, a, b, c, d ) ( ( void )sizeof( UnusedProbeArguments( a, b, c, d ) ) )
+#endif
@@ -0,0 +1,115 @@
+#include "QueryTrace.h"
+#include "SignatureFormat.h"
+
+#include <charconv>
+#include <format>
+#include <sstream>
+
+// File layout, text:
+//   # SigMaker query trace <version>
+//   image <hash> <size>
+//   per query: q <max matches or *> <matches> <ns> <t if timed out, else -> <signature>
+constexpr std::string_view QueryTraceHeader = "# SigMaker query trace ";
+constexpr uint32_t QueryTraceVersion = 1;
+
+template<typename T>
+static bool ParseNumber( std::string_view text, T& value, int base = 10 ) {
+	const auto [end, error] = std::from_chars( text.data( ), text.data( ) + text.size( ), value, base );
+	return error == std::errc( ) && end == text.data( ) + text.size( );
+}
+
+static std::expected<Signature, std::string> ParseSignature( std::istream& tokens ) {
+	Signature signature;
+	std::string token;
+	while( tokens >> token ) {
+		if( token == "?" ) {
+			signature.push_back( SignatureByte{ 0, true, 0, 0, 0 } );
+			continue;
+		}
+		if( token.size( ) > 2 && token.front( ) == '[' && token.back( ) == ']' ) {
+			const std::string_view range( token.data( ) + 1, token.size( ) - 2 );
+			const auto dash = range.find( '-' );
+			uint16_t jumpMin = 0, jumpMax = 0;
+			const auto isValid = dash == std::string_view::npos
+				? ParseNumber( range, jumpMin ) && ParseNumber( range, jumpMax )
+				: ParseNumber( range.substr( 0, dash ), jumpMin ) && ParseNumber( range.substr( dash + 1 ), jumpMax );
+			if( !isValid || jumpMax == 0 || jumpMin > jumpMax ) {
+				return std::unexpected( std::format( "Invalid jump {}", token ) );
+			}
+			signature.push_back( SignatureByte{ 0, true, jumpMin, jumpMax, 0 } );
+			continue;
+		}
+		uint8_t value = 0;
+		if( token.size( ) != 2 || !ParseNumber( token, value, 16 ) ) {
+			return std::unexpected( std::format( "Invalid byte {}", token ) );
+		}
+		signature.push_back( SignatureByte{ value, false, 0, 0, 0 } );
+	}
+	if( signature.empty( ) ) {
+		return std::unexpected( "Empty signature" );
+	}
+	return signature;
+}
+
+std::expected<std::unique_ptr<QueryTraceRecorder>, std::string> QueryTraceRecorder::Open( const std::string& path, uint64_t imageHash, uint64_t imageSize ) {
+	std::ofstream file( path, std::ios::trunc );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+	file << QueryTraceHeader << QueryTraceVersion << '\n';
+	file << std::format( "image {:016X} {}\n", imageHash, imageSize );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to write {}", path ) );
+	}
+	return std::unique_ptr<QueryTraceRecorder>( new QueryTraceRecorder( std::move( file ), path ) );
+}
+
+void QueryTraceRecorder::Record( const Signature& signature, uint64_t maxMatches, uint64_t matches, uint64_t nanoseconds, bool timedOut ) {
+	// Formatted before locking, the lock only covers the write
+	const auto line = std::format( "q {} {} {} {} {}\n", maxMatches == UINT64_MAX ? std::string( "*" ) : std::to_string( maxMatches ), matches, nanoseconds, timedOut ? 't' : '-', BuildIDASignatureString( signature, false, false ) );
+	std::scoped_lock lock( mutex );
+	file << line;
+	queryCount++;
+}
+
+std::expected<QueryTrace, std::string> LoadQueryTrace( const std::string& path ) {
+	std::ifstream file( path );
+	if( !file ) {
+		return std::unexpected( std::format( "Failed to open {}", path ) );
+	}
+
+	std::string line;
+	uint32_t version = 0;
+	if( !std::getline( file, line ) || !line.starts_with( QueryTraceHeader ) || !ParseNumber( std::string_view( line ).substr( QueryTraceHeader.size( ) ), version ) ) {
+		return std::unexpected( std::format( "{} is not a query trace", path ) );
+	}
+	if( version != QueryTraceVersion ) {
+		return std::unexpected( std::format( "{} has unsupported version {}", path, version ) );
+	}
+
+	QueryTrace trace{ 0, 0, {} };
+	std::string imageHash;
+	if( !std::getline( file, line ) || !( std::istringstream( line ) >> imageHash >> imageHash >> trace.imageSize ) || !ParseNumber( imageHash, trace.imageHash, 16 ) ) {
+		return std::unexpected( std::format( "{} has no image hash", path ) );
+	}
+
+	for( size_t lineNumber = 3; std::getline( file, line ); lineNumber++ ) {
+		std::istringstream tokens( line );
+		std::string kind, maxMatches, timedOut;
+		RecordedQuery query{ {}, UINT64_MAX, 0, 0, false };
+		if( !( tokens >> kind >> maxMatches >> query.matches >> query.nanoseconds >> timedOut ) || kind != "q" ) {
+			return std::unexpected( std::format( "{}:{}: invalid query", path, lineNumber ) );
+		}
+		if( maxMatches != "*" && !ParseNumber( maxMatches, query.maxMatches ) ) {
+			return std::unexpected( std::format( "{}:{}: invalid match limit {}", path, lineNumber, maxMatches ) );
+		}
+		query.timedOut = timedOut == "t";
+		auto signature = ParseSignature( tokens );
+		if( !signature.has_value( ) ) {
+			return std::unexpected( std::format( "{}:{}: {}", path, lineNumber, signature.error( ) ) );
+		}
+		query.signature = std::move( signature.value( ) );
+		trace.queries.push_back( std::move( query ) );
+	}
+	return trace;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <expected>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SignatureTypes.h"
+
+// Log of the uniqueness and search queries of a session, replayed by tools/QueryReplay.cpp against a dump of the image
+// One query per line, signatures are stored in IDA style so traces can be read and edited, capture groups are dropped
+// This module does not depend on the IDA SDK
+
+typedef struct {
+	Signature signature;
+	uint64_t maxMatches;	// UINT64_MAX if all matches were wanted
+	uint64_t matches;
+	uint64_t nanoseconds;
+	bool timedOut;			// Cut short by a deadline, so matches may be incomplete
+} RecordedQuery;
+
+typedef struct {
+	uint64_t imageHash;		// ByteSnapshot::Hash of the image the queries ran on
+	uint64_t imageSize;
+	std::vector<RecordedQuery> queries;
+} QueryTrace;
+
+// Appends queries from any thread
+class QueryTraceRecorder {
+public:
+	static std::expected<std::unique_ptr<QueryTraceRecorder>, std::string> Open( const std::string& path, uint64_t imageHash, uint64_t imageSize );
+
+	void Record( const Signature& signature, uint64_t maxMatches, uint64_t matches, uint64_t nanoseconds, bool timedOut );
+
+	// Safe while other threads record
+	size_t QueryCount( ) const {
+		return queryCount.load( std::memory_order_relaxed );
+	}
+	const std::string& Path( ) const {
+		return path;
+	}
+
+private:
+	QueryTraceRecorder( std::ofstream file, std::string path ) : file( std::move( file ) ), path( std::move( path ) ) {
+	}
+
+	std::mutex mutex;
+	std::ofstream file;
+	std::string path;
+	std::atomic<size_t> queryCount = 0;
+};
+
+std::expected<QueryTrace, std::string> LoadQueryTrace( const std::string& path );
@@ -0,0 +1,315 @@
+#include "ResolverExport.h"
+#include "SignatureUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string_view>
+
+#include <name.hpp>
+#include <nalt.hpp>
+#include <segment.hpp>
+
+std::vector<ResolverEntry>& GetResolverExportSet( ) {
+	static std::vector<ResolverEntry> entries;
+	return entries;
+}
+
+// Keywords and the names the generated code declares next to the targets
+constexpr std::array<std::string_view, 93> ReservedIdentifiers = {
+	"Count", "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char", "char8_t", "char16_t",
+	"char32_t", "class", "compl", "concept", "const", "consteval", "constexpr", "constinit", "const_cast", "continue", "co_await", "co_return",
+	"co_yield", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float",
+	"for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+	"or_eq", "private", "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static",
+	"static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+	"union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"
+};
+
+// Turn an IDA name into a valid and unique C identifier
+static std::string MakeIdentifier( ea_t ea, const std::set<std::string>& usedNames ) {
+	qstring name;
+	std::string identifier;
+	if( get_name( &name, ea ) > 0 ) {
+		for( const auto c : std::string_view( name.c_str( ) ) ) {
+			identifier += std::isalnum( static_cast<unsigned char>( c ) ) ? c : '_';
+		}
+	}
+	if( identifier.empty( ) || std::isdigit( static_cast<unsigned char>( identifier[0] ) ) ) {
+		identifier = std::format( "target_{:X}", ea - get_imagebase( ) ) + identifier;
+	}
+
+	auto unique = identifier;
+	const auto isTaken = [&]( const std::string& name ) {
+		return usedNames.contains( name ) || std::ranges::find( ReservedIdentifiers, name ) != ReservedIdentifiers.end( );
+	};
+	for( size_t i = 2; isTaken( unique ); i++ ) {
+		unique = std::format( "{}_{}", identifier, i );
+	}
+	return unique;
+}
+
+static std::vector<ResolveStep> BuildResolveSteps( ea_t signatureEa, ea_t targetEa ) {
+	std::vector<ResolveStep> steps;
+	if( signatureEa == targetEa ) {
+		return steps;
+	}
+
+	// Signature sits on a reference to the target, prefer following the rel32 so the resolver does not depend on the layout between both
+	insn_t instruction;
+	if( decode_insn( &instruction, signatureEa ) > 0 ) {
+		for( const auto& op : instruction.ops ) {
+			if( op.type == o_void ) {
+				break;
+			}
+			if( op.offb == 0 || op.offb + 4 > instruction.size ) {
+				continue;
+			}
+			const auto rel32 = static_cast<int32_t>( get_dword( signatureEa + op.offb ) );
+			if( signatureEa + instruction.size + rel32 == targetEa ) {
+				steps.push_back( ResolveStep{ ResolveStepType::FollowRel32, op.offb, static_cast<uint8_t>( instruction.size ) } );
+				return steps;
+			}
+		}
+	}
+
+	// Otherwise rely on the distance inside the module
+	steps.push_back( ResolveStep{ ResolveStepType::AddOffset, static_cast<int64_t>( targetEa - signatureEa ), 0 } );
+	return steps;
+}
+
+void AddToResolverExportSet( const Signature& signature, ea_t signatureEa, ea_t targetEa ) {
+	auto& entries = GetResolverExportSet( );
+
+	std::set<std::string> usedNames;
+	for( const auto& entry : entries ) {
+		// Replace an older signature for the same target
+		if( entry.targetEa == targetEa ) {
+			continue;
+		}
+		usedNames.insert( entry.name );
+	}
+	std::erase_if( entries, [&]( const auto& entry ) { return entry.targetEa == targetEa; } );
+
+	ResolverEntry entry{ MakeIdentifier( targetEa, usedNames ), signature, signatureEa, targetEa, BuildResolveSteps( signatureEa, targetEa ) };
+	msg( "Added %s to resolver export set (%llu entries)\n", entry.name.c_str( ), entries.size( ) + 1 );
+	entries.push_back( std::move( entry ) );
+}
+
+// Byte frequencies of the loaded image, used to pick the rarest concrete byte as scan anchor
+static std::array<uint64_t, 256> GetImageByteHistogram( ) {
+	std::array<uint64_t, 256> histogram{};
+	std::vector<uint8_t> buffer( 0x10000 );
+	for( auto segment = get_first_seg( ); segment; segment = get_next_seg( segment->start_ea ) ) {
+		for( auto ea = segment->start_ea; ea < segment->end_ea; ea += buffer.size( ) ) {
+			const auto size = static_cast<ssize_t>( std::min<ea_t>( buffer.size( ), segment->end_ea - ea ) );
+			const auto read = get_bytes( buffer.data( ), size, ea );
+			for( ssize_t i = 0; i < read; i++ ) {
+				histogram[buffer[i]]++;
+			}
+		}
+	}
+	return histogram;
+}
+
+static std::string FormatByteList( const Signature& signature, bool mask ) {
+	std::string result;
+	for( const auto& byte : signature ) {
+		if( !result.empty( ) ) {
+			result += ", ";
+		}
+		result += mask ? ( byte.isWildcard ? "0x00" : "0xFF" ) : std::format( "0x{:02X}", byte.isWildcard ? 0 : byte.value );
+	}
+	return result;
+}
+
+std::expected<void, std::string> ExportResolverCode( const std::vector<ResolverEntry>& entries, const std::string& basePath ) {
+	if( entries.empty( ) ) {
+		return std::unexpected( "Resolver export set is empty" );
+	}
+
+	const std::filesystem::path headerPath = basePath + ".h";
+	const std::filesystem::path sourcePath = basePath + ".cpp";
+	auto namespaceName = headerPath.stem( ).string( );
+	for( auto& c : namespaceName ) {
+		if( !std::isalnum( static_cast<unsigned char>( c ) ) ) {
+			c = '_';
+		}
+	}
+	if( namespaceName.empty( ) || std::isdigit( static_cast<unsigned char>( namespaceName[0] ) ) ) {
+		namespaceName = "signatures_" + namespaceName;
+	}
+
+	const auto histogram = GetImageByteHistogram( );
+
+	// Anchor every pattern on its rarest concrete byte, patterns are bucketed by that byte
+	std::vector<size_t> anchors;
+	std::array<std::vector<size_t>, 256> buckets;
+	for( size_t i = 0; i < entries.size( ); i++ ) {
+		const auto& signature = entries[i].signature;
+		size_t anchor = signature.size( );
+		for( size_t j = 0; j < signature.size( ); j++ ) {
+			if( !signature[j].isWildcard && ( anchor == signature.size( ) || histogram[signature[j].value] < histogram[signature[anchor].value] ) ) {
+				anchor = j;
+			}
+		}
+		if( anchor == signature.size( ) ) {
+			return std::unexpected( std::format( "Signature for {} has no concrete bytes", entries[i].name ) );
+		}
+		anchors.push_back( anchor );
+		buckets[signature[anchor].value].push_back( i );
+	}
+
+	std::ostringstream header;
+	header << "#pragma once\n"
+		"// Generated by " PLUGIN_NAME " v" PLUGIN_VERSION ", do not edit\n\n"
+		"#include <stddef.h>\n"
+		"#include <stdint.h>\n\n"
+		"namespace " << namespaceName << " {\n\n"
+		"enum class Target : size_t {\n";
+	for( const auto& entry : entries ) {
+		header << "\t" << entry.name << ",\n";
+	}
+	header << "\tCount\n"
+		"};\n\n"
+		"// Scans the module once and resolves all targets, unresolved targets are set to 0\n"
+		"// Returns the number of resolved targets\n"
+		"size_t ResolveAll( const uint8_t* moduleBase, size_t moduleSize, uintptr_t( &results )[static_cast<size_t>( Target::Count )] );\n\n"
+		"}\n";
+
+	std::ostringstream source;
+	source << "// Generated by " PLUGIN_NAME " v" PLUGIN_VERSION ", do not edit\n"
+		"#include \"" << headerPath.filename( ).string( ) << "\"\n\n"
+		"#include <string.h>\n\n"
+		"namespace " << namespaceName << " {\n\n"
+		"namespace {\n\n"
+		"enum StepType : uint8_t {\n"
+		"\tAddOffset,\n"
+		"\tFollowRel32\n"
+		"};\n\n"
+		"struct Step {\n"
+		"\tStepType type;\n"
+		"\tint64_t offset;\n"
+		"\tuint8_t instructionLength;\n"
+		"};\n\n"
+		"struct Pattern {\n"
+		"\tconst uint8_t* bytes;\n"
+		"\tconst uint8_t* mask;\n"
+		"\tsize_t length;\n"
+		"\tsize_t anchor;\n"
+		"\tconst Step* steps;\n"
+		"\tsize_t stepCount;\n"
+		"};\n\n";
+
+	for( size_t i = 0; i < entries.size( ); i++ ) {
+		const auto& entry = entries[i];
+		source << "// " << entry.name << std::format( " @ RVA 0x{:X}, signature @ RVA 0x{:X}\n", entry.targetEa - get_imagebase( ), entry.signatureEa - get_imagebase( ) )
+			<< "// " << BuildIDASignatureString( entry.signature ) << "\n"
+			<< "const uint8_t pattern" << i << "Bytes[] = { " << FormatByteList( entry.signature, false ) << " };\n"
+			<< "const uint8_t pattern" << i << "Mask[] = { " << FormatByteList( entry.signature, true ) << " };\n"
+			<< "const Step pattern" << i << "Steps[] = { ";
+		if( entry.steps.empty( ) ) {
+			source << "{ AddOffset, 0, 0 }";
+		}
+		for( size_t j = 0; j < entry.steps.size( ); j++ ) {
+			const auto& step = entry.steps[j];
+			source << ( j ? ", " : "" ) << std::format( "{{ {}, {}, {} }}", step.type == ResolveStepType::AddOffset ? "AddOffset" : "FollowRel32", step.offset, step.instructionLength );
+		}
+		source << " };\n\n";
+	}
+
+	source << "const Pattern patterns[] = {\n";
+	for( size_t i = 0; i < entries.size( ); i++ ) {
+		source << std::format( "\t{{ pattern{0}Bytes, pattern{0}Mask, {1}, {2}, pattern{0}Steps, {3} }},\n", i, entries[i].signature.size( ), anchors[i], std::max<size_t>( entries[i].steps.size( ), 1 ) );
+	}
+	source << "};\n\n";
+
+	// Bucket table: patterns anchored on byte b are bucketEntries[bucketStart[b]..bucketStart[b + 1]]
+	// Indices of the bucket table are as wide as the pattern count needs
+	const auto bucketType = entries.size( ) <= UINT16_MAX ? "uint16_t" : "uint32_t";
+	source << "const " << bucketType << " bucketStart[257] = {";
+	size_t bucketOffset = 0;
+	for( size_t b = 0; b <= 256; b++ ) {
+		source << ( b % 16 == 0 ? "\n\t" : " " ) << bucketOffset << ( b < 256 ? "," : "" );
+		if( b < 256 ) {
+			bucketOffset += buckets[b].size( );
+		}
+	}
+	source << "\n};\n\n"
+		"const " << bucketType << " bucketEntries[] = {";
+	size_t written = 0;
+	for( const auto& bucket : buckets ) {
+		for( const auto index : bucket ) {
+			source << ( written++ % 16 == 0 ? "\n\t" : " " ) << index << ",";
+		}
+	}
+	source << "\n};\n\n"
+		"bool Matches( const uint8_t* data, const Pattern& pattern ) {\n"
+		"\tfor( size_t i = 0; i < pattern.length; i++ ) {\n"
+		"\t\tif( ( data[i] & pattern.mask[i] ) != pattern.bytes[i] ) {\n"
+		"\t\t\treturn false;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn true;\n"
+		"}\n\n"
+		"uintptr_t Resolve( const uint8_t* match, const Pattern& pattern ) {\n"
+		"\tauto address = match;\n"
+		"\tfor( size_t i = 0; i < pattern.stepCount; i++ ) {\n"
+		"\t\tconst auto& step = pattern.steps[i];\n"
+		"\t\tif( step.type == FollowRel32 ) {\n"
+		"\t\t\tint32_t rel32;\n"
+		"\t\t\tmemcpy( &rel32, address + step.offset, sizeof( rel32 ) );\n"
+		"\t\t\taddress = address + step.instructionLength + rel32;\n"
+		"\t\t}\n"
+		"\t\telse {\n"
+		"\t\t\taddress = address + step.offset;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn reinterpret_cast<uintptr_t>( address );\n"
+		"}\n\n"
+		"}\n\n"
+		"size_t ResolveAll( const uint8_t* moduleBase, size_t moduleSize, uintptr_t( &results )[static_cast<size_t>( Target::Count )] ) {\n"
+		"\tconstexpr auto count = static_cast<size_t>( Target::Count );\n"
+		"\tbool found[count] = {};\n"
+		"\tsize_t remaining = count;\n"
+		"\tfor( auto& result : results ) {\n"
+		"\t\tresult = 0;\n"
+		"\t}\n\n"
+		"\t// Single pass, every position is only checked against the patterns anchored on its byte value\n"
+		"\tfor( size_t i = 0; i < moduleSize && remaining > 0; i++ ) {\n"
+		"\t\tconst auto value = moduleBase[i];\n"
+		"\t\tfor( auto e = bucketStart[value]; e < bucketStart[value + 1]; e++ ) {\n"
+		"\t\t\tconst auto index = bucketEntries[e];\n"
+		"\t\t\tconst auto& pattern = patterns[index];\n"
+		"\t\t\tif( found[index] || i < pattern.anchor || i - pattern.anchor + pattern.length > moduleSize ) {\n"
+		"\t\t\t\tcontinue;\n"
+		"\t\t\t}\n"
+		"\t\t\tconst auto match = moduleBase + i - pattern.anchor;\n"
+		"\t\t\tif( Matches( match, pattern ) ) {\n"
+		"\t\t\t\tresults[index] = Resolve( match, pattern );\n"
+		"\t\t\t\tfound[index] = true;\n"
+		"\t\t\t\tremaining--;\n"
+		"\t\t\t}\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn count - remaining;\n"
+		"}\n\n"
+		"}\n";
+
+	std::ofstream headerFile( headerPath, std::ios::trunc );
+	std::ofstream sourceFile( sourcePath, std::ios::trunc );
+	if( !headerFile || !sourceFile ) {
+		return std::unexpected( "Failed to open output files" );
+	}
+	headerFile << header.str( );
+	sourceFile << source.str( );
+	if( !headerFile || !sourceFile ) {
+		return std::unexpected( "Failed to write output files" );
+	}
+
+	msg( "Exported %llu resolvers to %s and %s\n", entries.size( ), headerPath.string( ).c_str( ), sourcePath.string( ).c_str( ) );
+	return {};
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "Main.h"
+
+// C++ resolver code generation for a collected set of signatures
+
+enum class ResolveStepType : uint8_t {
+	AddOffset = 0,	// address += offset
+	FollowRel32		// address = address + instructionLength + *(int32_t*)( address + fieldOffset )
+};
+
+typedef struct {
+	ResolveStepType type;
+	int64_t offset;				// AddOffset: delta, FollowRel32: offset of the rel32 field
+	uint8_t instructionLength;	// FollowRel32 only
+} ResolveStep;
+
+typedef struct {
+	std::string name;
+	Signature signature;
+	ea_t signatureEa;
+	ea_t targetEa;
+	std::vector<ResolveStep> steps;
+} ResolverEntry;
+
+// Signatures collected during this session
+std::vector<ResolverEntry>& GetResolverExportSet( );
+
+// Derive how to get from the signature match to the target and add it to the export set
+void AddToResolverExportSet( const Signature& signature, ea_t signatureEa, ea_t targetEa );
+
+// Write <path>.h and <path>.cpp with one scan routine resolving all entries
+std::expected<void, std::string> ExportResolverCode( const std::vector<ResolverEntry>& entries, const std::string& basePath );
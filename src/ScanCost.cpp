@@ -0,0 +1,64 @@
+#include "ScanCost.h"
+
+#include <algorithm>
+#include <format>
+
+ScanCostModel::ScanCostModel( const ByteSnapshot& snapshot ) : pairCounts( 0x10000 ), byteCounts( snapshot.histogram ), imageSize( snapshot.bytes.size( ) ) {
+	for( const auto& segment : snapshot.segments ) {
+		const auto data = snapshot.bytes.data( ) + segment.offset;
+		for( size_t i = 1; i < segment.size; i++ ) {
+			pairCounts[data[i - 1] << 8 | data[i]]++;
+		}
+	}
+}
+
+ScanCost ScanCostModel::Estimate( const Signature& signature ) const {
+	ScanCost result{ 0, imageSize, 0, 0.0 };
+
+	// Rarest concrete pair, a single rarest byte if the signature has no two concrete bytes in a row
+	auto bestPair = UINT64_MAX;
+	auto bestByte = UINT64_MAX;
+	size_t bestPairOffset = 0, bestByteOffset = 0;
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		const auto& b = signature[i];
+		if( b.isWildcard || IsJump( b ) ) {
+			continue;
+		}
+		result.verifyLength++;
+		if( byteCounts[b.value] < bestByte ) {
+			bestByte = byteCounts[b.value];
+			bestByteOffset = i;
+		}
+		if( i + 1 < signature.size( ) && !signature[i + 1].isWildcard && !IsJump( signature[i + 1] ) ) {
+			const auto count = pairCounts[b.value << 8 | signature[i + 1].value];
+			if( count < bestPair ) {
+				bestPair = count;
+				bestPairOffset = i;
+			}
+		}
+	}
+
+	if( bestPair != UINT64_MAX ) {
+		result.anchorOffset = bestPairOffset;
+		result.candidates = bestPair;
+	}
+	else if( bestByte != UINT64_MAX ) {
+		result.anchorOffset = bestByteOffset;
+		result.candidates = bestByte;
+	}
+	result.cost = static_cast<double>( result.candidates ) * static_cast<double>( std::max<size_t>( result.verifyLength, 1 ) );
+	return result;
+}
+
+std::string FormatScanCost( double cost ) {
+	if( cost >= 1e9 ) {
+		return std::format( "{:.1f}G", cost / 1e9 );
+	}
+	if( cost >= 1e6 ) {
+		return std::format( "{:.1f}M", cost / 1e6 );
+	}
+	if( cost >= 1e3 ) {
+		return std::format( "{:.1f}K", cost / 1e3 );
+	}
+	return std::format( "{:.0f}", cost );
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "ByteSnapshot.h"
+#include "SignatureTypes.h"
+
+// Cost of finding a signature with a runtime scanner that looks for its rarest byte pair and then compares the rest
+// This module does not depend on the IDA SDK
+
+typedef struct {
+	size_t anchorOffset;	// Position of the anchor in the signature
+	uint64_t candidates;	// Occurences of the anchor in the image
+	size_t verifyLength;	// Concrete bytes compared per candidate
+	double cost;			// candidates * verifyLength
+} ScanCost;
+
+class ScanCostModel {
+public:
+	explicit ScanCostModel( const ByteSnapshot& snapshot );
+
+	ScanCost Estimate( const Signature& signature ) const;
+
+private:
+	std::vector<uint64_t> pairCounts; // Indexed by first << 8 | second, pairs never cross segments
+	std::array<uint64_t, 256> byteCounts{};
+	uint64_t imageSize = 0;
+};
+
+// Short form like 950, 12K or 3.4M
+std::string FormatScanCost( double cost );
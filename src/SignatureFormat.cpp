@@ -0,0 +1,93 @@
+#include "SignatureFormat.h"
+
+#include <algorithm>
+#include <format>
+#include <sstream>
+
+std::string BuildIDASignatureString( const Signature& signature, bool doubleQM, bool includeCaptures ) {
+	std::ostringstream result;
+	// Build hex pattern
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		const auto& byte = signature[i];
+		// Mark capture groups with braces
+		if( includeCaptures && byte.captureGroup && ( i == 0 || signature[i - 1].captureGroup != byte.captureGroup ) ) {
+			result << "{";
+		}
+		if( IsJump( byte ) ) {
+			result << ( byte.jumpMin == byte.jumpMax ? std::format( "[{}]", byte.jumpMin ) : std::format( "[{}-{}]", byte.jumpMin, byte.jumpMax ) );
+		}
+		else if( byte.isWildcard ) {
+			result << ( doubleQM ? "??" : "?" );
+		}
+		else {
+			result << std::format( "{:02X}", byte.value );
+		}
+		if( includeCaptures && byte.captureGroup && ( i + 1 == signature.size( ) || signature[i + 1].captureGroup != byte.captureGroup ) ) {
+			result << "}";
+		}
+		result << " ";
+	}
+	auto str = result.str( );
+	// Remove whitespace at end
+	if( !str.empty( ) ) {
+		str.pop_back( );
+	}
+	return str;
+}
+
+std::string BuildByteArrayWithMaskSignatureString( const Signature& signature ) {
+	std::ostringstream pattern;
+	std::ostringstream mask;
+	// Build hex pattern
+	for( const auto& byte : signature ) {
+		pattern << "\\x" << std::format( "{:02X}", ( byte.isWildcard ? 0 : byte.value ) );
+		mask << ( byte.isWildcard ? "?" : "x" );
+	}
+	auto str = pattern.str( ) + " " + mask.str( );
+	return str;
+}
+
+std::string BuildBytesWithBitmaskSignatureString( const Signature& signature ) {
+	std::ostringstream pattern;
+	std::ostringstream mask;
+	// Build hex pattern
+	for( const auto& byte : signature ) {
+		pattern << "0x" << std::format( "{:02X}", ( byte.isWildcard ? 0 : byte.value ) ) << ", ";
+		mask << ( byte.isWildcard ? "0" : "1" );
+	}
+	auto patternStr = pattern.str( );
+	auto maskStr = mask.str( );
+
+	// Reverse bitmask
+	std::ranges::reverse( maskStr );
+
+	// Remove separators
+	if( !patternStr.empty( ) ) {
+		patternStr.pop_back( );
+		patternStr.pop_back( );
+	}
+
+	auto str = patternStr + " " + " 0b" + maskStr;
+	return str;
+}
+
+std::string FormatSignature( const Signature& signature, SignatureType type ) {
+	using enum SignatureType;
+
+	// Byte arrays with masks can not express jumps
+	if( std::ranges::any_of( signature, []( const auto& b ) { return IsJump( b ); } ) && type != x64Dbg ) {
+		type = IDA;
+	}
+
+	switch( type ) {
+	case IDA:
+		return BuildIDASignatureString( signature );
+	case x64Dbg:
+		return BuildIDASignatureString( signature, true );
+	case Signature_Mask:
+		return BuildByteArrayWithMaskSignatureString( signature );
+	case SignatureByteArray_Bitmask:
+		return BuildBytesWithBitmaskSignatureString( signature );
+	}
+	return {};
+}
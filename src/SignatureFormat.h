@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+#include "SignatureTypes.h"
+
+// Output functions, shared with the standalone tools
+// This module does not depend on the IDA SDK
+
+std::string BuildIDASignatureString( const Signature& signature, bool doubleQM = false, bool includeCaptures = true );
+std::string BuildByteArrayWithMaskSignatureString( const Signature& signature );
+std::string BuildBytesWithBitmaskSignatureString( const Signature& signature );
+std::string FormatSignature( const Signature& signature, SignatureType type );
@@ -0,0 +1,308 @@
+#pragma once
+
+// Header-only compile time signatures for code consuming the plugin output
+//
+//   constexpr auto sig = "E8 ? ? ? ? 45 33 F6"_sig;
+//   const uint8_t* hit = FindSignature<sig>( moduleBase, moduleSize );
+//
+// All four output formats are accepted, the format is detected the same way the "Search for a signature" action does it.
+// Parsing happens during compilation, malformed signatures are compile errors.
+// The matcher is instantiated per signature, so wildcard checks vanish and the byte comparisons can be unrolled.
+// This header only depends on SignatureTypes.h and the standard library, it does not need the IDA SDK.
+
+#include <array>
+#include <cstring>
+#include <stddef.h>
+#include <string_view>
+#include <utility>
+
+#include "SignatureTypes.h"
+
+// String literal wrapper usable as template argument
+template<size_t N>
+struct SignatureLiteralString {
+	char data[N]{};
+
+	consteval SignatureLiteralString( const char( &str )[N] ) {
+		for( size_t i = 0; i < N; i++ ) {
+			data[i] = str[i];
+		}
+	}
+
+	constexpr std::string_view View( ) const {
+		return std::string_view( data, N - 1 );
+	}
+};
+
+// Fixed size signature, mask[i] is true for concrete bytes
+template<size_t N>
+struct FixedSignature {
+	std::array<uint8_t, N> values{};
+	std::array<bool, N> mask{};
+	SignatureType type = SignatureType::IDA;
+
+	static constexpr size_t Size( ) {
+		return N;
+	}
+
+	// Convert to the dynamic representation used by the plugin
+	Signature ToSignature( ) const {
+		Signature signature;
+		signature.reserve( N );
+		for( size_t i = 0; i < N; i++ ) {
+			signature.push_back( SignatureByte{ values[i], !mask[i], 0, 0, 0 } );
+		}
+		return signature;
+	}
+};
+
+// Parser state shared by the counting and the filling pass
+struct SignatureLiteralParseResult {
+	size_t count = 0;
+	SignatureType type = SignatureType::IDA;
+};
+
+consteval bool IsSignatureHexDigit( char c ) {
+	return ( c >= '0' && c <= '9' ) || ( c >= 'A' && c <= 'F' ) || ( c >= 'a' && c <= 'f' );
+}
+
+consteval uint8_t SignatureHexDigitValue( char c ) {
+	if( c >= '0' && c <= '9' ) {
+		return static_cast<uint8_t>( c - '0' );
+	}
+	if( c >= 'A' && c <= 'F' ) {
+		return static_cast<uint8_t>( c - 'A' + 10 );
+	}
+	if( c >= 'a' && c <= 'f' ) {
+		return static_cast<uint8_t>( c - 'a' + 10 );
+	}
+	throw "Invalid hex digit in signature";
+}
+
+consteval bool IsSignatureSpace( char c ) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',';
+}
+
+consteval SignatureType DetectSignatureLiteralType( std::string_view str ) {
+	using enum SignatureType;
+	if( str.find( "\\x" ) != std::string_view::npos ) {
+		return Signature_Mask;
+	}
+	if( str.find( "0x" ) != std::string_view::npos || str.find( "0X" ) != std::string_view::npos ) {
+		return SignatureByteArray_Bitmask;
+	}
+	if( str.find( "??" ) != std::string_view::npos ) {
+		return x64Dbg;
+	}
+	return IDA;
+}
+
+// Walks the literal, counts bytes and writes them if output arrays are given
+consteval SignatureLiteralParseResult ParseSignatureLiteral( std::string_view str, uint8_t* values, bool* mask ) {
+	using enum SignatureType;
+
+	SignatureLiteralParseResult result{};
+	result.type = DetectSignatureLiteralType( str );
+
+	switch( result.type ) {
+	case IDA:
+	case x64Dbg:
+	{
+		size_t i = 0;
+		while( i < str.size( ) ) {
+			// Capture group braces do not change the pattern
+			if( IsSignatureSpace( str[i] ) || str[i] == '{' || str[i] == '}' ) {
+				i++;
+				continue;
+			}
+			if( str[i] == '?' ) {
+				// "?" or "??" are both one wildcard byte
+				i += ( i + 1 < str.size( ) && str[i + 1] == '?' ) ? 2 : 1;
+				if( values ) {
+					values[result.count] = 0;
+					mask[result.count] = false;
+				}
+				result.count++;
+				continue;
+			}
+			if( i + 1 < str.size( ) && IsSignatureHexDigit( str[i] ) && IsSignatureHexDigit( str[i + 1] ) ) {
+				if( values ) {
+					values[result.count] = static_cast<uint8_t>( SignatureHexDigitValue( str[i] ) << 4 | SignatureHexDigitValue( str[i + 1] ) );
+					mask[result.count] = true;
+				}
+				result.count++;
+				i += 2;
+				continue;
+			}
+			throw "Unexpected character in IDA style signature";
+		}
+		break;
+	}
+	case Signature_Mask:
+	{
+		// "\xE8\x00\x00 x??"
+		size_t i = 0;
+		while( i + 3 < str.size( ) && str[i] == '\\' && str[i + 1] == 'x' ) {
+			if( !IsSignatureHexDigit( str[i + 2] ) || !IsSignatureHexDigit( str[i + 3] ) ) {
+				throw "Invalid byte in byte array signature";
+			}
+			if( values ) {
+				values[result.count] = static_cast<uint8_t>( SignatureHexDigitValue( str[i + 2] ) << 4 | SignatureHexDigitValue( str[i + 3] ) );
+				mask[result.count] = true;
+			}
+			result.count++;
+			i += 4;
+		}
+		while( i < str.size( ) && IsSignatureSpace( str[i] ) ) {
+			i++;
+		}
+		// Without mask all bytes are concrete
+		if( i == str.size( ) ) {
+			break;
+		}
+		size_t maskIndex = 0;
+		for( ; i < str.size( ) && !IsSignatureSpace( str[i] ); i++, maskIndex++ ) {
+			if( str[i] != 'x' && str[i] != '?' ) {
+				throw "Invalid character in string mask";
+			}
+			if( maskIndex >= result.count ) {
+				throw "String mask is longer than the byte array";
+			}
+			if( mask ) {
+				mask[maskIndex] = str[i] == 'x';
+			}
+		}
+		if( maskIndex != result.count ) {
+			throw "String mask length does not match the byte array";
+		}
+		break;
+	}
+	case SignatureByteArray_Bitmask:
+	{
+		// "0xE8, 0x00, 0x00  0b110"
+		size_t i = 0;
+		while( i < str.size( ) ) {
+			if( IsSignatureSpace( str[i] ) ) {
+				i++;
+				continue;
+			}
+			if( str[i] == '0' && i + 1 < str.size( ) && ( str[i + 1] == 'b' || str[i + 1] == 'B' ) ) {
+				break;
+			}
+			if( i + 3 < str.size( ) && str[i] == '0' && ( str[i + 1] == 'x' || str[i + 1] == 'X' ) && IsSignatureHexDigit( str[i + 2] ) && IsSignatureHexDigit( str[i + 3] ) ) {
+				if( values ) {
+					values[result.count] = static_cast<uint8_t>( SignatureHexDigitValue( str[i + 2] ) << 4 | SignatureHexDigitValue( str[i + 3] ) );
+					mask[result.count] = true;
+				}
+				result.count++;
+				i += 4;
+				continue;
+			}
+			throw "Unexpected character in byte array signature";
+		}
+		if( i == str.size( ) ) {
+			break;
+		}
+		// The bitmask is reversed, the last digit belongs to the first byte
+		i += 2;
+		const auto bits = str.substr( i );
+		if( bits.size( ) != result.count ) {
+			throw "Bitmask length does not match the byte array";
+		}
+		for( size_t bit = 0; bit < bits.size( ); bit++ ) {
+			const auto c = bits[bits.size( ) - 1 - bit];
+			if( c != '0' && c != '1' ) {
+				throw "Invalid character in bitmask";
+			}
+			if( mask ) {
+				mask[bit] = c == '1';
+			}
+		}
+		break;
+	}
+	}
+
+	if( result.count == 0 ) {
+		throw "Empty signature";
+	}
+	return result;
+}
+
+template<SignatureLiteralString Str>
+consteval auto MakeFixedSignature( ) {
+	constexpr auto info = ParseSignatureLiteral( Str.View( ), nullptr, nullptr );
+	FixedSignature<info.count> signature{};
+	signature.type = info.type;
+	ParseSignatureLiteral( Str.View( ), signature.values.data( ), signature.mask.data( ) );
+	return signature;
+}
+
+template<SignatureLiteralString Str>
+consteval auto operator""_sig( ) {
+	return MakeFixedSignature<Str>( );
+}
+
+// Index of the first concrete byte, used as anchor for the scan
+template<auto Sig>
+consteval size_t FixedSignatureAnchor( ) {
+	for( size_t i = 0; i < Sig.Size( ); i++ ) {
+		if( Sig.mask[i] ) {
+			return i;
+		}
+	}
+	return Sig.Size( );
+}
+
+// Compares all concrete bytes, wildcards are dropped during instantiation
+template<auto Sig, size_t... I>
+constexpr bool MatchesFixedSignature( const uint8_t* data, std::index_sequence<I...> ) {
+	return ( ( !Sig.mask[I] || data[I] == Sig.values[I] ) && ... );
+}
+
+template<auto Sig>
+constexpr bool MatchesFixedSignature( const uint8_t* data ) {
+	return MatchesFixedSignature<Sig>( data, std::make_index_sequence<Sig.Size( )>{ } );
+}
+
+// Returns the first match in [data, data + size) or nullptr
+template<auto Sig>
+const uint8_t* FindSignature( const uint8_t* data, size_t size, size_t startOffset = 0 ) {
+	constexpr auto length = Sig.Size( );
+	constexpr auto anchor = FixedSignatureAnchor<Sig>( );
+	if( size < length ) {
+		return nullptr;
+	}
+	const auto last = size - length;
+
+	// All wildcards, everything matches
+	if constexpr( anchor == length ) {
+		return startOffset <= last ? data + startOffset : nullptr;
+	}
+	else {
+		constexpr auto anchorValue = Sig.values[anchor];
+		auto offset = startOffset;
+		while( offset <= last ) {
+			// memchr is vectorized by every libc, use it to skip to the next anchor byte
+			const auto found = static_cast<const uint8_t*>( std::memchr( data + offset + anchor, anchorValue, last - offset + 1 ) );
+			if( !found ) {
+				return nullptr;
+			}
+			const auto candidate = static_cast<size_t>( found - data ) - anchor;
+			if( MatchesFixedSignature<Sig>( data + candidate ) ) {
+				return data + candidate;
+			}
+			offset = candidate + 1;
+		}
+		return nullptr;
+	}
+}
+
+// Calls callback( const uint8_t* ) for every match
+template<auto Sig, typename Callback>
+void FindSignatureMatches( const uint8_t* data, size_t size, Callback&& callback ) {
+	size_t offset = 0;
+	while( const auto match = FindSignature<Sig>( data, size, offset ) ) {
+		callback( match );
+		offset = static_cast<size_t>( match - data ) + 1;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Signature types and structures
+enum class SignatureType : uint32_t {
+	IDA = 0,
+	x64Dbg,
+	Signature_Mask,
+	SignatureByteArray_Bitmask
+};
+
+typedef struct {
+	uint8_t value;
+	bool isWildcard;
+	// Variable length gap of jumpMin to jumpMax bytes instead of a single byte, if jumpMax is not 0
+	uint16_t jumpMin;
+	uint16_t jumpMax;
+	// 1-based capture group for values to extract from matches, 0 if the byte is not captured
+	uint8_t captureGroup;
+} SignatureByte;
+
+inline bool IsJump( const SignatureByte& byte ) {
+	return byte.jumpMax != 0;
+}
+
+using Signature = std::vector<SignatureByte>;
@@ -1,94 +1,180 @@
 #include "SignatureUtils.h"
+#include "Utils.h"
 
-std::string BuildIDASignatureString( const Signature& signature, bool doubleQM ) {
-	std::ostringstream result;
-	// Build hex pattern
-	for( const auto& byte : signature ) {
-		if( byte.isWildcard ) {
-			result << ( doubleQM ? "??" : "?" );
+void AddByteToSignature( Signature& signature, ea_t address, bool wildcard, uint8_t captureGroup ) {
+	SignatureByte byte{};
+	byte.isWildcard = wildcard;
+	byte.value = get_byte( address );
+	byte.captureGroup = captureGroup;
+	signature.push_back( byte );
+}
+
+void AddBytesToSignature( Signature& signature, ea_t address, size_t count, bool wildcard, uint8_t captureGroup ) {
+	// signature.reserve( signature.size() + count ); // Not sure if this is overhead for average signature creation
+	for( size_t i = 0; i < count; i++ ) {
+		AddByteToSignature( signature, address + i, wildcard, captureGroup );
+	}
+}
+
+
+// Trim wildcards at end, captured wildcards are kept because their value is wanted
+void TrimSignature( Signature& signature ) {
+	auto it = std::find_if( signature.rbegin( ), signature.rend( ), []( const auto& sb ) { return !sb.isWildcard || sb.captureGroup; } );
+	signature.erase( it.base( ), signature.end( ) );
+}
+
+std::vector<SignatureCapture> GetSignatureCaptures( const Signature& signature ) {
+	std::vector<SignatureCapture> captures;
+	for( size_t i = 0; i < signature.size( ); i++ ) {
+		if( IsJump( signature[i] ) ) {
+			break;
+		}
+		const auto group = signature[i].captureGroup;
+		if( !group ) {
+			continue;
+		}
+		if( i > 0 && signature[i - 1].captureGroup == group ) {
+			captures.back( ).length++;
 		}
 		else {
-			result << std::format( "{:02X}", byte.value );
+			captures.push_back( SignatureCapture{ group, i, 1 } );
 		}
-		result << " ";
-	}
-	auto str = result.str( );
-	// Remove whitespace at end
-	if( !str.empty( ) ) {
-		str.pop_back( );
 	}
-	return str;
+	return captures;
 }
 
-std::string BuildByteArrayWithMaskSignatureString( const Signature& signature ) {
-	std::ostringstream pattern;
-	std::ostringstream mask;
-	// Build hex pattern
-	for( const auto& byte : signature ) {
-		pattern << "\\x" << std::format( "{:02X}", ( byte.isWildcard ? 0 : byte.value ) );
-		mask << ( byte.isWildcard ? "?" : "x" );
+
+// Converts "\\xE8" or "0xE8" style byte strings
+static Signature ConvertRawByteStrings( const std::vector<std::string>& rawByteStrings, std::string_view stringMask = {} ) {
+	Signature convertedSignature;
+	for( size_t i = 0; const auto & m : rawByteStrings ) {
+		const auto isWildcard = !stringMask.empty( ) && stringMask[i++] == '?';
+		convertedSignature.push_back( SignatureByte{ static_cast<uint8_t>( std::stoi( m.substr( 2 ), nullptr, 16 ) ), isWildcard } );
 	}
-	auto str = pattern.str( ) + " " + mask.str( );
-	return str;
+	return convertedSignature;
 }
 
-std::string BuildBytesWithBitmaskSignatureString( const Signature& signature ) {
-	std::ostringstream pattern;
-	std::ostringstream mask;
-	// Build hex pattern
-	for( const auto& byte : signature ) {
-		pattern << "0x" << std::format( "{:02X}", ( byte.isWildcard ? 0 : byte.value ) ) << ", ";
-		mask << ( byte.isWildcard ? "0" : "1" );
-	}
-	auto patternStr = pattern.str( );
-	auto maskStr = mask.str( );
+std::expected<Signature, std::string> ParseSignatureString( std::string input ) {
+	// Try to figure out what signature type is used
+	Signature convertedSignature;
 
-	// Reverse bitmask
-	std::ranges::reverse( maskStr );
+	std::string stringMask;
 
-	// Remove separators
-	if( !patternStr.empty( ) ) {
-		patternStr.pop_back( );
-		patternStr.pop_back( );
+	// Try to detect a string mask like "xx????xx?xx"
+	// Assume string mask always starts with x, and we don't just have one byte
+	std::smatch match;
+	if( std::regex_search( input, match, std::regex( R"(x(?:x|\?)+)" ) ) ) {
+		stringMask = match[0].str( );
+	}
+	// Try to find binary style bitmask like "0b101110" and convert it to a string mask
+	else if( std::regex_search( input, match, std::regex( R"(0b(?:[0,1])+)" ) ) ) {
+		auto bits = match[0].str( ).substr( 2 );
+		std::string reversedBits( bits.rbegin( ), bits.rend( ) );
+		for( const auto& b : reversedBits ) {
+			stringMask += ( b == '1' ? 'x' : '?' );
+		}
 	}
 
-	auto str = patternStr + " " + " 0b" + maskStr;
-	return str;
-}
+	if( !stringMask.empty( ) ) {
+		// Since we have a mask, search for the bytes
 
-std::string FormatSignature( const Signature& signature, SignatureType type ) {
-	using enum SignatureType;
-	switch( type ) {
-	case IDA:
-		return BuildIDASignatureString( signature );
-	case x64Dbg:
-		return BuildIDASignatureString( signature, true );
-	case Signature_Mask:
-		return BuildByteArrayWithMaskSignatureString( signature );
-	case SignatureByteArray_Bitmask:
-		return BuildBytesWithBitmaskSignatureString( signature );
+		std::vector<std::string> rawByteStrings;
+		// Search for \x00\x11\x22 type arrays
+		if( GetRegexMatches( input, std::regex( R"(\\x(?:[0-9A-F]{2}))" ), rawByteStrings ) && rawByteStrings.size( ) == stringMask.length( ) ) {
+			convertedSignature = ConvertRawByteStrings( rawByteStrings, stringMask );
+		}
+		// Search for 0x00, 0x11, 0x22 type arrays
+		else if( GetRegexMatches( input, std::regex( R"((?:0x(?:[0-9A-F]{2}))+)" ), rawByteStrings ) && rawByteStrings.size( ) == stringMask.length( ) ) {
+			convertedSignature = ConvertRawByteStrings( rawByteStrings, stringMask );
+		}
+		else {
+			return std::unexpected( std::format( "Detected mask \"{}\" but failed to match corresponding bytes", stringMask ) );
+		}
 	}
-	return {};
-}
+	else {
+		// We did not find a specific mask, so try formats with included wildcards 
 
+		// Separate capture braces like {? ? ? ?} into own tokens
+		input = std::regex_replace( input, std::regex( R"(([\{\}]))" ), " $1 " );
 
-void AddByteToSignature( Signature& signature, ea_t address, bool wildcard ) {
-	SignatureByte byte{};
-	byte.isWildcard = wildcard;
-	byte.value = get_byte( address );
-	signature.push_back( byte );
-}
+		// Keep jumps like [2-6] or [4] as J2-6 and J4- tokens
+		input = std::regex_replace( input, std::regex( R"(\[\s*(\d+)\s*(?:-\s*(\d+)\s*)?\])" ), " J$1-$2 " );
 
-void AddBytesToSignature( Signature& signature, ea_t address, size_t count, bool wildcard ) {
-	// signature.reserve( signature.size() + count ); // Not sure if this is overhead for average signature creation
-	for( size_t i = 0; i < count; i++ ) {
-		AddByteToSignature( signature, address + i, wildcard );
-	}
-}
+		// Remove braces in case you have makers in your IDA style signature 
+		input = std::regex_replace( input, std::regex( R"([\)\(\[\]]+)" ), "" );
 
+		// Remove whitespace at beginning, questionmarks and spaces at the end, and add one space for the following step
+		input = std::regex_replace( input, std::regex( "^\\s+" ), "" );
+		input = std::regex_replace( input, std::regex( "[? ]+$" ), "" ) + " ";
 
-// Trim wildcards at end
-void TrimSignature( Signature& signature ) {
-	auto it = std::find_if( signature.rbegin( ), signature.rend( ), []( const auto& sb ) { return !sb.isWildcard; } );
-	signature.erase( it.base( ), signature.end( ) );
+		// Replace double question marks with single ones to convert x64Dbg style to IDA style
+		// We need spaces between signature bytes, because we can not recognize if a signature uses one or two question marks per wildcard
+		input = std::regex_replace( input, std::regex( R"(\?\? )" ), "? " );
+
+		// Direct match for IDA type signature
+		if( std::regex_match( input, std::regex( R"((?:(?:[A-F0-9]{2}\s+)|(?:\?\s+)|(?:J\d+-\d*\s+)|(?:[\{\}]\s+))+)" ) ) ) {
+			// Just use it
+			std::vector<std::string> tokens;
+			GetRegexMatches( input, std::regex( R"([A-F0-9]{2}|\?|J\d+-\d*|\{|\})" ), tokens );
+			uint8_t captureGroup = 0;
+			uint8_t captureCount = 0;
+			for( const auto& token : tokens ) {
+				if( token == "{" ) {
+					if( captureGroup || captureCount == UINT8_MAX ) {
+						return std::unexpected( "Invalid capture group" );
+					}
+					captureGroup = ++captureCount;
+				}
+				else if( token == "}" ) {
+					if( !captureGroup ) {
+						return std::unexpected( "Unbalanced capture group" );
+					}
+					captureGroup = 0;
+				}
+				else if( token[0] == 'J' ) {
+					const auto separator = token.find( '-' );
+					const auto jumpMin = std::stoul( token.substr( 1, separator - 1 ) );
+					const auto jumpMax = separator + 1 < token.size( ) ? std::stoul( token.substr( separator + 1 ) ) : jumpMin;
+					if( jumpMax == 0 || jumpMin > jumpMax || jumpMax > UINT16_MAX ) {
+						return std::unexpected( std::format( "Invalid jump [{}]", token.substr( 1 ) ) );
+					}
+					// A jump at the start does not constrain the match
+					if( !convertedSignature.empty( ) ) {
+						convertedSignature.push_back( SignatureByte{ 0, true, static_cast<uint16_t>( jumpMin ), static_cast<uint16_t>( jumpMax ) } );
+					}
+				}
+				else if( token == "?" ) {
+					convertedSignature.push_back( SignatureByte{ 0, true, 0, 0, captureGroup } );
+				}
+				else {
+					convertedSignature.push_back( SignatureByte{ static_cast<uint8_t>( std::stoi( token, nullptr, 16 ) ), false, 0, 0, captureGroup } );
+				}
+			}
+			if( captureGroup ) {
+				return std::unexpected( "Unbalanced capture group" );
+			}
+		}
+		else {
+			// Just try the other formats without wildcards
+
+			std::vector<std::string> rawByteStrings;
+			// Search for \x00\x11\x22 type arrays
+
+			if( GetRegexMatches( input, std::regex( R"(\\x(?:[0-9A-F]{2}))" ), rawByteStrings ) && rawByteStrings.size( ) > 1 ) {
+				convertedSignature = ConvertRawByteStrings( rawByteStrings );
+			}
+			// Search for 0x00, 0x11, 0x22 type arrays
+			else if( GetRegexMatches( input, std::regex( R"((?:0x(?:[0-9A-F]{2}))+)" ), rawByteStrings ) && rawByteStrings.size( ) > 1 ) {
+				convertedSignature = ConvertRawByteStrings( rawByteStrings );
+			}
+			else {
+				return std::unexpected( "Failed to match signature format" );
+			}
+		}
+	}
+
+	if( convertedSignature.empty( ) ) {
+		return std::unexpected( "Unrecognized signature type" );
+	}
+	return convertedSignature;
 }
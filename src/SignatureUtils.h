@@ -1,13 +1,21 @@
 #pragma once
 #include "Main.h"
+#include "SignatureFormat.h"
 
-// Output functions
-std::string BuildIDASignatureString( const Signature& signature, bool doubleQM = false );
-std::string BuildByteArrayWithMaskSignatureString( const Signature& signature );
-std::string BuildBytesWithBitmaskSignatureString( const Signature& signature );
-std::string FormatSignature( const Signature& signature, SignatureType type );
+// Input functions
+std::expected<Signature, std::string> ParseSignatureString( std::string input );
 
 // Utility functions
-void AddByteToSignature( Signature& signature, ea_t address, bool wildcard );
-void AddBytesToSignature( Signature& signature, ea_t address, size_t count, bool wildcard );
-void TrimSignature( Signature& signature );
\ No newline at end of file
+void AddByteToSignature( Signature& signature, ea_t address, bool wildcard, uint8_t captureGroup = 0 );
+void AddBytesToSignature( Signature& signature, ea_t address, size_t count, bool wildcard, uint8_t captureGroup = 0 );
+void TrimSignature( Signature& signature );
+
+// Capture groups
+typedef struct {
+	uint8_t group;
+	size_t offset;	// Position of the first captured byte in a match
+	size_t length;
+} SignatureCapture;
+
+// Captures behind a jump have no fixed offset and are not returned
+std::vector<SignatureCapture> GetSignatureCaptures( const Signature& signature );
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "ThreadPool.h"
+
+#include <optional>
+#include <utility>
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+// Pool and index of the current worker thread
+static thread_local ThreadPool* CurrentPool = nullptr;
+static thread_local size_t CurrentWorker = 0;
+
+// Idle threads spin with growing pauses first since forked tasks usually follow quickly, then yield, then sleep
+static constexpr size_t PauseRounds = 8;
+static constexpr size_t YieldRounds = 64;
+static constexpr auto CancellationCheckInterval = std::chrono::milliseconds( 20 );
+
+static void Backoff( size_t idleRounds ) {
+	if( idleRounds < PauseRounds ) {
+		for( size_t i = 0; i < ( size_t( 1 ) << idleRounds ); i++ ) {
+#if defined( _M_X64 ) || defined( __x86_64__ )
+			_mm_pause( );
+#endif
+		}
+	}
+	else {
+		std::this_thread::yield( );
+	}
+}
+
+TaskGroup::~TaskGroup( ) {
+	Cancel( );
+	Join( );
+}
+
+void TaskGroup::Run( std::function<void( )> task ) {
+	pending++;
+	pool.Push( { std::move( task ), this } );
+}
+
+void TaskGroup::Join( ) {
+	const auto isOutsideOfPool = !ThreadPool::IsWorkerThread( );
+	size_t idleRounds = 0;
+	while( pending.load( std::memory_order_acquire ) > 0 ) {
+		if( isOutsideOfPool && pool.IsCancelled( ) ) {
+			Cancel( );
+		}
+		if( pool.RunPendingTask( ) ) {
+			idleRounds = 0;
+			continue;
+		}
+		// The remaining tasks run on other threads, waiting here has to keep polling for cancellation
+		if( ++idleRounds < YieldRounds ) {
+			Backoff( idleRounds );
+		}
+		else {
+			std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+		}
+	}
+}
+
+bool TaskGroup::Wait( ) {
+	Join( );
+	if( exception ) {
+		std::rethrow_exception( std::exchange( exception, nullptr ) );
+	}
+	return !stopSource.stop_requested( );
+}
+
+bool TaskGroup::Help( ) {
+	return pool.RunPendingTask( );
+}
+
+void TaskGroup::Finish( std::exception_ptr taskException ) {
+	if( taskException ) {
+		std::scoped_lock lock( exceptionMutex );
+		if( !exception ) {
+			exception = taskException;
+		}
+		Cancel( );
+	}
+	// The waiting thread may destroy the group right after this
+	pending.fetch_sub( 1, std::memory_order_release );
+}
+
+ThreadPool::ThreadPool( size_t threadCount ) {
+	if( threadCount == 0 ) {
+		threadCount = std::max( std::thread::hardware_concurrency( ), 1u );
+	}
+	for( size_t i = 0; i + 1 < threadCount; i++ ) {
+		workers.push_back( std::make_unique<TaskQueue>( ) );
+	}
+	for( size_t i = 0; i < workers.size( ); i++ ) {
+		threads.emplace_back( [this, i]( std::stop_token stopToken ) {
+			WorkerLoop( stopToken, i );
+		} );
+	}
+}
+
+ThreadPool::~ThreadPool( ) {
+	// Stops the workers before the queues they use are destroyed
+	threads.clear( );
+}
+
+bool ThreadPool::IsWorkerThread( ) {
+	return CurrentPool != nullptr;
+}
+
+void ThreadPool::Push( Task task ) {
+	auto& queue = CurrentPool == this ? *workers[CurrentWorker] : injected;
+	{
+		std::scoped_lock lock( queue.mutex );
+		queue.tasks.push_back( std::move( task ) );
+	}
+	queuedTasks++;
+
+	// Taking the lock makes sure a worker that just found nothing to do is either asleep or sees the task
+	{
+		std::scoped_lock lock( sleepMutex );
+	}
+	wakeUp.notify_one( );
+}
+
+bool ThreadPool::RunPendingTask( ) {
+	// Not built in a conditional expression, GCC reports the empty payload as maybe-uninitialized at -O2 then
+	std::optional<size_t> self = std::nullopt;
+	if( CurrentPool == this ) {
+		self = CurrentWorker;
+	}
+	const auto pop = [&]( TaskQueue& queue, bool fromBack ) -> std::optional<Task> {
+		std::scoped_lock lock( queue.mutex );
+		if( queue.tasks.empty( ) ) {
+			return std::nullopt;
+		}
+		auto task = std::move( fromBack ? queue.tasks.back( ) : queue.tasks.front( ) );
+		fromBack ? queue.tasks.pop_back( ) : queue.tasks.pop_front( );
+		queuedTasks--;
+		return task;
+	};
+
+	// Own tasks newest first as they are the most likely to be in the cache, other queues oldest first as those are the biggest
+	auto task = self ? pop( *workers[*self], true ) : std::nullopt;
+	if( !task ) {
+		task = pop( injected, false );
+	}
+	const auto first = self ? *self + 1 : 0;
+	for( size_t i = 0; !task && i < workers.size( ); i++ ) {
+		const auto victim = ( first + i ) % workers.size( );
+		if( victim != self ) {
+			task = pop( *workers[victim], false );
+		}
+	}
+	if( !task ) {
+		return false;
+	}
+
+	const auto start = std::chrono::steady_clock::now( );
+	std::exception_ptr exception;
+	try {
+		task->function( );
+	}
+	catch( ... ) {
+		exception = std::current_exception( );
+	}
+	if( isTracing ) {
+		auto& queue = self ? *workers[*self] : injected;
+		std::scoped_lock lock( queue.mutex );
+		queue.trace.push_back( TaskTrace{ task->group->Name( ), self ? static_cast<int>( *self ) : -1, start, std::chrono::steady_clock::now( ) - start } );
+	}
+	task->group->Finish( exception );
+	return true;
+}
+
+bool ThreadPool::IsCancelled( ) {
+	// The check may be expensive, e.g. it processes UI events
+	if( !cancellationCheck ) {
+		return false;
+	}
+	const auto now = std::chrono::steady_clock::now( );
+	if( now - lastCancellationCheck < CancellationCheckInterval ) {
+		return false;
+	}
+	lastCancellationCheck = now;
+	return cancellationCheck( );
+}
+
+void ThreadPool::WorkerLoop( std::stop_token stopToken, size_t index ) {
+	CurrentPool = this;
+	CurrentWorker = index;
+
+	size_t idleRounds = 0;
+	while( !stopToken.stop_requested( ) ) {
+		if( RunPendingTask( ) ) {
+			idleRounds = 0;
+			continue;
+		}
+		if( ++idleRounds < YieldRounds ) {
+			Backoff( idleRounds );
+			continue;
+		}
+		std::unique_lock lock( sleepMutex );
+		wakeUp.wait( lock, stopToken, [&]( ) { return queuedTasks.load( ) > 0; } );
+		idleRounds = 0;
+	}
+}
+
+std::vector<TaskTrace> ThreadPool::TakeTrace( ) {
+	std::vector<TaskTrace> trace;
+	const auto take = [&]( TaskQueue& queue ) {
+		std::scoped_lock lock( queue.mutex );
+		trace.insert( trace.end( ), queue.trace.begin( ), queue.trace.end( ) );
+		queue.trace.clear( );
+	};
+	take( injected );
+	for( const auto& worker : workers ) {
+		take( *worker );
+	}
+	std::ranges::sort( trace, {}, &TaskTrace::start );
+	return trace;
+}
+
+static std::unique_ptr<ThreadPool> SharedPool;
+static size_t SharedPoolSize = 0;
+static std::function<bool( )> SharedCancellationCheck;
+
+ThreadPool& GetThreadPool( ) {
+	if( !SharedPool ) {
+		SharedPool = std::make_unique<ThreadPool>( SharedPoolSize );
+		SharedPool->SetCancellationCheck( SharedCancellationCheck );
+	}
+	return *SharedPool;
+}
+
+void SetThreadPoolSize( size_t threadCount ) {
+	if( SharedPool && threadCount != SharedPoolSize ) {
+		SharedPool.reset( );
+	}
+	SharedPoolSize = threadCount;
+}
+
+void SetThreadPoolCancellationCheck( std::function<bool( )> check ) {
+	SharedCancellationCheck = std::move( check );
+	if( SharedPool ) {
+		SharedPool->SetCancellationCheck( SharedCancellationCheck );
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// Work stealing thread pool shared by all parallel features of the plugin, so running several of them never exceeds the configured thread count
+// Each worker takes tasks from the back of its own deque and steals from the front of the others when it runs dry
+// Threads waiting for a task group execute pending tasks meanwhile, so tasks can fork and join further tasks without deadlocking
+// This module does not depend on the IDA SDK
+
+class ThreadPool;
+
+typedef struct {
+	const char* name;		// Name of the task group
+	int worker;				// -1 for threads outside of the pool that helped while waiting
+	std::chrono::steady_clock::time_point start;
+	std::chrono::nanoseconds duration;
+} TaskTrace;
+
+// Fork/join scope, Run forks a task and Wait joins all of them
+class TaskGroup {
+public:
+	explicit TaskGroup( ThreadPool& pool, const char* name = "task" ) : pool( pool ), name( name ) {
+	}
+	// Cancels and joins the remaining tasks
+	~TaskGroup( );
+
+	TaskGroup( const TaskGroup& ) = delete;
+	TaskGroup& operator=( const TaskGroup& ) = delete;
+
+	void Run( std::function<void( )> task );
+
+	// Helps executing tasks until all tasks of the group are done, then rethrows the first exception thrown by one of them
+	// Returns false if the group was cancelled, tasks that did not start before that may have returned early
+	bool Wait( );
+	// Runs one pending task of the pool on the calling thread, for threads that wait until some of the tasks are done
+	// Returns false if there was none
+	bool Help( );
+
+	void Cancel( ) {
+		stopSource.request_stop( );
+	}
+	// Long running tasks should poll this
+	std::stop_token StopToken( ) const {
+		return stopSource.get_token( );
+	}
+	const char* Name( ) const {
+		return name;
+	}
+
+private:
+	friend class ThreadPool;
+
+	void Join( );
+	void Finish( std::exception_ptr exception );
+
+	ThreadPool& pool;
+	const char* name;
+	std::stop_source stopSource;
+	std::atomic<size_t> pending = 0;
+	std::mutex exceptionMutex;
+	std::exception_ptr exception;
+};
+
+class ThreadPool {
+public:
+	// The thread count includes the thread that waits for the tasks, 0 uses all hardware threads
+	explicit ThreadPool( size_t threadCount = 0 );
+	~ThreadPool( );
+
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+
+	size_t ThreadCount( ) const {
+		return workers.size( ) + 1;
+	}
+
+	// Splits [begin, end) into chunks of at least grain indices and runs work( chunkBegin, chunkEnd ) for each of them
+	// Chunks that did not start before a cancellation are skipped, returns false in that case
+	template<typename Work>
+	bool ParallelFor( size_t begin, size_t end, size_t grain, Work&& work, const char* name = "parallel for" ) {
+		if( begin >= end ) {
+			return true;
+		}
+		// A few chunks per thread so stealing can even out uneven chunks
+		const auto chunkSize = std::max<size_t>( { grain, 1, ( end - begin ) / ( ThreadCount( ) * 4 ) } );
+		if( workers.empty( ) || end - begin <= chunkSize ) {
+			work( begin, end );
+			return true;
+		}
+
+		TaskGroup group( *this, name );
+		for( auto chunkBegin = begin; chunkBegin < end; ) {
+			const auto chunkEnd = end - chunkBegin > chunkSize ? chunkBegin + chunkSize : end;
+			group.Run( [&work, &group, chunkBegin, chunkEnd]( ) {
+				if( !group.StopToken( ).stop_requested( ) ) {
+					work( chunkBegin, chunkEnd );
+				}
+			} );
+			chunkBegin = chunkEnd;
+		}
+		return group.Wait( );
+	}
+
+	// Polled by threads outside of the pool while they wait, returning true cancels the group they wait for
+	// Has to be set before any task is running
+	void SetCancellationCheck( std::function<bool( )> check ) {
+		cancellationCheck = std::move( check );
+	}
+
+	// Records the duration of every task until TakeTrace is called
+	void EnableTrace( bool enable ) {
+		isTracing = enable;
+	}
+	std::vector<TaskTrace> TakeTrace( );
+
+	// True on the worker threads of any pool
+	static bool IsWorkerThread( );
+
+private:
+	friend class TaskGroup;
+
+	typedef struct {
+		std::function<void( )> function;
+		TaskGroup* group;
+	} Task;
+
+	typedef struct {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::vector<TaskTrace> trace;
+	} TaskQueue;
+
+	void Push( Task task );
+	// Runs one task of the own deque, the queue of outside threads or another worker, returns false if there was none
+	bool RunPendingTask( );
+	bool IsCancelled( );
+	void WorkerLoop( std::stop_token stopToken, size_t index );
+
+	std::vector<std::unique_ptr<TaskQueue>> workers;
+	TaskQueue injected;		// Tasks forked by threads outside of the pool
+	std::atomic<size_t> queuedTasks = 0;
+	std::mutex sleepMutex;
+	std::condition_variable_any wakeUp;
+	std::atomic<bool> isTracing = false;
+	std::function<bool( )> cancellationCheck;
+	std::chrono::steady_clock::time_point lastCancellationCheck;
+	std::vector<std::jthread> threads;
+};
+
+// Pool shared by the whole plugin, created on first use
+ThreadPool& GetThreadPool( );
+
+// Recreates the shared pool if the thread count changed, no tasks may be running
+void SetThreadPoolSize( size_t threadCount );
+
+// Installed on the shared pool and on every pool it is recreated as, no tasks may be running
+void SetThreadPoolCancellationCheck( std::function<bool( )> check );
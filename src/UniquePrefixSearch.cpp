@@ -0,0 +1,45 @@
+#include "UniquePrefixSearch.h"
+#include "ThreadPool.h"
+
+static PrefixSearchResult FindShortestUniquePrefix( const PrefixSearchTarget& target, const MatchCounter& countMatches, size_t maxReportedOccurences ) {
+	const auto& lengths = target.prefixLengths;
+	if( lengths.empty( ) ) {
+		return PrefixSearchResult{ true, 0, 0 };
+	}
+
+	Signature prefix;
+	const auto countPrefix = [&]( size_t length, size_t limit ) {
+		prefix.assign( target.signature.begin( ), target.signature.begin( ) + length );
+		return countMatches( prefix, limit );
+	};
+
+	// The whole signature decides whether any prefix can be unique
+	const auto occurences = countPrefix( lengths.back( ), maxReportedOccurences );
+	if( occurences != 1 ) {
+		return PrefixSearchResult{ true, 0, occurences };
+	}
+
+	// First boundary whose prefix is unique, the last one is
+	size_t low = 0;
+	size_t high = lengths.size( ) - 1;
+	while( low < high ) {
+		const auto middle = low + ( high - low ) / 2;
+		if( countPrefix( lengths[middle], 2 ) == 1 ) {
+			high = middle;
+		}
+		else {
+			low = middle + 1;
+		}
+	}
+	return PrefixSearchResult{ true, lengths[low], 1 };
+}
+
+std::vector<PrefixSearchResult> FindShortestUniquePrefixes( const std::vector<PrefixSearchTarget>& targets, const MatchCounter& countMatches, size_t maxReportedOccurences ) {
+	std::vector<PrefixSearchResult> results( targets.size( ), PrefixSearchResult{ false, 0, 0 } );
+	GetThreadPool( ).ParallelFor( 0, targets.size( ), 1, [&]( size_t first, size_t last ) {
+		for( auto i = first; i < last; i++ ) {
+			results[i] = FindShortestUniquePrefix( targets[i], countMatches, maxReportedOccurences );
+		}
+	}, "unique prefixes" );
+	return results;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "SignatureTypes.h"
+
+// Shortest unique prefixes of many signatures at once, the signatures are checked in parallel on the shared pool
+// Adding bytes never adds matches, so each signature is binary searched over its instruction boundaries
+// This module does not depend on the IDA SDK
+
+typedef struct {
+	Signature signature;				// Longest signature that may be used
+	std::vector<size_t> prefixLengths;	// Instruction boundaries, ascending, the last one is the signature size
+} PrefixSearchTarget;
+
+typedef struct {
+	bool isChecked;		// False if the search was cancelled first
+	size_t length;		// Shortest unique prefix, 0 if even the whole signature is not unique
+	size_t occurences;	// Matches of the whole signature if it is not unique, capped
+} PrefixSearchResult;
+
+// Counts matches up to limit, called from several threads at once
+using MatchCounter = std::function<size_t( const Signature& signature, size_t limit )>;
+
+std::vector<PrefixSearchResult> FindShortestUniquePrefixes( const std::vector<PrefixSearchTarget>& targets, const MatchCounter& countMatches, size_t maxReportedOccurences );
@@ -9,6 +9,7 @@
 #endif
 
 #include <stdint.h>
+#include <chrono>
 #include <regex>
 #include <string>
 #include <vector>
@@ -19,3 +20,16 @@ bool GetRegexMatches( std::string string, std::regex regex, std::vector<std::str
 constexpr auto BIT( uint32_t x ) {
     return 1LLU << x;
 }
+
+// Point in time after which long running searches return what they have so far
+using Deadline = std::chrono::steady_clock::time_point;
+constexpr auto NoDeadline = Deadline::max( );
+
+// A time limit of zero means no deadline
+inline Deadline DeadlineAfter( std::chrono::milliseconds timeLimit ) {
+	return timeLimit > std::chrono::milliseconds::zero( ) ? std::chrono::steady_clock::now( ) + timeLimit : NoDeadline;
+}
+
+inline bool IsDeadlineExpired( Deadline deadline ) {
+	return deadline != NoDeadline && std::chrono::steady_clock::now( ) >= deadline;
+}
@@ -0,0 +1,291 @@
+// Compares every search engine against a naive scan on random images with masked and jump patterns
+// Built with a small FM-index block size, so the images span several blocks and their overlaps
+// Usage: EngineTest [seed] [patterns]
+
+#include "ByteSnapshot.h"
+#include "BytePositionIndex.h"
+#include "Corpus.h"
+#include "FMIndex.h"
+#include "FuzzySearch.h"
+#include "GapSearch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+static size_t Failures = 0;
+
+static void Fail( const char* engine, size_t pattern, const std::string& what ) {
+	if( ++Failures <= 20 ) {
+		std::printf( "%s, pattern %zu: %s\n", engine, pattern, what.c_str( ) );
+	}
+}
+
+// Segments of 1 byte up to several FM-index blocks, mostly a few byte values so patterns repeat
+static ByteSnapshot BuildRandomImage( std::mt19937_64& random ) {
+	constexpr uint8_t commonBytes[] = { 0x00, 0xFF, 0x48, 0x8B };
+	const size_t sizes[] = { 1 + random( ) % 3, 2 * FMIndex::BlockSize + random( ) % FMIndex::BlockSize, 10 + random( ) % 5000, 2 + random( ) % 8, FMIndex::BlockSize + random( ) % 1000 };
+
+	ByteSnapshot snapshot;
+	uint64_t ea = 0x140001000;
+	for( const auto size : sizes ) {
+		snapshot.segments.push_back( SnapshotSegment{ ea, snapshot.bytes.size( ), size } );
+		for( size_t i = 0; i < size; i++ ) {
+			snapshot.bytes.push_back( random( ) % 100 < 70 ? commonBytes[random( ) % 4] : static_cast<uint8_t>( random( ) ) );
+		}
+		ea += size + ( random( ) % 2 ) * 0x1000;
+	}
+	snapshot.ComputeHistogram( );
+	return snapshot;
+}
+
+// Starts anywhere, at the end of a segment or around a block border, so some patterns cross them
+static size_t RandomStart( const ByteSnapshot& snapshot, std::mt19937_64& random, size_t length ) {
+	const auto& segment = snapshot.segments[random( ) % snapshot.segments.size( )];
+	size_t start = segment.offset;
+	switch( random( ) % 3 ) {
+	case 0:
+		start += random( ) % segment.size;
+		break;
+	case 1:
+		start += segment.size - std::min( segment.size, random( ) % ( length + 1 ) );
+		break;
+	default:
+		start += ( 1 + random( ) % 2 ) * ( FMIndex::BlockSize - FMIndex::BlockOverlap ) - random( ) % ( FMIndex::BlockOverlap + 64 );
+		break;
+	}
+	return std::min( start, snapshot.bytes.size( ) - 1 );
+}
+
+// Bytes copied from the image with some masked and sometimes one changed, jump patterns skip a few bytes inside
+static Signature RandomPattern( const ByteSnapshot& snapshot, std::mt19937_64& random, bool withJumps ) {
+	const auto length = 1 + random( ) % ( random( ) % 8 == 0 ? 200 : 24 );
+	const auto start = RandomStart( snapshot, random, length );
+	const auto cut = withJumps && length >= 2 ? 1 + random( ) % ( length - 1 ) : SIZE_MAX;
+	const auto gap = random( ) % 7;
+
+	Signature signature;
+	auto position = start;
+	for( size_t i = 0; i < length && position < snapshot.bytes.size( ); i++, position++ ) {
+		if( i == cut ) {
+			const auto below = random( ) % ( gap + 1 );
+			signature.push_back( SignatureByte{ 0, false, static_cast<uint16_t>( gap - below ), static_cast<uint16_t>( gap + 1 + random( ) % 3 ), 0 } );
+			position += gap;
+			if( position >= snapshot.bytes.size( ) ) {
+				break;
+			}
+		}
+		signature.push_back( SignatureByte{ snapshot.bytes[position], random( ) % 4 == 0, 0, 0, 0 } );
+	}
+	// Leading and trailing jumps do not constrain a match
+	while( !signature.empty( ) && IsJump( signature.back( ) ) ) {
+		signature.pop_back( );
+	}
+	if( random( ) % 4 == 0 && !signature.empty( ) ) {
+		auto& changed = signature[random( ) % signature.size( )];
+		if( !IsJump( changed ) ) {
+			changed.value ^= 1 << ( random( ) % 8 );
+			changed.isWildcard = false;
+		}
+	}
+	return signature;
+}
+
+static bool MatchesAt( const std::vector<uint8_t>& bytes, const Signature& signature, size_t index, size_t position, size_t end ) {
+	for( ; index < signature.size( ); index++, position++ ) {
+		const auto& b = signature[index];
+		if( IsJump( b ) ) {
+			for( size_t gap = b.jumpMin; gap <= b.jumpMax; gap++ ) {
+				if( MatchesAt( bytes, signature, index + 1, position + gap, end ) ) {
+					return true;
+				}
+			}
+			return false;
+		}
+		if( position >= end || ( !b.isWildcard && bytes[position] != b.value ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Matches never cross the end of a segment
+static std::vector<size_t> NaiveMatches( const ByteSnapshot& snapshot, const Signature& signature ) {
+	std::vector<size_t> matches;
+	for( const auto& segment : snapshot.segments ) {
+		for( size_t position = segment.offset; position < segment.offset + segment.size; position++ ) {
+			if( MatchesAt( snapshot.bytes, signature, 0, position, segment.offset + segment.size ) ) {
+				matches.push_back( position );
+			}
+		}
+	}
+	return matches;
+}
+
+// Sorted by distance, then position
+static std::vector<FuzzyMatch> NaiveFuzzyMatches( const ByteSnapshot& snapshot, const Signature& signature, size_t maxMismatches ) {
+	std::vector<std::vector<FuzzyMatch>> byDistance( maxMismatches + 1 );
+	for( const auto& segment : snapshot.segments ) {
+		for( size_t position = segment.offset; position + signature.size( ) <= segment.offset + segment.size; position++ ) {
+			size_t mismatches = 0;
+			for( size_t i = 0; i < signature.size( ) && mismatches <= maxMismatches; i++ ) {
+				mismatches += !signature[i].isWildcard && snapshot.bytes[position + i] != signature[i].value;
+			}
+			if( mismatches <= maxMismatches ) {
+				byDistance[mismatches].push_back( FuzzyMatch{ position, mismatches } );
+			}
+		}
+	}
+	std::vector<FuzzyMatch> matches;
+	for( const auto& bucket : byDistance ) {
+		matches.insert( matches.end( ), bucket.begin( ), bucket.end( ) );
+	}
+	return matches;
+}
+
+constexpr size_t FMCandidates = 1024;
+
+// Matches of the rarest run of concrete bytes within segments, UINT64_MAX for signatures of only wildcards
+static uint64_t RarestRunCount( const ByteSnapshot& snapshot, const Signature& signature ) {
+	auto rarest = UINT64_MAX;
+	for( size_t i = 0; i < signature.size( ); ) {
+		if( signature[i].isWildcard ) {
+			i++;
+			continue;
+		}
+		auto end = i;
+		while( end < signature.size( ) && !signature[end].isWildcard ) {
+			end++;
+		}
+		std::vector<uint8_t> run;
+		for( ; i < end; i++ ) {
+			run.push_back( signature[i].value );
+		}
+		uint64_t count = 0;
+		for( const auto& segment : snapshot.segments ) {
+			const auto first = snapshot.bytes.begin( ) + segment.offset;
+			const auto last = first + segment.size;
+			for( auto it = std::search( first, last, run.begin( ), run.end( ) ); it != last; it = std::search( it + 1, last, run.begin( ), run.end( ) ) ) {
+				count++;
+			}
+		}
+		rarest = std::min( rarest, count );
+	}
+	return rarest;
+}
+
+template<typename Results>
+static std::string Describe( const Results& results, const std::vector<size_t>& expected ) {
+	return std::to_string( results.size( ) ) + " matches instead of " + std::to_string( expected.size( ) );
+}
+
+static std::vector<size_t> FirstMatches( const std::vector<size_t>& matches, size_t maxMatches ) {
+	return std::vector<size_t>( matches.begin( ), matches.begin( ) + std::min( matches.size( ), maxMatches ) );
+}
+
+// Each segment becomes one file of the corpus, so matches do not cross them there either
+static std::vector<std::string> WriteCorpusFiles( const ByteSnapshot& snapshot, const std::filesystem::path& directory ) {
+	std::filesystem::create_directories( directory );
+	std::vector<std::string> paths;
+	for( size_t i = 0; i < snapshot.segments.size( ); i++ ) {
+		const auto& segment = snapshot.segments[i];
+		auto path = ( directory / ( "segment" + std::to_string( i ) ) ).string( );
+		std::ofstream( path, std::ios::binary ).write( reinterpret_cast<const char*>( snapshot.bytes.data( ) + segment.offset ), segment.size );
+		paths.push_back( std::move( path ) );
+	}
+	return paths;
+}
+
+int main( int argc, char** argv ) {
+	const auto seed = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 1;
+	const size_t patternCount = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 1000;
+	std::mt19937_64 random( seed );
+
+	const auto snapshot = BuildRandomImage( random );
+	const BytePositionIndex positionIndex( snapshot );
+	const FMIndex builtIndex( snapshot, 7 );
+	std::stringstream stream;
+	builtIndex.Save( stream );
+	const auto loadedIndex = FMIndex::Load( stream, snapshot );
+	if( !loadedIndex.has_value( ) ) {
+		std::printf( "FM-index failed to load: %s\n", loadedIndex.error( ).c_str( ) );
+		return 1;
+	}
+
+	const auto corpusDirectory = std::filesystem::temp_directory_path( ) / ( "sigmaker_engine_test_" + std::to_string( seed ) + "_" + std::to_string( random( ) ) );
+	Corpus corpus;
+	for( const auto& error : corpus.Load( WriteCorpusFiles( snapshot, corpusDirectory ) ) ) {
+		std::printf( "%s\n", error.c_str( ) );
+		Failures++;
+	}
+	std::printf( "Image of %zu bytes in %zu segments, seed %llu, %zu patterns\n", snapshot.bytes.size( ), snapshot.segments.size( ), static_cast<unsigned long long>( seed ), patternCount );
+
+	for( size_t p = 0; p < patternCount; p++ ) {
+		const auto withJumps = random( ) % 3 == 0;
+		const auto signature = RandomPattern( snapshot, random, withJumps );
+		if( signature.empty( ) ) {
+			continue;
+		}
+		const auto hasJumps = HasJumps( signature );
+		const auto expected = NaiveMatches( snapshot, signature );
+		const size_t limits[] = { 1, 2, SIZE_MAX };
+		const auto maxMatches = limits[random( ) % 3];
+
+		const auto gapMatches = FindGapSignatureMatches( snapshot, signature, maxMatches );
+		if( gapMatches != FirstMatches( expected, maxMatches ) ) {
+			Fail( "GapSearch", p, Describe( gapMatches, expected ) );
+		}
+
+		// The corpus counts signatures it can not search as matching
+		const size_t corpusLimit = maxMatches == SIZE_MAX ? 1000 : maxMatches;
+		const auto corpusExpected = hasJumps ? corpusLimit : std::min( expected.size( ), corpusLimit );
+		if( const auto count = corpus.CountOccurences( signature, corpusLimit ); count != corpusExpected ) {
+			Fail( "Corpus", p, std::to_string( count ) + " matches instead of " + std::to_string( corpusExpected ) );
+		}
+
+		if( hasJumps ) {
+			continue;
+		}
+
+		const auto positionMatches = positionIndex.FindMatches( signature, maxMatches );
+		if( !std::ranges::equal( positionMatches, FirstMatches( expected, maxMatches ) ) ) {
+			Fail( "BytePositionIndex", p, Describe( positionMatches, expected ) );
+		}
+
+		// Short runs match too often to locate them all in reasonable time, the index has to decline exactly those
+		const auto rarestRunCount = RarestRunCount( snapshot, signature );
+		for( const FMIndex* index : { &builtIndex, &loadedIndex.value( ) } ) {
+			const auto fmMatches = index->FindMatches( signature, maxMatches, FMCandidates );
+			if( rarestRunCount == UINT64_MAX || rarestRunCount > FMCandidates ) {
+				if( fmMatches.has_value( ) ) {
+					Fail( "FMIndex", p, "answered a signature above the candidate limit" );
+				}
+			}
+			else if( !fmMatches.has_value( ) ) {
+				Fail( "FMIndex", p, "no answer" );
+			}
+			else if( !std::ranges::equal( fmMatches.value( ), FirstMatches( expected, maxMatches ) ) ) {
+				Fail( "FMIndex", p, Describe( fmMatches.value( ), expected ) );
+			}
+		}
+
+		if( p % 4 == 0 ) {
+			const auto maxMismatches = random( ) % 3;
+			const auto fuzzyMatches = FindFuzzyMatches( snapshot, signature, maxMismatches );
+			const auto fuzzyExpected = NaiveFuzzyMatches( snapshot, signature, maxMismatches );
+			if( !std::ranges::equal( fuzzyMatches, fuzzyExpected, []( const auto& a, const auto& b ) { return a.offset == b.offset && a.distance == b.distance; } ) ) {
+				Fail( "FuzzySearch", p, std::to_string( fuzzyMatches.size( ) ) + " matches instead of " + std::to_string( fuzzyExpected.size( ) ) );
+			}
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all( corpusDirectory, error );
+	std::printf( "%zu failures\n", Failures );
+	return Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+// Scans directory trees of binaries for a list of signatures, with many large reads in flight to keep the disk busy
+// Usage: CorpusScan <signature list> <file or directory>... [--pread] [--direct] [--depth <reads in flight>] [--threads <count>]
+// The list holds one signature per line like "48 8B ? ? 05", optionally preceded by "name:", lines starting with # are skipped
+
+#include "Corpus.h"
+#include "CorpusReader.h"
+#include "SignatureTypes.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+
+typedef struct {
+	std::string name;
+	Signature signature;
+	size_t anchor;		// First byte that is not a wildcard, candidates are found with memchr
+} NamedSignature;
+
+static std::expected<NamedSignature, std::string> ParseLine( const std::string& line ) {
+	NamedSignature entry{ {}, {}, SIZE_MAX };
+	const auto colon = line.find( ':' );
+	if( colon != std::string::npos ) {
+		entry.name = line.substr( 0, colon );
+	}
+
+	std::istringstream tokens( colon != std::string::npos ? line.substr( colon + 1 ) : line );
+	std::string token;
+	while( tokens >> token ) {
+		if( token == "?" || token == "??" ) {
+			entry.signature.push_back( SignatureByte{ 0, true, 0, 0, 0 } );
+			continue;
+		}
+		uint8_t value = 0;
+		const auto [end, error] = std::from_chars( token.data( ), token.data( ) + token.size( ), value, 16 );
+		if( token.size( ) != 2 || error != std::errc( ) || end != token.data( ) + token.size( ) ) {
+			return std::unexpected( "Invalid byte " + token );
+		}
+		if( entry.anchor == SIZE_MAX ) {
+			entry.anchor = entry.signature.size( );
+		}
+		entry.signature.push_back( SignatureByte{ value, false, 0, 0, 0 } );
+	}
+	if( entry.anchor == SIZE_MAX ) {
+		return std::unexpected( "Signature without any known byte" );
+	}
+	if( entry.name.empty( ) ) {
+		entry.name = line;
+	}
+	return entry;
+}
+
+static size_t CountMatches( std::span<const uint8_t> data, const NamedSignature& entry ) {
+	const auto& signature = entry.signature;
+	if( signature.size( ) > data.size( ) ) {
+		return 0;
+	}
+	const auto last = data.size( ) - signature.size( );
+	const auto anchorValue = signature[entry.anchor].value;
+	size_t count = 0;
+	for( size_t position = 0; position <= last; position++ ) {
+		const auto found = static_cast<const uint8_t*>( std::memchr( data.data( ) + position + entry.anchor, anchorValue, last - position + 1 ) );
+		if( !found ) {
+			break;
+		}
+		position = static_cast<size_t>( found - data.data( ) ) - entry.anchor;
+		size_t i = 0;
+		while( i < signature.size( ) && ( signature[i].isWildcard || data[position + i] == signature[i].value ) ) {
+			i++;
+		}
+		if( i == signature.size( ) ) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int main( int argc, char** argv ) {
+	CorpusReadOptions options;
+	std::vector<std::string> arguments;
+	for( int i = 1; i < argc; i++ ) {
+		const std::string_view argument = argv[i];
+		if( argument == "--pread" ) {
+			options.allowIoUring = false;
+		}
+		else if( argument == "--direct" ) {
+			options.directIo = true;
+		}
+		else if( argument == "--depth" && i + 1 < argc ) {
+			options.queueDepth = std::max<size_t>( std::strtoull( argv[++i], nullptr, 10 ), 1 );
+		}
+		else if( argument == "--threads" && i + 1 < argc ) {
+			SetThreadPoolSize( std::strtoull( argv[++i], nullptr, 10 ) );
+		}
+		else {
+			arguments.emplace_back( argument );
+		}
+	}
+	if( arguments.size( ) < 2 ) {
+		std::printf( "Usage: %s <signature list> <file or directory>... [--pread] [--direct] [--depth <reads in flight>] [--threads <count>]\n", argv[0] );
+		return 1;
+	}
+
+	std::ifstream list( arguments[0] );
+	if( !list ) {
+		std::printf( "Failed to open %s\n", arguments[0].c_str( ) );
+		return 1;
+	}
+	std::vector<NamedSignature> signatures;
+	std::string line;
+	for( size_t lineNumber = 1; std::getline( list, line ); lineNumber++ ) {
+		if( line.find_first_not_of( " \t\r" ) == std::string::npos || line.front( ) == '#' ) {
+			continue;
+		}
+		auto entry = ParseLine( line );
+		if( !entry.has_value( ) ) {
+			std::printf( "%s:%zu: %s\n", arguments[0].c_str( ), lineNumber, entry.error( ).c_str( ) );
+			return 1;
+		}
+		signatures.push_back( std::move( entry.value( ) ) );
+	}
+
+	std::vector<std::string> errors;
+	const auto files = CollectCorpusFiles( std::vector<std::string>( arguments.begin( ) + 1, arguments.end( ) ), errors );
+
+	// Lowest file index with a match, so the reported file does not depend on the read order
+	std::vector<std::atomic<size_t>> matchCounts( signatures.size( ) );
+	std::vector<std::atomic<size_t>> fileCounts( signatures.size( ) );
+	std::vector<size_t> firstFiles( signatures.size( ), SIZE_MAX );
+	std::mutex firstFilesMutex;
+	auto statistics = ReadCorpus( files, [&]( size_t file, std::span<const uint8_t> data ) {
+		for( size_t i = 0; i < signatures.size( ); i++ ) {
+			const auto count = CountMatches( data, signatures[i] );
+			if( count == 0 ) {
+				continue;
+			}
+			matchCounts[i] += count;
+			fileCounts[i]++;
+			std::scoped_lock lock( firstFilesMutex );
+			firstFiles[i] = std::min( firstFiles[i], file );
+		}
+	}, options );
+	errors.insert( errors.end( ), statistics.errors.begin( ), statistics.errors.end( ) );
+
+	for( const auto& error : errors ) {
+		std::printf( "%s\n", error.c_str( ) );
+	}
+	const auto seconds = std::chrono::duration<double>( statistics.duration ).count( );
+	std::printf( "Read %zu files, %.1f MB in %.2f s (%.0f MB/s) with %s\n", statistics.files, statistics.bytes / 1e6, seconds, seconds > 0 ? statistics.bytes / 1e6 / seconds : 0.0, statistics.backend );
+	for( size_t i = 0; i < signatures.size( ); i++ ) {
+		if( fileCounts[i] == 0 ) {
+			std::printf( "%s: no matches\n", signatures[i].name.c_str( ) );
+		}
+		else {
+			std::printf( "%s: %zu matches in %zu files, first in %s\n", signatures[i].name.c_str( ), matchCounts[i].load( ), fileCounts[i].load( ), files[firstFiles[i]].c_str( ) );
+		}
+	}
+	return errors.empty( ) ? 0 : 2;
+}
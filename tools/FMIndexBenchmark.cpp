@@ -0,0 +1,90 @@
+// Build and query benchmark of the FM-index at several suffix array sampling rates
+// Usage: FMIndexBenchmark <binary> [queries per length]
+
+#include "ByteSnapshot.h"
+#include "FMIndex.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMicroseconds( Clock::time_point start ) {
+	return std::chrono::duration<double, std::micro>( Clock::now( ) - start ).count( );
+}
+
+int main( int argc, char** argv ) {
+	if( argc < 2 ) {
+		std::printf( "Usage: %s <binary> [queries per length]\n", argv[0] );
+		return 1;
+	}
+	const size_t queryCount = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 1000;
+
+	std::ifstream file( argv[1], std::ios::binary );
+	if( !file ) {
+		std::printf( "Failed to open %s\n", argv[1] );
+		return 1;
+	}
+	ByteSnapshot snapshot;
+	snapshot.bytes.assign( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>( ) );
+	if( snapshot.bytes.size( ) < 64 || snapshot.bytes.size( ) > UINT32_MAX ) {
+		std::printf( "Binary has to be between 64 bytes and 4 GB\n" );
+		return 1;
+	}
+	snapshot.segments.push_back( SnapshotSegment{ 0, 0, snapshot.bytes.size( ) } );
+	snapshot.ComputeHistogram( );
+	std::printf( "%s: %zu bytes, %zu queries per length\n\n", argv[1], snapshot.bytes.size( ), queryCount );
+
+	// Patterns are taken from the binary so every one has at least one match
+	std::mt19937_64 random( 1 );
+	constexpr size_t patternLengths[] = { 4, 8, 16, 32 };
+	std::vector<std::vector<size_t>> patternStarts;
+	for( const auto length : patternLengths ) {
+		auto& starts = patternStarts.emplace_back( );
+		for( size_t i = 0; i < queryCount; i++ ) {
+			starts.push_back( random( ) % ( snapshot.bytes.size( ) - length ) );
+		}
+	}
+
+	std::printf( "Rate  Build ms  Bytes/byte" );
+	for( const auto length : patternLengths ) {
+		std::printf( "  Count %2zu us", length );
+	}
+	std::printf( "  Locate us  Located\n" );
+
+	for( const size_t sampleRate : { 4, 8, 16, 32, 64, 128 } ) {
+		const auto buildStart = Clock::now( );
+		const FMIndex index( snapshot, sampleRate );
+		const auto buildTime = ElapsedMicroseconds( buildStart ) / 1000.0;
+		std::printf( "%4zu  %8.0f  %10.2f", sampleRate, buildTime, static_cast<double>( index.MemoryUsage( ) ) / snapshot.bytes.size( ) );
+
+		// Locate is only measured for patterns that a uniqueness check would locate
+		double locateTime = 0.0;
+		size_t located = 0;
+		for( size_t l = 0; l < std::size( patternLengths ); l++ ) {
+			const auto length = patternLengths[l];
+			const auto countStart = Clock::now( );
+			uint64_t matches = 0;
+			for( const auto start : patternStarts[l] ) {
+				matches += index.Count( snapshot.bytes.data( ) + start, length );
+			}
+			std::printf( "  %11.2f", ElapsedMicroseconds( countStart ) / queryCount );
+
+			for( const auto start : patternStarts[l] ) {
+				if( index.Count( snapshot.bytes.data( ) + start, length ) > FMIndex::DefaultMaxCandidates ) {
+					continue;
+				}
+				const auto locateStart = Clock::now( );
+				located += index.Locate( snapshot.bytes.data( ) + start, length ).size( );
+				locateTime += ElapsedMicroseconds( locateStart );
+			}
+			( void )matches;
+		}
+		std::printf( "  %9.2f  %7zu\n", located ? locateTime / located : 0.0, located );
+	}
+	return 0;
+}
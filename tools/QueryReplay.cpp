@@ -0,0 +1,129 @@
+// Replays a query trace recorded by the plugin against a dump of the image it was recorded on
+// Usage: QueryReplay <image dump> <query trace> [position|fm|gap] [repeats]
+
+#include "ByteSnapshot.h"
+#include "BytePositionIndex.h"
+#include "FMIndex.h"
+#include "GapSearch.h"
+#include "QueryTrace.h"
+#include "SignatureFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMilliseconds( Clock::time_point start ) {
+	return std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( );
+}
+
+int main( int argc, char** argv ) {
+	if( argc < 3 ) {
+		std::printf( "Usage: %s <image dump> <query trace> [position|fm|gap] [repeats]\n", argv[0] );
+		return 1;
+	}
+	const std::string_view engine = argc > 3 ? argv[3] : "position";
+	const size_t repeats = argc > 4 ? std::max<size_t>( std::strtoull( argv[4], nullptr, 10 ), 1 ) : 1;
+	if( engine != "position" && engine != "fm" && engine != "gap" ) {
+		std::printf( "Unknown search %.*s, use position, fm or gap\n", static_cast<int>( engine.size( ) ), engine.data( ) );
+		return 1;
+	}
+
+	auto snapshot = ByteSnapshot::Load( argv[1] );
+	if( !snapshot.has_value( ) ) {
+		std::printf( "%s\n", snapshot.error( ).c_str( ) );
+		return 1;
+	}
+	const auto trace = LoadQueryTrace( argv[2] );
+	if( !trace.has_value( ) ) {
+		std::printf( "%s\n", trace.error( ).c_str( ) );
+		return 1;
+	}
+	if( snapshot->Hash( ) != trace->imageHash || snapshot->bytes.size( ) != trace->imageSize ) {
+		std::printf( "The trace was recorded on another image\n" );
+		return 1;
+	}
+	std::printf( "%s: %zu bytes in %zu segments, %zu queries\n", argv[1], snapshot->bytes.size( ), snapshot->segments.size( ), trace->queries.size( ) );
+
+	// Built like the plugin does on first use
+	const auto buildStart = Clock::now( );
+	std::optional<BytePositionIndex> positionIndex;
+	std::optional<FMIndex> fmIndex;
+	if( engine == "position" ) {
+		if( !BytePositionIndex::Supports( snapshot.value( ) ) ) {
+			std::printf( "Image is too large for the position index\n" );
+			return 1;
+		}
+		positionIndex.emplace( snapshot.value( ) );
+	}
+	else if( engine == "fm" ) {
+		fmIndex.emplace( snapshot.value( ) );
+	}
+	std::printf( "Index built in %.1f ms\n", ElapsedMilliseconds( buildStart ) );
+
+	// Jumps are only supported by the gap search, like in the plugin
+	const auto search = [&]( const RecordedQuery& query ) -> size_t {
+		const auto limit = static_cast<size_t>( std::min<uint64_t>( query.maxMatches, SIZE_MAX ) );
+		if( !HasJumps( query.signature ) ) {
+			if( positionIndex ) {
+				return positionIndex->FindMatches( query.signature, limit ).size( );
+			}
+			if( fmIndex ) {
+				if( const auto matches = fmIndex->FindMatches( query.signature, limit ) ) {
+					return matches->size( );
+				}
+			}
+		}
+		return FindGapSignatureMatches( snapshot.value( ), query.signature, limit ).size( );
+	};
+
+	std::vector<double> replayedMs( trace->queries.size( ), 0.0 );
+	size_t mismatches = 0;
+	for( size_t r = 0; r < repeats; r++ ) {
+		for( size_t i = 0; i < trace->queries.size( ); i++ ) {
+			const auto& query = trace->queries[i];
+			const auto start = Clock::now( );
+			const auto matches = search( query );
+			replayedMs[i] += ElapsedMilliseconds( start ) / repeats;
+
+			// Queries cut short by a deadline may have counted less
+			if( r == 0 && !query.timedOut && matches != query.matches ) {
+				if( mismatches++ < 10 ) {
+					std::printf( "Mismatch in query %zu, recorded %llu, replayed %zu: %s\n", i + 1, static_cast<unsigned long long>( query.matches ), matches, BuildIDASignatureString( query.signature ).c_str( ) );
+				}
+			}
+		}
+	}
+
+	double recordedTotal = 0.0, replayedTotal = 0.0;
+	for( size_t i = 0; i < trace->queries.size( ); i++ ) {
+		recordedTotal += trace->queries[i].nanoseconds / 1e6;
+		replayedTotal += replayedMs[i];
+	}
+	auto sorted = replayedMs;
+	std::ranges::sort( sorted );
+	const auto percentile = [&]( double p ) {
+		return sorted.empty( ) ? 0.0 : sorted[std::min( sorted.size( ) - 1, static_cast<size_t>( p * sorted.size( ) ) )];
+	};
+	std::printf( "\nRecorded   %10.2f ms\n", recordedTotal );
+	std::printf( "Replayed   %10.2f ms (%.*s, %zu repeats)\n", replayedTotal, static_cast<int>( engine.size( ) ), engine.data( ), repeats );
+	std::printf( "Per query  p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", percentile( 0.5 ), percentile( 0.99 ), sorted.empty( ) ? 0.0 : sorted.back( ) );
+	std::printf( "Mismatches %zu\n", mismatches );
+
+	// Slowest queries are the first candidates for tuning
+	std::vector<size_t> order( trace->queries.size( ) );
+	for( size_t i = 0; i < order.size( ); i++ ) {
+		order[i] = i;
+	}
+	std::ranges::sort( order, [&]( size_t a, size_t b ) { return replayedMs[a] > replayedMs[b]; } );
+	std::printf( "\nSlowest queries:\n" );
+	for( size_t i = 0; i < std::min<size_t>( order.size( ), 5 ); i++ ) {
+		const auto& query = trace->queries[order[i]];
+		std::printf( "%8.3f ms  #%zu, %llu matches: %s\n", replayedMs[order[i]], order[i] + 1, static_cast<unsigned long long>( query.matches ), BuildIDASignatureString( query.signature ).c_str( ) );
+	}
+	return mismatches == 0 ? 0 : 2;
+}